@@ -5,25 +5,14 @@
 
 #include <iostream>
 #include <vector>
+#include <memory>
 #include <chrono>
+#include "../common/transpose.hpp"
+#include "../common/bench.hpp"
 
-#define TIMERSTART(label) auto start_##label = std::chrono::high_resolution_clock::now()
-#define TIMERSTOP(label)                                                                                     \
-    auto stop_##label = std::chrono::high_resolution_clock::now();                                           \
-    std::cout << #label " took "                                                                             \
-              << std::chrono::duration_cast<std::chrono::milliseconds>(stop_##label - start_##label).count() \
-              << " ms" << std::endl;
-
-int main()
+// Without transposing B
+void naive_mult(const float *A, const float *B, float *C, uint64_t size)
 {
-    const uint64_t size = 2048;
-    std::vector<float> A(size * size, 1.0f);
-    std::vector<float> B(size * size, 1.0f);
-    std::vector<float> Bt(size * size, 0.0f);
-    std::vector<float> C(size * size, 0.0f);
-
-    // Without transposing B
-    TIMERSTART(naive_mult);
     for (uint64_t i = 0; i < size; i++)
     {
         for (uint64_t j = 0; j < size; j++)
@@ -38,14 +27,11 @@ int main()
             C[i * size + j] = accum;
         }
     }
-    TIMERSTOP(naive_mult);
-    // naive_mult took 155911 ms
-
-    // Cache inefficiency: B[k * size + j] results in frequent cache misses since
-    // elements are not accessed sequentially in memory
+}
 
-    // Transposing B
-    TIMERSTART(transpose);
+// Transposing B
+void transpose_scalar(const float *B, float *Bt, uint64_t size)
+{
     for (uint64_t k = 0; k < size; k++)
     {
         for (uint64_t j = 0; j < size; j++)
@@ -54,12 +40,11 @@ int main()
             Bt[j * size + k] = B[k * size + j];
         }
     }
-    TIMERSTOP(transpose);
-    // transpose took 107 ms
-    // Transposing improves spatial locality by storing B in row-major order for efficient access.
+}
 
-    // Multiplication using Bt
-    TIMERSTART(transpose_mult);
+// Multiplication using Bt
+void transpose_mult(const float *A, const float *Bt, float *C, uint64_t size)
+{
     for (uint64_t i = 0; i < size; i++)
     {
         for (uint64_t j = 0; j < size; j++)
@@ -73,7 +58,70 @@ int main()
             C[i * size + j] = accum;
         }
     }
-    TIMERSTOP(transpose_mult);
+}
+
+// Statistical runs of every kernel over a size sweep (--bench, see common/bench.hpp).
+// Buffers live in the closures, so each size allocates once and the timed runs reuse them.
+int runBenchmarks(bench::Suite &suite)
+{
+    for (long long n : suite.sizes({256, 512, 1024}))
+    {
+        size_t count = static_cast<size_t>(n) * n;
+        auto A = std::make_shared<std::vector<float>>(count, 1.0f);
+        auto B = std::make_shared<std::vector<float>>(count, 1.0f);
+        auto Bt = std::make_shared<std::vector<float>>(count, 0.0f);
+        auto C = std::make_shared<std::vector<float>>(count, 0.0f);
+        bench::Work mult = {2.0 * n * n * n, 3.0 * count * sizeof(float)};
+        bench::Work trans = {0, 2.0 * count * sizeof(float)};
+        suite.add("naive_mult", {{"n", n}}, mult, [=] { naive_mult(A->data(), B->data(), C->data(), n); }, 3);
+        suite.add("transpose", {{"n", n}}, trans, [=] { transpose_scalar(B->data(), Bt->data(), n); });
+        suite.add("blocked_transpose", {{"n", n}}, trans, [=]
+                  { transpose::transposeBlocked(B->data(), n, Bt->data(), n, n, n); });
+        suite.add("transpose_mult", {{"n", n}}, mult, [=] { transpose_mult(A->data(), Bt->data(), C->data(), n); }, 3);
+    }
+    return suite.run();
+}
+
+int main(int argc, char **argv)
+{
+    bench::Suite suite("Lab3", argc, argv);
+    if (suite.requested())
+        return runBenchmarks(suite);
+
+    const uint64_t size = 2048;
+    std::vector<float> A(size * size, 1.0f);
+    std::vector<float> B(size * size, 1.0f);
+    std::vector<float> Bt(size * size, 0.0f);
+    std::vector<float> C(size * size, 0.0f);
+
+    // Without transposing B
+    bench::Timer naive_mult_timer("naive_mult");
+    naive_mult(A.data(), B.data(), C.data(), size);
+    naive_mult_timer.report();
+    // naive_mult took 155911 ms
+
+    // Cache inefficiency: B[k * size + j] results in frequent cache misses since
+    // elements are not accessed sequentially in memory
+
+    // Transposing B
+    bench::Timer transpose_timer("transpose");
+    transpose_scalar(B.data(), Bt.data(), size);
+    transpose_timer.report();
+    // transpose took 107 ms
+    // Transposing improves spatial locality by storing B in row-major order for efficient access.
+
+    // Blocked transpose: 64x64 tiles, each transposed as 8x8 blocks in AVX registers
+    std::vector<float> Bt_blocked(size * size, 0.0f);
+    bench::Timer blocked_transpose_timer("blocked_transpose");
+    transpose::transposeBlocked(B.data(), size, Bt_blocked.data(), size, size, size);
+    blocked_transpose_timer.report();
+    // The scalar loop stores one float per cache line touched in Bt; the blocked version
+    // moves 8 floats per load/store and keeps the tile's source and destination lines in cache.
+
+    // Multiplication using Bt
+    bench::Timer transpose_mult_timer("transpose_mult");
+    transpose_mult(A.data(), Bt.data(), C.data(), size);
+    transpose_mult_timer.report();
     // transpose_mult took 32641 ms
     // Bt improves cache locality, reducing cache misses and improving performance.
 
@@ -1,7 +1,22 @@
 #include <iostream>
 #include <vector>
-#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
 #include <immintrin.h>
+#include <omp.h>
+#include "../common/gemm.hpp"
+#include "../common/transpose.hpp"
+#include "../common/strassen.hpp"
+#include "../common/gemm_fp16.hpp"
+#include "../common/random.hpp"
+#include "../common/bench.hpp"
+#include "../common/isa.hpp"
+#include "../common/ooc.hpp"
+#include "../common/memory.hpp"
+#include "../common/matmul.hpp"
+#include <memory>
 
 constexpr int N = 2048;
 
@@ -17,79 +32,556 @@ void transposeMatrix(const float *B, float *B_T, int n)
     }
 }
 
-// Matrix multiplication with transposed B
-void matMulTransposed(const float *A, const float *B_T, float *C, int n)
+// Matrix multiplication with transposed B, one dot product per element. Rows of A, B_T and C are
+// ld elements apart (ld >= n). The loop and its SIMD variants live in common/matmul.hpp.
+void matMulTransposed(const float *A, const float *B_T, float *C, int n, int ld)
 {
-    for (int i = 0; i < n; i++)
+    matmul::transposedScalar(A, B_T, C, n, ld);
+}
+// Time teaken by Matrix multiplication: 22.5025 Sec
+
+// Matrix multiplication using AVX with transposed B: 8 lanes with FMA, the n % 8 leftover
+// columns done with a mask. Needs an AVX2 + FMA CPU (isa::supports).
+void matMulTransposedAVX(const float *A, const float *B_T, float *C, int n, int ld)
+{
+    matmul::transposedAVX2(A, B_T, C, n, ld);
+}
+// Time taken by AVX multiplication: 6.38833 Sec
+
+// Cache-blocked, register-tiled multiplication (see common/gemm.hpp)
+// Takes B directly: packing reads it row-wise, so no transpose pass is needed.
+void matMulBlockedAVX(const float *A, const float *B, float *C, int n)
+{
+    gemm::gemm<float>(n, n, n, A, n, B, n, C, n, 1.0f, 0.0f);
+}
+
+// Multithreaded blocked multiplication: 2D tiles of C per thread, shared packed B panels
+void matMulParallelAVX(const float *A, const float *B, float *C, int n, int num_threads)
+{
+    gemm::gemmParallel<float>(n, n, n, A, n, B, n, C, n, 1.0f, 0.0f, num_threads);
+}
+
+// Largest element-wise difference between two n x n results, relative to the reference magnitude
+float maxRelativeError(const float *ref, const float *C, int n)
+{
+    float max_err = 0;
+    for (int i = 0; i < n * n; i++)
     {
-        for (int j = 0; j < n; j++)
+        float err = std::fabs(ref[i] - C[i]) / std::max(std::fabs(ref[i]), 1.0f);
+        max_err = std::max(max_err, err);
+    }
+    return max_err;
+}
+
+// Check gemm<T> on a rectangular, odd-sized product with padded leading dimensions and
+// alpha/beta against a scalar reference. Padding columns must come back untouched.
+template <typename T>
+bool checkRectangular(int M, int L, int N, T alpha, T beta)
+{
+    const int lda = L + 3, ldb = N + 5, ldc = N + 7;
+    const T guard = T(-12345);
+    std::vector<T> A(static_cast<size_t>(M) * lda, guard), B(static_cast<size_t>(L) * ldb, guard);
+    std::vector<T> C(static_cast<size_t>(M) * ldc, guard), ref(static_cast<size_t>(M) * N);
+    // One stream per row, so the padding columns keep their guard value
+    for (int i = 0; i < M; i++)
+        rng::fill_uniform(&A[i * lda], L, T(0), T(1), 1000 + i);
+    for (int k = 0; k < L; k++)
+        rng::fill_uniform(&B[k * ldb], N, T(0), T(1), 2000 + k);
+    for (int i = 0; i < M; i++)
+        rng::fill_uniform(&C[i * ldc], N, T(0), T(1), 3000 + i);
+
+    for (int i = 0; i < M; i++)
+    {
+        for (int j = 0; j < N; j++)
         {
-            float sum = 0;
-            for (int k = 0; k < n; k++)
-            {
-                sum += A[i * n + k] * B_T[j * n + k];
-            }
-            C[i * n + j] = sum;
+            double sum = 0;
+            for (int k = 0; k < L; k++)
+                sum += static_cast<double>(A[i * lda + k]) * B[k * ldb + j];
+            ref[i * N + j] = static_cast<T>(alpha * sum + beta * C[i * ldc + j]);
         }
     }
+
+    gemm::gemm<T>(M, L, N, A.data(), lda, B.data(), ldb, C.data(), ldc, alpha, beta);
+
+    double max_err = 0;
+    bool guards_intact = true;
+    for (int i = 0; i < M; i++)
+    {
+        for (int j = 0; j < N; j++)
+            max_err = std::max(max_err, std::fabs(static_cast<double>(ref[i * N + j] - C[i * ldc + j])) /
+                                            std::max(std::fabs(static_cast<double>(ref[i * N + j])), 1.0));
+        for (int j = N; j < ldc; j++)
+            guards_intact = guards_intact && C[i * ldc + j] == guard;
+    }
+    double tol = sizeof(T) == 4 ? 1e-4 : 1e-12;
+    bool ok = max_err < tol && guards_intact;
+    std::cout << "gemm<" << (sizeof(T) == 4 ? "float" : "double") << "> " << M << "x" << L << "x" << N
+              << ": max relative error " << max_err << (guards_intact ? "" : ", padding overwritten")
+              << (ok ? " (OK)" : " (MISMATCH)") << "\n"
+              << std::flush;
+    return ok;
 }
-// Time teaken by Matrix multiplication: 22.5025 Sec
 
-// Matrix multiplication using AVX with transposed B
-void matMulTransposedAVX(const float *A, const float *B_T, float *C, int n)
+// Thread sweep: speedup and parallel efficiency of matMulParallelAVX for 1, 2, 4, ... threads
+void runThreadSweep(int n)
 {
-    for (int i = 0; i < n; i++)
+    std::vector<float> A(static_cast<size_t>(n) * n), B(static_cast<size_t>(n) * n), C(static_cast<size_t>(n) * n);
+    rng::fill_uniform(A, 0.0f, 1.0f, 1);
+    rng::fill_uniform(B, 0.0f, 1.0f, 2);
+
+    std::vector<int> thread_counts;
+    int max_threads = omp_get_max_threads();
+    for (int t = 1; t < max_threads; t *= 2)
+        thread_counts.push_back(t);
+    thread_counts.push_back(max_threads);
+
+    std::cout << "Thread sweep for n = " << n << "\n"
+              << "------------------------------------------------------------\n"
+              << "| Threads |   Time (s) |   GFLOP/s |   Speedup | Efficiency |\n"
+              << "------------------------------------------------------------\n";
+    double time1 = 0;
+    for (int t : thread_counts)
     {
-        for (int j = 0; j < n; j++)
+        bench::Timer timer("parallel_avx");
+        matMulParallelAVX(A.data(), B.data(), C.data(), n, t);
+        double time = timer.seconds();
+        if (t == 1)
+            time1 = time;
+        double speedup = time1 / time;
+        std::cout << "| " << std::setw(7) << t << " | " << std::setw(10) << time << " | "
+                  << std::setw(9) << 2.0 * n * n * n / time * 1e-9 << " | "
+                  << std::setw(9) << speedup << " | " << std::setw(10) << speedup / t << " |\n";
+    }
+    std::cout << "------------------------------------------------------------\n"
+              << std::flush;
+}
+
+// Transpose bandwidth: scalar transposeMatrix vs blocked/parallel/in-place (GB/s = bytes read + written)
+void runTransposeBenchmark(int n)
+{
+    std::vector<float> B(static_cast<size_t>(n) * n), ref(B.size()), B_T(B.size());
+    rng::fill_uniform(B, 0.0f, 1.0f, 2);
+    double bytes = 2.0 * n * n * sizeof(float);
+
+    std::cout << "Transpose benchmark for n = " << n << "\n"
+              << "---------------------------------------------------\n"
+              << "| Method            |   Time (ms) |      GB/s |    |\n"
+              << "---------------------------------------------------\n";
+    auto report = [&](const char *label, double time, bool ok)
+    {
+        std::cout << "| " << std::left << std::setw(17) << label << std::right << " | " << std::setw(11)
+                  << time * 1e3 << " | " << std::setw(9) << bytes / time * 1e-9 << " | "
+                  << (ok ? "OK" : "!!") << " |\n";
+    };
+
+    bench::Timer timer("transpose");
+    transposeMatrix(B.data(), ref.data(), n);
+    report("scalar loop", timer.seconds(), true);
+
+    timer.restart();
+    transpose::transposeBlocked(B.data(), n, B_T.data(), n, n, n);
+    report("blocked 8x8", timer.seconds(), B_T == ref);
+
+    std::fill(B_T.begin(), B_T.end(), 0.0f);
+    timer.restart();
+    transpose::transposeParallel(B.data(), n, B_T.data(), n, n, n, omp_get_max_threads());
+    report("parallel", timer.seconds(), B_T == ref);
+
+    B_T = B;
+    timer.restart();
+    transpose::transposeInPlaceSquare(B_T.data(), n, n, omp_get_max_threads());
+    report("in-place square", timer.seconds(), B_T == ref);
+
+    // Non-square in-place (cycle-following) on an n x (n / 2 + 3) matrix
+    int rows = n, cols = n / 2 + 3;
+    std::vector<float> R(static_cast<size_t>(rows) * cols), R_ref(R.size());
+    for (size_t i = 0; i < R.size(); i++)
+        R[i] = static_cast<float>(i);
+    transpose::transposeBlocked(R.data(), cols, R_ref.data(), rows, rows, cols);
+    timer.restart();
+    transpose::transposeInPlace(R.data(), rows, cols);
+    double cycles_time = timer.seconds();
+    bytes = 2.0 * R.size() * sizeof(float);
+    report("in-place cycles", cycles_time, R == R_ref);
+    std::cout << "---------------------------------------------------\n"
+              << std::flush;
+}
+
+// Memory layout of the operands at a power-of-two n: std::vector (ld = n, 16-byte aligned rows,
+// 4K pages) vs mem::Matrix without and with a padded leading dimension (64-byte aligned rows,
+// huge-page backed, aligned SIMD loads). Page faults are counted while the operands are first
+// written; times are the best of 3 runs, dTLB misses are over the matmul::transposed runs.
+void runLayoutBenchmark(int n)
+{
+    std::vector<float> A(static_cast<size_t>(n) * n), B(A.size()), B_T(A.size());
+    rng::fill_uniform(A, 0.0f, 1.0f, 1);
+    rng::fill_uniform(B, 0.0f, 1.0f, 2);
+    transpose::transposeParallel(B.data(), n, B_T.data(), n, n, n, omp_get_max_threads());
+    std::vector<float> ref(A.size());
+    matMulBlockedAVX(A.data(), B.data(), ref.data(), n);
+    perf::supported(); // lists unavailable counters now rather than inside the table
+
+    std::cout << "Operand layout for n = " << n << " (" << isa::name(isa::selected()) << ", huge pages "
+              << (mem::hugePages() ? "advised" : "off") << ")\n"
+              << "--------------------------------------------------------------------------------------------\n"
+              << "| Layout              |   ld | Fill faults | Transposed (s) | dTLB MPKI | Blocked (s) | Err  |\n"
+              << "--------------------------------------------------------------------------------------------\n";
+    auto run = [&](const char *label, float *a, float *b, float *b_t, float *c, int ld, double faults)
+    {
+        double t1 = 1e30, t2 = 1e30;
+        perf::Scope transposed(perf::Scope::ThisThread);
+        for (int rep = 0; rep < 3; rep++)
+        {
+            bench::Timer timer("transposed");
+            matmul::transposed(a, b_t, c, n, ld);
+            t1 = std::min(t1, timer.seconds());
+        }
+        transposed.stop();
+        for (int rep = 0; rep < 3; rep++)
+        {
+            bench::Timer timer("blocked");
+            gemm::gemm<float>(n, n, n, a, ld, b, ld, c, ld, 1.0f, 0.0f);
+            t2 = std::min(t2, timer.seconds());
+        }
+        float err = 0;
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j < n; j++)
+                err = std::max(err, std::fabs(ref[size_t(i) * n + j] - c[size_t(i) * ld + j]));
+        std::cout << "| " << std::left << std::setw(19) << label << std::right << " | " << std::setw(4) << ld << " | "
+                  << std::setw(11) << perf::format(faults, 6) << " | " << std::setw(14) << t1 << " | " << std::setw(9)
+                  << perf::format(transposed.total().mpki(perf::DTLBMisses)) << " | " << std::setw(11) << t2 << " | "
+                  << (err == 0 ? "OK  " : "!!  ") << " |\n"
+                  << std::flush;
+    };
+
+    {
+        perf::Scope fill(perf::Scope::ThisThread);
+        std::vector<float> a(A), b(B), b_t(B_T), c(A.size());
+        fill.stop();
+        run("std::vector", a.data(), b.data(), b_t.data(), c.data(), n, fill.total()[perf::PageFaults]);
+    }
+    for (bool padded : {false, true})
+    {
+        perf::Scope fill(perf::Scope::ThisThread);
+        mem::Matrix<float> a(n, n, padded), b(n, n, padded), b_t(n, n, padded), c(n, n, padded);
+        for (int i = 0; i < n; i++)
+        {
+            std::copy_n(&A[size_t(i) * n], n, a.row(i));
+            std::copy_n(&B[size_t(i) * n], n, b.row(i));
+            std::copy_n(&B_T[size_t(i) * n], n, b_t.row(i));
+        }
+        fill.stop();
+        run(padded ? "mem::Matrix padded" : "mem::Matrix", a.data(), b.data(), b_t.data(), c.data(), int(a.ld()),
+            fill.total()[perf::PageFaults]);
+    }
+    std::cout << "--------------------------------------------------------------------------------------------\n"
+              << std::flush;
+}
+
+// Strassen-Winograd at several crossovers: time vs the blocked kernel on the same thread count,
+// and error vs matMulTransposed. Returns the fastest crossover so it can be reused on this machine.
+int runStrassenBenchmark(const float *A, const float *B, const float *ref, int n)
+{
+    std::vector<float> C(static_cast<size_t>(n) * n);
+    int threads = omp_get_max_threads();
+    int levels = threads > 1 ? 1 : 0;
+
+    bench::Timer blocked_timer("blocked");
+    matMulParallelAVX(A, B, C.data(), n, threads);
+    double blocked_time = blocked_timer.seconds();
+
+    int best_crossover = n;
+    double best_time = blocked_time;
+
+    std::cout << "Strassen-Winograd for n = " << n << " (blocked kernel: " << blocked_time << " s)\n"
+              << "------------------------------------------------------------\n"
+              << "| Crossover |   Time (s) |   Speedup | Max rel. error vs ref |\n"
+              << "------------------------------------------------------------\n";
+    for (int crossover : {128, 256, 512, 1024})
+    {
+        if (crossover >= n)
+            continue;
+        bench::Timer timer("strassen");
+        strassen::multiply(A, B, C.data(), n, crossover, levels);
+        double time = timer.seconds();
+        if (time < best_time)
+        {
+            best_time = time;
+            best_crossover = crossover;
+        }
+        std::cout << "| " << std::setw(9) << crossover << " | " << std::setw(10) << time << " | "
+                  << std::setw(9) << blocked_time / time << " | " << std::setw(21)
+                  << maxRelativeError(ref, C.data(), n) << " |\n";
+    }
+    std::cout << "------------------------------------------------------------\n"
+              << "Measured crossover: " << best_crossover << "\n"
+              << std::flush;
+    return best_crossover;
+}
+
+// Half-precision storage: A and B kept as fp16/bf16, fp32 arithmetic. Reports the operand
+// footprint, time against the fp32 path on the same threads, and the error vs matMulTransposed.
+template <typename H>
+void runHalfPrecision(const float *A, const float *B, const float *ref, int n, double fp32_time)
+{
+    size_t count = static_cast<size_t>(n) * n;
+    std::vector<uint16_t> A16(count), B16(count);
+    std::vector<float> C(count);
+
+    bench::Timer timer(H::name());
+    half::fromFloat<H>(A, A16.data(), count);
+    half::fromFloat<H>(B, B16.data(), count);
+    double convert_time = timer.restart();
+
+    half::gemm<H>(n, n, n, A16.data(), n, B16.data(), n, C.data(), n, 1.0f, 0.0f, omp_get_max_threads());
+    double time = timer.seconds();
+
+    std::cout << "| " << std::setw(7) << H::name() << " | " << std::setw(13) << 2.0 * count * sizeof(uint16_t) / 1048576.0
+              << " | " << std::setw(10) << time << " | " << std::setw(9) << fp32_time / time << " | "
+              << std::setw(11) << convert_time << " | " << std::setw(14) << maxRelativeError(ref, C.data(), n) << " |\n";
+}
+
+void runHalfPrecisionBenchmark(const float *A, const float *B, const float *ref, int n)
+{
+    std::vector<float> C(static_cast<size_t>(n) * n);
+    bench::Timer timer("fp32");
+    matMulParallelAVX(A, B, C.data(), n, omp_get_max_threads());
+    double fp32_time = timer.seconds();
+
+    std::cout << "Half-precision storage for n = " << n << "\n"
+              << "--------------------------------------------------------------------------------\n"
+              << "| Storage | A+B size (MB) |   Time (s) |   Speedup | Convert (s) | Max rel. error |\n"
+              << "--------------------------------------------------------------------------------\n";
+    std::cout << "| " << std::setw(7) << "fp32" << " | " << std::setw(13) << 2.0 * n * n * sizeof(float) / 1048576.0
+              << " | " << std::setw(10) << fp32_time << " | " << std::setw(9) << 1.0 << " | " << std::setw(11) << 0.0
+              << " | " << std::setw(14) << maxRelativeError(ref, C.data(), n) << " |\n";
+    runHalfPrecision<half::F16>(A, B, ref, n, fp32_time);
+    runHalfPrecision<half::BF16>(A, B, ref, n, fp32_time);
+    std::cout << "--------------------------------------------------------------------------------\n"
+              << std::flush;
+}
+
+// Directory for the out-of-core matrix files: $OOC_DIR, else /tmp
+std::string oocPath(const std::string &name)
+{
+    const char *dir = std::getenv("OOC_DIR");
+    return std::string(dir ? dir : "/tmp") + "/lab4_" + name + ".tiles";
+}
+
+// Out-of-core n x n product through mapped tile files, starting from a cold page cache. When
+// check is set, the in-core blocked GEMM on the same operands is the reference.
+void runOutOfCoreBenchmark(int n, int tile, bool check)
+{
+    ooc::Matrix A = ooc::Matrix::create(oocPath("A"), n, n, tile, ooc::DType::F32);
+    ooc::Matrix B = ooc::Matrix::create(oocPath("B"), n, n, tile, ooc::DType::F32);
+    ooc::Matrix C = ooc::Matrix::create(oocPath("C"), n, n, tile, ooc::DType::F32);
+    if (!A || !B || !C)
+    {
+        std::cout << "Out-of-core: " << (!A ? A.error() : !B ? B.error() : C.error()) << "\n";
+        return;
+    }
+    ooc::fillUniform(A, 0.0f, 1.0f, 1);
+    ooc::fillUniform(B, 0.0f, 1.0f, 2);
+    A.evict();
+    B.evict();
+
+    ooc::Stats st;
+    ooc::multiply<float>(A, B, C, st, omp_get_max_threads());
+    double gflops = 2.0 * n * n * double(n) / st.wall * 1e-9;
+    std::cout << std::fixed << std::setprecision(3) << std::setw(6) << n << std::setw(6) << tile << std::setw(10)
+              << 3.0 * A.fileBytes() / (1 << 20) << std::setw(9) << st.wall << std::setw(8) << st.io << std::setw(10)
+              << st.compute << std::setw(8) << st.stall << std::setw(11) << st.writeback << std::setw(9)
+              << st.bytes_read / double(1 << 20) << std::setw(11) << st.bytes_read / st.io * 1e-6 << std::setw(9)
+              << gflops << std::setw(11) << 100 * st.overlap() << std::defaultfloat << std::setprecision(6);
+
+    if (check)
+    {
+        std::vector<float> a(size_t(n) * n), b(size_t(n) * n), ref(size_t(n) * n), c(size_t(n) * n);
+        ooc::load(A, a.data());
+        ooc::load(B, b.data());
+        ooc::load(C, c.data());
+        matMulParallelAVX(a.data(), b.data(), ref.data(), n, omp_get_max_threads());
+        float err = maxRelativeError(ref.data(), c.data(), n);
+        std::cout << "   " << err << (err < 1e-5f ? " (OK)" : " (MISMATCH)");
+    }
+    std::cout << "\n"
+              << std::flush;
+    for (const char *name : {"A", "B", "C"})
+        std::remove(oocPath(name).c_str());
+}
+
+// Statistical runs of every multiplication and transpose kernel (--bench, see common/bench.hpp),
+// over a size sweep and, for the threaded drivers, a thread sweep
+int runBenchmarks(bench::Suite &suite)
+{
+    std::vector<long long> threads;
+    for (int t = 1; t < omp_get_max_threads(); t *= 2)
+        threads.push_back(t);
+    threads.push_back(omp_get_max_threads());
+    threads = suite.threads(threads);
+
+    for (long long n : suite.sizes({256, 512, 1024, 2048}))
+    {
+        size_t count = static_cast<size_t>(n) * n;
+        auto A = std::make_shared<std::vector<float>>(count), B = std::make_shared<std::vector<float>>(count);
+        auto B_T = std::make_shared<std::vector<float>>(count), C = std::make_shared<std::vector<float>>(count);
+        auto A16 = std::make_shared<std::vector<uint16_t>>(count), B16 = std::make_shared<std::vector<uint16_t>>(count);
+        rng::fill_uniform(*A, 0.0f, 1.0f, 1);
+        rng::fill_uniform(*B, 0.0f, 1.0f, 2);
+        transposeMatrix(B->data(), B_T->data(), n);
+        const bench::Work mult = {2.0 * n * n * n, 3.0 * count * sizeof(float)};
+        const bench::Work trans = {0, 2.0 * count * sizeof(float)};
+        const bench::Params p = {{"n", n}};
+
+        // The O(n^3) scalar loops take tens of seconds at 2048: 3 runs there
+        int slow_reps = n >= 1024 ? 3 : 0;
+        suite.add("matMulTransposed", p, mult, [=] { matMulTransposed(A->data(), B_T->data(), C->data(), n, n); }, slow_reps);
+        if (isa::supports(isa::Level::AVX2))
+            suite.add("matMulTransposedAVX", p, mult, [=] { matMulTransposedAVX(A->data(), B_T->data(), C->data(), n, n); }, slow_reps);
+        if (isa::supports(isa::Level::AVX512))
+            suite.add("matmul::transposedAVX512", p, mult, [=] { matmul::transposedAVX512(A->data(), B_T->data(), C->data(), n, n); }, slow_reps);
+        suite.add(std::string("matmul::transposed ") + isa::name(isa::selected()), p, mult,
+                  [=] { matmul::transposed(A->data(), B_T->data(), C->data(), n, n); }, slow_reps);
+        suite.add("matMulBlockedAVX", p, mult, [=] { matMulBlockedAVX(A->data(), B->data(), C->data(), n); });
+        for (long long t : threads)
+            suite.add("matMulParallelAVX", {{"n", n}, {"threads", t}}, mult,
+                      [=] { matMulParallelAVX(A->data(), B->data(), C->data(), n, t); });
+        for (int crossover : {128, 256, 512})
+            if (crossover < n)
+                suite.add("strassen::multiply", {{"n", n}, {"crossover", crossover}}, mult,
+                          [=] { strassen::multiply(A->data(), B->data(), C->data(), n, crossover, omp_get_max_threads() > 1 ? 1 : 0); });
+
+        half::fromFloat<half::F16>(A->data(), A16->data(), count);
+        half::fromFloat<half::F16>(B->data(), B16->data(), count);
+        suite.add("half::gemm<F16>", p, {mult.flops, 3.0 * count * sizeof(uint16_t)}, [=]
+                  { half::gemm<half::F16>(n, n, n, A16->data(), n, B16->data(), n, C->data(), n, 1.0f, 0.0f, omp_get_max_threads()); });
+        suite.add("half::fromFloat<F16>", p, {0, 6.0 * count}, [=]
+                  { half::fromFloat<half::F16>(A->data(), A16->data(), count); });
+        auto Abf = std::make_shared<std::vector<uint16_t>>(count), Bbf = std::make_shared<std::vector<uint16_t>>(count);
+        half::fromFloat<half::BF16>(A->data(), Abf->data(), count);
+        half::fromFloat<half::BF16>(B->data(), Bbf->data(), count);
+        suite.add("half::gemm<BF16>", p, {mult.flops, 3.0 * count * sizeof(uint16_t)}, [=]
+                  { half::gemm<half::BF16>(n, n, n, Abf->data(), n, Bbf->data(), n, C->data(), n, 1.0f, 0.0f, omp_get_max_threads()); });
+
+        // Out-of-core product from a cold page cache: the untimed setup evicts A and B
+        if (n >= 1024)
         {
-            __m256 sum_vec = _mm256_setzero_ps();
-            for (int k = 0; k < n; k += 8)
+            const int tile = n / 4;
+            auto Af = std::make_shared<ooc::Matrix>(ooc::Matrix::create(oocPath("bench_A"), n, n, tile, ooc::DType::F32));
+            auto Bf = std::make_shared<ooc::Matrix>(ooc::Matrix::create(oocPath("bench_B"), n, n, tile, ooc::DType::F32));
+            auto Cf = std::make_shared<ooc::Matrix>(ooc::Matrix::create(oocPath("bench_C"), n, n, tile, ooc::DType::F32));
+            for (const char *name : {"bench_A", "bench_B", "bench_C"}) // unlinked now, freed with the mapping
+                std::remove(oocPath(name).c_str());
+            if (*Af && *Bf && *Cf)
             {
-                __m256 a_vec = _mm256_loadu_ps(&A[i * n + k]);
-                __m256 b_vec = _mm256_loadu_ps(&B_T[j * n + k]);
-                sum_vec = _mm256_fmadd_ps(a_vec, b_vec, sum_vec);
+                ooc::store(*Af, A->data());
+                ooc::store(*Bf, B->data());
+                suite.add(bench::Case{"ooc::multiply", {{"n", n}, {"tile", tile}}, mult, 0, [=]
+                                      {
+                                          Af->evict();
+                                          Bf->evict();
+                                      },
+                                      [=]
+                                      {
+                                          ooc::Stats st;
+                                          ooc::multiply<float>(*Af, *Bf, *Cf, st, omp_get_max_threads());
+                                      }});
             }
-            float sum[8];
-            _mm256_storeu_ps(sum, sum_vec);
-            C[i * n + j] = sum[0] + sum[1] + sum[2] + sum[3] +
-                           sum[4] + sum[5] + sum[6] + sum[7];
         }
+
+        suite.add("transposeMatrix", p, trans, [=] { transposeMatrix(B->data(), B_T->data(), n); });
+        suite.add("transpose::transposeBlocked", p, trans, [=]
+                  { transpose::transposeBlocked(B->data(), n, B_T->data(), n, n, n); });
+        for (long long t : threads)
+            suite.add("transpose::transposeParallel", {{"n", n}, {"threads", t}}, trans,
+                      [=] { transpose::transposeParallel(B->data(), n, B_T->data(), n, n, n, t); });
+        suite.add("transpose::transposeInPlaceSquare", p, trans, [=]
+                  { transpose::transposeInPlaceSquare(B_T->data(), n, n, omp_get_max_threads()); });
+        suite.add("transpose::transposeInPlace", {{"rows", n}, {"cols", n / 2 + 3}}, {0, 2.0 * n * (n / 2 + 3) * sizeof(float)},
+                  [=] { transpose::transposeInPlace(C->data(), n, n / 2 + 3); });
     }
+    return suite.run();
 }
-// Time taken by AVX multiplication: 6.38833 Sec
 
-int main()
+int main(int argc, char **argv)
 {
+    bench::Suite suite("Lab4", argc, argv);
+    if (suite.requested())
+        return runBenchmarks(suite);
+
     std::ios::sync_with_stdio(false); // Disable I/O synchronization for potential speedup
-    std::vector<float> A(N * N), B(N * N), B_T(N * N), C1(N * N, 0), C2(N * N, 0);
+    std::cout << "SIMD path: " << isa::describe() << "\n";
+    std::vector<float> A(N * N), B(N * N), B_T(N * N), C1(N * N, 0), C2(N * N, 0), C3(N * N, 0);
 
-    // Initialize A and B with random values
-    for (int i = 0; i < N * N; i++)
-    {
-        A[i] = static_cast<float>(rand()) / RAND_MAX;
-        B[i] = static_cast<float>(rand()) / RAND_MAX;
-    }
+    // Initialize A and B with random values (counter-based: same matrices at any thread count)
+    rng::fill_uniform(A, 0.0f, 1.0f, 1);
+    rng::fill_uniform(B, 0.0f, 1.0f, 2);
 
     // Transpose matrix B
-    transposeMatrix(B.data(), B_T.data(), N);
+    transpose::transposeParallel(B.data(), N, B_T.data(), N, N, N, omp_get_max_threads());
 
     // Measure execution time for standard multiplication
-    auto start1 = std::chrono::high_resolution_clock::now();
-    matMulTransposed(A.data(), B_T.data(), C1.data(), N);
-    auto end1 = std::chrono::high_resolution_clock::now();
-    double time1 = std::chrono::duration<double>(end1 - start1).count();
+    bench::Timer timer("matmul");
+    matMulTransposed(A.data(), B_T.data(), C1.data(), N, N);
+    double time1 = timer.restart();
 
-    // Measure execution time for AVX-optimized multiplication
-    auto start2 = std::chrono::high_resolution_clock::now();
-    matMulTransposedAVX(A.data(), B_T.data(), C2.data(), N);
-    auto end2 = std::chrono::high_resolution_clock::now();
-    double time2 = std::chrono::duration<double>(end2 - start2).count();
+    // Measure execution time for the SIMD multiplication picked for this CPU
+    matmul::transposed(A.data(), B_T.data(), C2.data(), N, N);
+    double time2 = timer.restart();
+
+    // Measure execution time for blocked multiplication (no transpose needed)
+    matMulBlockedAVX(A.data(), B.data(), C3.data(), N);
+    double time3 = timer.seconds();
+    double gflops3 = 2.0 * N * N * N / time3 * 1e-9;
 
     std::cout << "Matrix Multiplication with B Transposed (Standard): " << time1 << " seconds\n"
               << std::flush;
-    std::cout << "Matrix Multiplication with B Transposed & AVX: " << time2 << " seconds\n"
+    std::cout << "Matrix Multiplication with B Transposed & " << isa::name(isa::selected()) << ": " << time2 << " seconds\n"
+              << std::flush;
+    std::cout << "Blocked Matrix Multiplication (" << isa::name(isa::selected()) << "): " << time3 << " seconds ("
+              << gflops3 << " GFLOP/s)\n"
+              << std::flush;
+
+    // Check the blocked result against the scalar reference
+    float err = maxRelativeError(C1.data(), C3.data(), N);
+    std::cout << "Blocked vs Standard max relative error: " << err
+              << (err < 1e-4f ? " (OK)" : " (MISMATCH)") << "\n"
+              << std::flush;
+
+    // The parallel driver runs the same kernel over the same k-blocks, so it must match exactly
+    std::vector<float> C4(N * N, 0);
+    matMulParallelAVX(A.data(), B.data(), C4.data(), N, omp_get_max_threads());
+    std::cout << "Parallel vs Blocked: " << (C4 == C3 ? "identical" : "MISMATCH") << "\n"
               << std::flush;
 
+    // Rectangular and odd-sized shapes exercise the masked tail paths
+    checkRectangular<float>(1000, 3000, 257, 1.0f, 0.0f);
+    checkRectangular<float>(37, 129, 21, 0.5f, 2.0f);
+    checkRectangular<double>(1000, 3000, 257, 1.0, 0.0);
+    checkRectangular<double>(37, 129, 21, 0.5, 2.0);
+
+    for (int n : {2048, 4096, 8192})
+        runThreadSweep(n);
+
+    runStrassenBenchmark(A.data(), B.data(), C1.data(), N);
+    runHalfPrecisionBenchmark(A.data(), B.data(), C1.data(), N);
+
+    runTransposeBenchmark(N);
+    runTransposeBenchmark(4 * N);
+
+    runLayoutBenchmark(N);
+
+    // Out-of-core: A, B and C as mapped tile files, read back from disk by the prefetch thread
+    std::cout << "\nOut-of-core GEMM (files in " << oocPath("*") << ", cold page cache)\n"
+              << "     n  tile  files MB   wall s    io s compute s stall s writeback s  read MB  disk MB/s  GFLOP/s  overlap %   error\n";
+    // Sizes up to $OOC_MAX_N (default 2048, 48 MB of files); 4096 and 8192 write 192 and 768 MB
+    const char *ooc_max = std::getenv("OOC_MAX_N");
+    const int max_n = ooc_max ? std::atoi(ooc_max) : 2048;
+    runOutOfCoreBenchmark(1000, 256, true);
+    for (int n : {2048, 4096, 8192})
+        if (n <= max_n)
+            runOutOfCoreBenchmark(n, n / 4, n <= 4096);
+
     return 0;
 }
 
@@ -102,4 +594,46 @@ Speedup = Time for Standard / Time for AVX
 - The AVX version is ~3.52× faster due to SIMD parallelism and FMA instructions,
 While without AVX and FMA Computes one element    at a time; AVX Processes 8 elements in parallel & reduces memory latency using '_mm256_loadu_ps' and fuses operations with '_mm256_fmadd_ps'.
 
+- matMulTransposedAVX is still memory-bound: every C element re-reads a full row of A and of B_T.
+  matMulBlockedAVX packs B into KC x NC panels (L3 / L1) and A into MC x KC blocks (L2), then a
+  6x16 micro-kernel keeps 96 C values in 12 ymm registers, so each loaded value feeds 6 or 16 FMAs
+  instead of 1. Packing B row-wise also removes the separate transpose pass.
+- matMulParallelAVX splits C into a 2D grid of tiles (as square as possible) instead of one row
+  per chunk. All threads pack each B panel together and then share it from L3, and each thread
+  packs only its own A blocks, so per-thread traffic shrinks as the grid grows in both directions.
+- Both run on gemm::gemm<T>, which takes rectangular M x L x N float or double operands with
+  leading dimensions and alpha/beta. Partial micro-panels use _mm256_maskload/maskstore, so sizes
+  that are not a multiple of 8 stay vectorized and never read past the end of a row.
+- transposeMatrix does one strided store per element, touching a new cache line (and at 2048+
+  a new page) on every write. transpose::transposeBlocked walks 64x64 tiles and transposes 8x8
+  blocks in registers, so every load and store moves 32 bytes.
+- strassen::multiply trades one of 8 half-size products per level for 15 extra matrix
+  additions, so it only wins above a machine-dependent crossover, which runStrassenBenchmark
+  measures. Each level also adds rounding error from the additions, so the table reports the error
+  against matMulTransposed next to the time.
+- half::gemm stores A and B as fp16 (F16C) or bf16 and widens them to fp32 in registers, so the
+  operands take half the memory and half the DRAM traffic. The cost is input rounding: fp16 keeps
+  11 significant bits and bf16 only 8, which the benchmark table shows as error vs matMulTransposed.
+- matmul::transposed picks scalar / AVX2+FMA / AVX-512 at startup from cpuid (common/isa.hpp).
+  n = 517: scalar 95.8 ms, avx2+fma 20.8 ms, avx512 14.5 ms; isa_check.cpp at the top of the
+  tree compares every variant against scalar (max relative error 1.4e-6). At n = 512 AVX-512 is 12.3 ms vs 14.9 ms; at n = 1000 both are ~175 ms (memory).
+
+- Inputs come from rng::fill_uniform (counter-based Philox4x32-10, common/random.hpp) instead of
+  rand(): the fill is vectorized and multithreaded, and the matrices are identical for a given
+  seed at any thread count, so the tables above compare the same operands run to run.
+
+- ooc::multiply (common/ooc.hpp) keeps A, B and C in mmap'd tile files and streams tiles in with
+  an I/O thread running ahead of the compute thread (madvise WILLNEED + page touch). Cold page
+  cache, 1 thread: n = 4096 / tile 1024: 2.78 s, io 0.179 s, stall 0.011 s, 128 MB read, 49.5
+  GFLOP/s, overlap 93.8%, error 0. n = 8192 / tile 2048: 21.8 s, io 0.429 s, stall 0.021 s,
+  512 MB read, 50.4 GFLOP/s, overlap 95.2%: the I/O is almost entirely hidden behind the GEMMs.
+  The walkthrough now stops at n = 2048 / tile 512 (48 MB of files; 0.334 s, overlap 96.0%,
+  error 0); OOC_MAX_N=4096 or 8192 brings back the larger runs.
+
+- runLayoutBenchmark (n = 2048, best of 3): std::vector ld 2048 vs mem::Matrix (64-byte aligned
+  rows, 2 MB huge pages) with ld 2048 and padded ld 2064. Faults while writing the operands:
+  16388 / 40 / 44. matmul::transposed 1.44 / 1.39 / 1.43 s (within noise: it streams rows of B_T
+  either way), blocked gemm 0.279 / 0.307 / 0.252 s: the padded stride keeps the 6 A rows and 16 B
+  columns walked by packing out of the same L1 sets.
+
 */
\ No newline at end of file
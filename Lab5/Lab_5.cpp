@@ -1,26 +1,32 @@
 #include <iostream>
 #include <pthread.h>
 #include <vector>
-#include <chrono>
 #include <ctime>
 #include <cstdlib>
 #include <cmath>
+#include <cstring>
+#include <iomanip>
+#include "../common/thread_pool.hpp"
+#include "../common/elementwise.hpp"
+#include "../common/bench.hpp"
+#include "../common/memory.hpp"
+#include "../common/numa.hpp"
+#include "../common/layout.hpp"
+#include "../common/reduce.hpp"
+#include <memory>
 #define MATRIX_SIZE 2048
 #define NUM_THREADS 8
 
-// Timer Macros
-#define TIMERSTART(label)                                                  \
-    std::chrono::time_point<std::chrono::system_clock> a##label, b##label; \
-    a##label = std::chrono::system_clock::now();
-
-#define TIMERSTOP(label)                                                   \
-    b##label = std::chrono::system_clock::now();                           \
-    std::chrono::duration<double> delta##label = b##label - a##label;      \
-    std::cout << #label " Execution Time: " << delta##label.count() << " seconds\n";
-
-static double A[MATRIX_SIZE][MATRIX_SIZE];
-static double B[MATRIX_SIZE][MATRIX_SIZE];
-static double C[MATRIX_SIZE][MATRIX_SIZE];
+// 32 MB each, 2 MB aligned and backed by transparent huge pages (common/memory.hpp): a pass over
+// one matrix touches 16 pages instead of 8192. Rows stay contiguous (ld = MATRIX_SIZE), since
+// the fused expression and the bandwidth copy treat each matrix as one flat array. main checks
+// the allocations before anything touches them.
+using Row = double[MATRIX_SIZE];
+const size_t MATRIX_BYTES = sizeof(Row) * MATRIX_SIZE;
+static Row *A = static_cast<Row *>(mem::allocate(MATRIX_BYTES));
+static Row *B = static_cast<Row *>(mem::allocate(MATRIX_BYTES));
+static Row *C = static_cast<Row *>(mem::allocate(MATRIX_BYTES));
+static Row *D = static_cast<Row *>(mem::allocate(MATRIX_BYTES));
 
 struct ThreadData {
     int thread_id;
@@ -28,13 +34,33 @@ struct ThreadData {
 
 // Serial matrix subtraction
 void serial_matrix_subtraction() {
-    TIMERSTART(serial)
+    bench::Timer timer("serial");
     for (int i = 0; i < MATRIX_SIZE; ++i) {
         for (int j = 0; j < MATRIX_SIZE; ++j) {
             C[i][j] = A[i][j] - B[i][j];
         }
     }
-    TIMERSTOP(serial)
+    timer.report();
+}
+
+// Create NUM_THREADS pthreads running fn (each gets its thread id) and join them. With cpus,
+// thread i is created pinned to cpus[i] (numa::createThread falls back to unpinned). A thread
+// that cannot be created would leave its rows undone, so that stops the program.
+void run_pthreads(void *(*fn)(void *), const std::vector<int> &cpus = {}) {
+    pthread_t threads[NUM_THREADS];
+    ThreadData thread_data[NUM_THREADS];
+
+    for (int i = 0; i < NUM_THREADS; ++i) {
+        thread_data[i].thread_id = i;
+        int err = numa::createThread(&threads[i], cpus.empty() ? -1 : cpus[i], fn, (void *)&thread_data[i]);
+        if (err != 0) {
+            std::cerr << "pthread_create for thread " << i << ": " << std::strerror(err) << "\n";
+            std::exit(1);
+        }
+    }
+    for (int i = 0; i < NUM_THREADS; ++i) {
+        pthread_join(threads[i], nullptr);
+    }
 }
 
 // Block Distribution
@@ -54,18 +80,9 @@ void *block_subtraction(void *arg) {
 }
 
 void parallel_block() {
-    TIMERSTART(block)
-    pthread_t threads[NUM_THREADS];
-    ThreadData thread_data[NUM_THREADS];
-
-    for (int i = 0; i < NUM_THREADS; ++i) {
-        thread_data[i].thread_id = i;
-        pthread_create(&threads[i], nullptr, block_subtraction, (void *)&thread_data[i]);
-    }
-    for (int i = 0; i < NUM_THREADS; ++i) {
-        pthread_join(threads[i], nullptr);
-    }
-    TIMERSTOP(block)
+    bench::Timer timer("block");
+    run_pthreads(block_subtraction);
+    timer.report();
 }
 
 // Cyclic Distribution
@@ -82,18 +99,9 @@ void *cyclic_subtraction(void *arg) {
 }
 
 void parallel_cyclic() {
-    TIMERSTART(cyclic)
-    pthread_t threads[NUM_THREADS];
-    ThreadData thread_data[NUM_THREADS];
-
-    for (int i = 0; i < NUM_THREADS; ++i) {
-        thread_data[i].thread_id = i;
-        pthread_create(&threads[i], nullptr, cyclic_subtraction, (void *)&thread_data[i]);
-    }
-    for (int i = 0; i < NUM_THREADS; ++i) {
-        pthread_join(threads[i], nullptr);
-    }
-    TIMERSTOP(cyclic)
+    bench::Timer timer("cyclic");
+    run_pthreads(cyclic_subtraction);
+    timer.report();
 }
 
 // Block-Cyclic Distribution
@@ -102,42 +110,473 @@ void *block_cyclic_subtraction(void *arg) {
     int id = data->thread_id;
     int block_size = MATRIX_SIZE / NUM_THREADS;
     
-    for (int i = id * block_size; i < MATRIX_SIZE; i += block_size * NUM_THREADS) {
-        for (int j = 0; j < MATRIX_SIZE; ++j) {
-            C[i][j] = A[i][j] - B[i][j];
+    for (int b = id * block_size; b < MATRIX_SIZE; b += block_size * NUM_THREADS) {
+        int end = std::min(b + block_size, MATRIX_SIZE);
+        for (int i = b; i < end; ++i) {
+            for (int j = 0; j < MATRIX_SIZE; ++j) {
+                C[i][j] = A[i][j] - B[i][j];
+            }
         }
     }
     pthread_exit(nullptr);
 }
 
 void parallel_block_cyclic() {
-    TIMERSTART(block_cyclic)
-    pthread_t threads[NUM_THREADS];
-    ThreadData thread_data[NUM_THREADS];
+    bench::Timer timer("block_cyclic");
+    run_pthreads(block_cyclic_subtraction);
+    timer.report();
+}
 
-    for (int i = 0; i < NUM_THREADS; ++i) {
-        thread_data[i].thread_id = i;
-        pthread_create(&threads[i], nullptr, block_cyclic_subtraction, (void *)&thread_data[i]);
+// Persistent pool: the same three distributions, dispatched to workers created once
+void subtract_rows(size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        for (int j = 0; j < MATRIX_SIZE; ++j) {
+            C[i][j] = A[i][j] - B[i][j];
+        }
     }
-    for (int i = 0; i < NUM_THREADS; ++i) {
-        pthread_join(threads[i], nullptr);
+}
+
+void pool_block(pool::ThreadPool &tp) {
+    bench::Timer timer("pool_block");
+    tp.parallel_for({0, MATRIX_SIZE}, pool::block(), subtract_rows);
+    timer.report();
+}
+
+void pool_cyclic(pool::ThreadPool &tp) {
+    bench::Timer timer("pool_cyclic");
+    tp.parallel_for({0, MATRIX_SIZE}, pool::cyclic(), subtract_rows);
+    timer.report();
+}
+
+void pool_block_cyclic(pool::ThreadPool &tp) {
+    bench::Timer timer("pool_block_cyclic");
+    tp.parallel_for({0, MATRIX_SIZE}, pool::blockCyclic(MATRIX_SIZE / NUM_THREADS), subtract_rows);
+    timer.report();
+}
+
+// Check C against A - B and clear it for the next method
+void check_and_clear(const char *label) {
+    for (int i = 0; i < MATRIX_SIZE; ++i) {
+        for (int j = 0; j < MATRIX_SIZE; ++j) {
+            if (C[i][j] != A[i][j] - B[i][j]) {
+                std::cout << "WARNING: " << label << " result is wrong at (" << i << ", " << j << ")\n";
+                i = MATRIX_SIZE;
+                break;
+            }
+        }
     }
-    TIMERSTOP(block_cyclic)
+    std::memset(C, 0, MATRIX_BYTES);
+}
+
+// Cost of one empty parallel region: create + join NUM_THREADS pthreads vs one pool dispatch
+void *empty_thread(void *) {
+    return nullptr;
+}
+
+void dispatch_latency(pool::ThreadPool &tp) {
+    const int create_iterations = 1000, pool_iterations = 100000;
+
+    bench::Timer timer("dispatch");
+    for (int it = 0; it < create_iterations; ++it) {
+        pthread_t threads[NUM_THREADS];
+        for (int i = 0; i < NUM_THREADS; ++i)
+            pthread_create(&threads[i], nullptr, empty_thread, nullptr);
+        for (int i = 0; i < NUM_THREADS; ++i)
+            pthread_join(threads[i], nullptr);
+    }
+    double create_us = timer.restart() * 1e6 / create_iterations;
+
+    for (int it = 0; it < pool_iterations; ++it)
+        tp.run([](int) {});
+    double pool_us = timer.seconds() * 1e6 / pool_iterations;
+
+    std::cout << "Dispatch latency (" << NUM_THREADS << " threads): create/join " << create_us
+              << " us, pool " << pool_us << " us\n";
 }
 
-int main() {
+// Memory bandwidth reference: every worker copies its block of A into C (bytes read + written)
+double memory_bandwidth(pool::ThreadPool &tp) {
+    const size_t n = (size_t)MATRIX_SIZE * MATRIX_SIZE;
+    double best = 0;
+    for (int rep = 0; rep < 3; ++rep) {
+        bench::Timer timer("copy");
+        tp.parallel_for({0, n}, pool::block(), [](size_t b, size_t e) {
+            std::memcpy(&C[0][0] + b, &A[0][0] + b, (e - b) * sizeof(double));
+        });
+        best = std::max(best, 2.0 * n * sizeof(double) / timer.seconds() * 1e-9);
+    }
+    return best;
+}
+
+// C = alpha * (A - B) + D: one fused SIMD pass vs three separate passes, under each distribution
+void fused_expression(pool::ThreadPool &tp) {
+    const double alpha = 0.5;
+    const size_t n = (size_t)MATRIX_SIZE * MATRIX_SIZE;
+    double bandwidth = memory_bandwidth(tp);
+    auto a = expr::array(&A[0][0]), b = expr::array(&B[0][0]), d = expr::array(&D[0][0]);
+    auto e = alpha * (a - b) + d;
+    double bytes = expr::bytesMoved(e, n);
+
+    std::cout << "Fused C = alpha * (A - B) + D (memory bandwidth " << bandwidth << " GB/s)\n";
+    struct Method { const char *label; pool::Policy policy; };
+    Method methods[] = {{"block", pool::block()},
+                        {"cyclic", pool::cyclic()},
+                        {"block_cyclic", pool::blockCyclic(MATRIX_SIZE / NUM_THREADS)}};
+    for (const Method &m : methods) {
+        bench::Timer timer(m.label);
+        expr::assign(tp, m.policy, &C[0][0], e, MATRIX_SIZE, MATRIX_SIZE);
+        double time = timer.seconds();
+        std::cout << "  fused " << m.label << ": " << time << " seconds, " << bytes / time * 1e-9 << " GB/s ("
+                  << 100.0 * bytes / time * 1e-9 / bandwidth << "% of bandwidth)\n";
+
+        for (int i = 0; i < MATRIX_SIZE; ++i) {
+            for (int j = 0; j < MATRIX_SIZE; ++j) {
+                double ref = alpha * (A[i][j] - B[i][j]) + D[i][j];
+                if (std::fabs(C[i][j] - ref) > 1e-9 * std::max(1.0, std::fabs(ref))) {
+                    std::cout << "WARNING: fused " << m.label << " result is wrong at (" << i << ", " << j << ")\n";
+                    i = MATRIX_SIZE;
+                    break;
+                }
+            }
+        }
+    }
+
+    // Unfused: the same chain as three passes over 32 MB matrices
+    bench::Timer timer("unfused");
+    tp.parallel_for({0, MATRIX_SIZE}, pool::block(), subtract_rows);
+    tp.parallel_for({0, MATRIX_SIZE}, pool::block(), [&](size_t rb, size_t re) {
+        for (size_t i = rb; i < re; ++i)
+            for (int j = 0; j < MATRIX_SIZE; ++j)
+                C[i][j] *= alpha;
+    });
+    tp.parallel_for({0, MATRIX_SIZE}, pool::block(), [](size_t rb, size_t re) {
+        for (size_t i = rb; i < re; ++i)
+            for (int j = 0; j < MATRIX_SIZE; ++j)
+                C[i][j] += D[i][j];
+    });
+    std::cout << "  unfused block (3 passes): " << timer.seconds() << " seconds\n";
+    std::memset(C, 0, MATRIX_BYTES);
+}
+
+// Subtraction under a 2D block-cyclic descriptor (common/layout.hpp): worker id runs every rank
+// r = id, id + size, ... and subtracts the MB x NB blocks r owns. The 1D block, cyclic and
+// block-cyclic kernels above are the descriptors with Q = 1 and NB = MATRIX_SIZE.
+void subtract_block(size_t r0, size_t r1, size_t c0, size_t c1) {
+    for (size_t i = r0; i < r1; ++i) {
+        for (size_t j = c0; j < c1; ++j) {
+            C[i][j] = A[i][j] - B[i][j];
+        }
+    }
+}
+
+void layout_subtract(pool::ThreadPool &tp, const layout::Descriptor &desc) {
+    const int workers = tp.size();
+    tp.run([&](int id) {
+        for (int rank = id; rank < desc.workers(); rank += workers)
+            layout::forEachBlock(desc, rank, subtract_block);
+    });
+}
+
+// 1D row layouts next to 2D grids of the same number of workers
+struct Layout { std::string label; layout::Descriptor desc; };
+
+std::vector<Layout> layouts(int workers) {
+    const size_t n = MATRIX_SIZE;
+    int P, Q;
+    layout::squareGrid(workers, P, Q);
+    return {{"1d_block", layout::blockRows(n, n, workers)},
+            {"1d_cyclic", layout::cyclicRows(n, n, workers)},
+            {"1d_block_cyclic", layout::blockCyclicRows(n, n, workers, 64)},
+            {"2d_block", layout::block2D(n, n, P, Q)},
+            {"2d_block_cyclic", layout::blockCyclic2D(n, n, P, Q, 64, 64)},
+            {"2d_block_cyclic_8", layout::blockCyclic2D(n, n, P, Q, 8, 8)}};
+}
+
+// The blocks of every rank cover each element exactly once, owner() agrees with forEachBlock,
+// localElements() with what forEachBlock hands out, and localRow / globalRow are inverses
+bool check_descriptor(const layout::Descriptor &desc) {
+    size_t covered = 0;
+    bool ok = true;
+    for (int rank = 0; rank < desc.workers(); ++rank) {
+        size_t owned = 0;
+        layout::forEachBlock(desc, rank, [&](size_t r0, size_t r1, size_t c0, size_t c1) {
+            owned += (r1 - r0) * (c1 - c0);
+            ok = ok && desc.owner(r0, c0) == rank && desc.owner(r1 - 1, c1 - 1) == rank;
+        });
+        ok = ok && owned == desc.localElements(rank);
+        covered += owned;
+    }
+    for (size_t i = 0; i < desc.M; ++i)
+        ok = ok && desc.globalRow(desc.localRow(i), desc.rowOwner(i)) == i;
+    for (size_t j = 0; j < desc.N; ++j)
+        ok = ok && desc.globalCol(desc.localCol(j), desc.colOwner(j)) == j;
+    return ok && covered == desc.M * desc.N;
+}
+
+// Subtraction and the fused expression under each layout (best of 5). "imbalance" is the
+// largest share of elements over the mean; "row bytes" is the contiguous run a block row gives
+// the SIMD loop and the prefetcher before it jumps to the next row.
+void layout_comparison(pool::ThreadPool &tp) {
+    const double alpha = 0.5;
+    auto e = alpha * (expr::array(&A[0][0]) - expr::array(&B[0][0])) + expr::array(&D[0][0]);
+    auto best_ms = [](auto &&fn) {
+        double best = 1e30;
+        for (int rep = 0; rep < 5; ++rep) {
+            bench::Timer timer("layout");
+            fn();
+            best = std::min(best, timer.seconds() * 1e3);
+        }
+        return best;
+    };
+
+    std::cout << "Layouts (" << tp.size() << " workers)\n"
+              << " layout                  descriptor                 imbalance  row bytes  subtract ms  fused ms\n";
+    for (const Layout &l : layouts(tp.size())) {
+        bool ok = check_descriptor(l.desc);
+        double sub = best_ms([&] { layout_subtract(tp, l.desc); });
+        for (int i = 0; i < MATRIX_SIZE && ok; ++i)
+            for (int j = 0; j < MATRIX_SIZE; ++j)
+                ok = ok && C[i][j] == A[i][j] - B[i][j];
+        double fused = best_ms([&] { expr::assign(tp, l.desc, &C[0][0], e); });
+        for (int i = 0; i < MATRIX_SIZE && ok; ++i)
+            for (int j = 0; j < MATRIX_SIZE; ++j)
+                ok = ok && std::fabs(C[i][j] - (alpha * (A[i][j] - B[i][j]) + D[i][j])) <= 1e-9 * std::max(1.0, std::fabs(C[i][j]));
+        std::cout << " " << std::left << std::setw(24) << l.label << std::setw(27) << l.desc.describe() << std::right
+                  << std::setw(9) << l.desc.imbalance() << std::setw(11) << l.desc.NB * sizeof(double)
+                  << std::setw(13) << sub << std::setw(10) << fused << (ok ? "" : "  WRONG RESULT") << "\n";
+        std::memset(C, 0, MATRIX_BYTES);
+    }
+}
+
+// Read bandwidth from every node's CPUs into every node's memory: a 32 MB buffer is first
+// touched by a thread pinned to node m, then all CPUs of node r read it (best of 3)
+void node_bandwidth(const numa::Topology &topo) {
+    const size_t n = (size_t)MATRIX_SIZE * MATRIX_SIZE;
+    std::cout << "Read bandwidth in GB/s (row: CPUs of node, column: memory first touched on node)\n        ";
+    for (int m = 0; m < topo.nodes(); ++m)
+        std::cout << "    mem " << m;
+    std::cout << "\n";
+    std::vector<std::unique_ptr<numa::Buffer>> memory;
+    for (int m = 0; m < topo.nodes(); ++m) {
+        memory.push_back(std::make_unique<numa::Buffer>(n * sizeof(double)));
+        double *p = static_cast<double *>(memory.back()->data());
+        numa::runPinned({topo.cpus[m][0]}, [&](int) {
+            for (size_t i = 0; i < n; ++i)
+                p[i] = 1.0;
+        });
+    }
+    for (int r = 0; r < topo.nodes(); ++r) {
+        const std::vector<int> &cpus = topo.cpus[r];
+        std::cout << "  cpu " << r << " ";
+        for (int m = 0; m < topo.nodes(); ++m) {
+            const double *p = static_cast<const double *>(memory[m]->data());
+            std::vector<double> sums(cpus.size());
+            double best = 1e30;
+            for (int rep = 0; rep < 3; ++rep) {
+                bench::Timer timer("node_read");
+                numa::runPinned(cpus, [&](int id) {
+                    size_t b = n * id / cpus.size(), e = n * (id + 1) / cpus.size();
+                    sums[id] = reduce::sum(p + b, e - b);
+                });
+                best = std::min(best, timer.seconds());
+            }
+            std::cout << std::setw(9) << n * sizeof(double) / best * 1e-9;
+        }
+        std::cout << "\n";
+    }
+}
+
+// Thread that owns row i in block_subtraction / cyclic_subtraction / block_cyclic_subtraction
+int row_owner(pool::Distribution kind, int i) {
+    int block_size = MATRIX_SIZE / NUM_THREADS;
+    if (kind == pool::Distribution::Block)
+        return std::min(i / block_size, NUM_THREADS - 1);
+    if (kind == pool::Distribution::Cyclic)
+        return i % NUM_THREADS;
+    return (i / block_size) % NUM_THREADS;
+}
+
+// The values main gives A and B, for rows [begin, end); C is cleared
+void init_rows(size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        for (int j = 0; j < MATRIX_SIZE; ++j) {
+            A[i][j] = (double)i + j;
+            B[i][j] = (double)i - j;
+            C[i][j] = 0;
+        }
+    }
+}
+
+// The pthread kernels on fresh A, B and C whose rows were first written by the main thread
+// (all pages on its node), by their owner thread under the kernel's distribution, or by the
+// main thread into pages interleaved over the nodes. Threads are pinned compact or scatter.
+// "on owner node" counts rows whose pages are on the node of the thread that computes them:
+// asked from the kernel (move_pages) on a real NUMA machine, the first writer's node otherwise.
+void numa_placement() {
+    const numa::Topology &topo = numa::topology();
+    std::cout << "NUMA placement, " << topo.describe() << "\n";
+    node_bandwidth(topo);
+    if (!topo.placesPages())
+        std::cout << "(" << (topo.fake ? "fake topology" : "one node")
+                  << ": interleave is not applied, all pages are on the one real node)\n";
+
+    struct Kernel { const char *label; pool::Distribution kind; void *(*fn)(void *); pool::Policy policy; };
+    Kernel kernels[] = {{"block", pool::Distribution::Block, block_subtraction, pool::block()},
+                        {"cyclic", pool::Distribution::Cyclic, cyclic_subtraction, pool::cyclic()},
+                        {"block_cyclic", pool::Distribution::BlockCyclic, block_cyclic_subtraction,
+                         pool::blockCyclic(MATRIX_SIZE / NUM_THREADS)}};
+    Row *saved[] = {A, B, C};
+
+    std::cout << " pinning  distribution   serial ms  first-touch ms  interleave ms  speedup"
+              << "  rows on owner node (serial, first-touch)\n";
+    for (numa::Pinning pinning : {numa::Pinning::Compact, numa::Pinning::Scatter}) {
+        std::vector<int> cpus = numa::cpuOrder(topo, pinning, NUM_THREADS);
+        for (const Kernel &k : kernels) {
+            double ms[3];
+            int on_owner[2] = {0, 0};
+            bool correct = true;
+            for (int mode = 0; mode < 3; ++mode) {
+                numa::Buffer a(MATRIX_BYTES), b(MATRIX_BYTES), c(MATRIX_BYTES);
+                A = static_cast<Row *>(a.data());
+                B = static_cast<Row *>(b.data());
+                C = static_cast<Row *>(c.data());
+                std::vector<int> writer; // node of the thread that first wrote each row
+                if (mode == 1) {
+                    writer = numa::firstTouch(MATRIX_SIZE, k.policy, cpus, init_rows);
+                } else {
+                    if (mode == 2)
+                        for (numa::Buffer *buf : {&a, &b, &c})
+                            numa::interleave(buf->data(), buf->bytes(), topo);
+                    init_rows(0, MATRIX_SIZE);
+                    writer.assign(MATRIX_SIZE, topo.nodeOf(sched_getcpu()));
+                }
+                for (int i = 0; mode < 2 && i < MATRIX_SIZE; ++i) {
+                    int expected = topo.nodeOf(cpus[row_owner(k.kind, i)]);
+                    bool placed = writer[i] == expected;
+                    if (topo.placesPages()) {
+                        placed = true;
+                        for (void *row : {(void *)A[i], (void *)B[i], (void *)C[i]})
+                            for (int node : numa::pageNodes(row, sizeof(Row)))
+                                placed = placed && node == expected;
+                    }
+                    on_owner[mode] += placed;
+                }
+
+                ms[mode] = 1e30;
+                for (int rep = 0; rep < 5; ++rep) {
+                    bench::Timer timer(k.label);
+                    run_pthreads(k.fn, cpus);
+                    ms[mode] = std::min(ms[mode], timer.seconds() * 1e3);
+                }
+                for (int i = 0; i < MATRIX_SIZE && correct; ++i)
+                    for (int j = 0; j < MATRIX_SIZE; ++j)
+                        correct = correct && C[i][j] == A[i][j] - B[i][j];
+            }
+            std::cout << std::setw(8) << numa::name(pinning) << "  " << std::left << std::setw(12) << k.label << std::right
+                      << std::setw(12) << ms[0] << std::setw(16) << ms[1] << std::setw(15) << ms[2] << std::setw(9)
+                      << ms[0] / ms[1] << std::setw(10) << on_owner[0] << ", " << on_owner[1] << " of " << MATRIX_SIZE
+                      << (correct ? "" : "  WRONG RESULT") << "\n";
+        }
+    }
+    A = saved[0];
+    B = saved[1];
+    C = saved[2];
+}
+
+// Statistical runs of every subtraction variant and the fused expression (--bench, see
+// common/bench.hpp). The pthread versions are fixed at NUM_THREADS; the pool sweeps threads.
+int run_benchmarks(bench::Suite &suite) {
+    const double n = (double)MATRIX_SIZE * MATRIX_SIZE;
+    const bench::Work subtract = {n, 3 * n * sizeof(double)};
+    const long long size = MATRIX_SIZE;
+
+    suite.add("serial", {{"n", size}}, subtract, [] { subtract_rows(0, MATRIX_SIZE); });
+    suite.add("pthread_block", {{"n", size}, {"threads", NUM_THREADS}}, subtract, [] { run_pthreads(block_subtraction); });
+    suite.add("pthread_cyclic", {{"n", size}, {"threads", NUM_THREADS}}, subtract, [] { run_pthreads(cyclic_subtraction); });
+    suite.add("pthread_block_cyclic", {{"n", size}, {"threads", NUM_THREADS}}, subtract,
+              [] { run_pthreads(block_cyclic_subtraction); });
+
+    const double alpha = 0.5;
+    auto e = alpha * (expr::array(&A[0][0]) - expr::array(&B[0][0])) + expr::array(&D[0][0]);
+    for (long long t : suite.threads({1, 2, 4, NUM_THREADS})) {
+        auto tp = std::make_shared<pool::ThreadPool>(static_cast<int>(t));
+        struct Method { const char *label; pool::Policy policy; };
+        Method methods[] = {{"block", pool::block()},
+                            {"cyclic", pool::cyclic()},
+                            {"block_cyclic", pool::blockCyclic(MATRIX_SIZE / NUM_THREADS)}};
+        for (const Method &m : methods) {
+            pool::Policy policy = m.policy;
+            suite.add(std::string("pool_") + m.label, {{"n", size}, {"threads", t}}, subtract,
+                      [=] { tp->parallel_for({0, MATRIX_SIZE}, policy, subtract_rows); });
+            suite.add(std::string("fused_") + m.label, {{"n", size}, {"threads", t}}, {3 * n, expr::bytesMoved(e, n)},
+                      [=] { expr::assign(*tp, policy, &C[0][0], e, MATRIX_SIZE, MATRIX_SIZE); });
+        }
+        suite.add("memcpy_bandwidth", {{"n", size}, {"threads", t}}, {0, 2 * n * sizeof(double)}, [=] {
+            tp->parallel_for({0, (size_t)n}, pool::block(), [](size_t b, size_t e) {
+                std::memcpy(&C[0][0] + b, &A[0][0] + b, (e - b) * sizeof(double));
+            });
+        });
+        suite.add("pool_dispatch", {{"threads", t}}, {}, [=] { tp->run([](int) {}); });
+        for (const Layout &l : layouts(static_cast<int>(t))) {
+            layout::Descriptor desc = l.desc;
+            suite.add("layout_subtract " + l.label, {{"n", size}, {"threads", t}}, subtract,
+                      [=] { layout_subtract(*tp, desc); });
+            suite.add("layout_fused " + l.label, {{"n", size}, {"threads", t}}, {3 * n, expr::bytesMoved(e, n)},
+                      [=] { expr::assign(*tp, desc, &C[0][0], e); });
+        }
+    }
+    for (numa::Pinning pinning : {numa::Pinning::Compact, numa::Pinning::Scatter}) {
+        std::vector<int> cpus = numa::cpuOrder(numa::topology(), pinning, NUM_THREADS);
+        std::string pin = std::string(" ") + numa::name(pinning);
+        suite.add("pthread_block" + pin, {{"n", size}, {"threads", NUM_THREADS}}, subtract,
+                  [=] { run_pthreads(block_subtraction, cpus); });
+        suite.add("pthread_cyclic" + pin, {{"n", size}, {"threads", NUM_THREADS}}, subtract,
+                  [=] { run_pthreads(cyclic_subtraction, cpus); });
+        suite.add("pthread_block_cyclic" + pin, {{"n", size}, {"threads", NUM_THREADS}}, subtract,
+                  [=] { run_pthreads(block_cyclic_subtraction, cpus); });
+    }
+    suite.add("pthread_create_join", {{"threads", NUM_THREADS}}, {}, [] { run_pthreads(empty_thread); });
+    return suite.run();
+}
+
+int main(int argc, char **argv) {
+    bench::Suite suite("Lab5", argc, argv);
+    if (!A || !B || !C || !D) {
+        std::cerr << "Could not allocate the four " << MATRIX_BYTES / (1 << 20) << " MB matrices\n";
+        return 1;
+    }
+
     // Initialize matrices A and B
     for (int i = 0; i < MATRIX_SIZE; ++i) {
         for (int j = 0; j < MATRIX_SIZE; ++j) {
             A[i][j] = i + j;
             B[i][j] = i - j;
+            D[i][j] = i * 0.5;
         }
     }
-    
+    if (suite.requested())
+        return run_benchmarks(suite);
+
     serial_matrix_subtraction();
+    check_and_clear("serial");
     parallel_block();
+    check_and_clear("block");
     parallel_cyclic();
+    check_and_clear("cyclic");
     parallel_block_cyclic();
+    check_and_clear("block_cyclic");
+
+    pool::ThreadPool tp(NUM_THREADS);
+    pool_block(tp);
+    check_and_clear("pool_block");
+    pool_cyclic(tp);
+    check_and_clear("pool_cyclic");
+    pool_block_cyclic(tp);
+    check_and_clear("pool_block_cyclic");
+    dispatch_latency(tp);
+    fused_expression(tp);
+    layout_comparison(tp);
+    numa_placement();
     
     return 0;
 }
@@ -164,4 +603,33 @@ Results:
  - Block-Cyclic Speedup :   6.5x    (Best performance, due to better load balancing and cache utilization).
  - Block-cyclic distribution is the most efficient due to better memory access patterns.
  - Workload balancing and cache-friendly memory access are key to performance improvement.
+
+ - Note: block_cyclic_subtraction originally stepped i by block_size * NUM_THREADS and so computed
+   only the first row of each block (8 of 2048 rows). The 0.0039 s / 6.5x above come from that
+   version; it now processes every row of its blocks and is checked by check_and_clear.
+ - Each parallel_* call creates and joins NUM_THREADS pthreads, which is a measurable part of a
+   ~10 ms kernel. pool::ThreadPool creates its workers once (pinned to a CPU each), parks them on
+   a futex between jobs and hands out block / cyclic / block-cyclic ranges through parallel_for;
+   dispatch_latency compares one empty create/join round with one empty pool dispatch.
+ - The subtraction is bandwidth-bound, so every further operation done as a separate pass
+   (scale, add bias, clamp) costs another full read and write of 32 MB. expr::assign evaluates
+   a whole chain such as alpha * (A - B) + D in one AVX pass, and since C is larger than the
+   LLC it is written with streaming stores that skip the read-for-ownership of C.
+ - The times above are single cold runs. Median of 10 warm runs (--bench --threads 8, 1 core):
+   serial 8.1 ms, pthread_block 7.8 ms, pthread_cyclic 7.0 ms, pthread_block_cyclic 5.9 ms,
+   pool_block 5.4 ms, memcpy bandwidth 21.5 GB/s. The 6.5x speedup does not reproduce: it was
+   the truncated kernel measured against a cold serial pass.
+ - A, B, C and D now come from mem::allocate on 2 MB transparent huge pages instead of static
+   arrays on 4 KB pages. Medians of 20 runs are unchanged (serial 9.5 ms, fused_block_cyclic
+   12.7 ms on 1 thread): the passes are bandwidth-bound, and dTLB misses could not be counted here.
+ - numa_placement: serial init puts every page on the main thread's node; first touch by the
+   owner thread (numa::firstTouch, threads pinned compact or scatter) puts each row on the node
+   that computes it. With NUMA_FAKE=2x4 the owner-node check reads 1024 of 2048 rows after serial
+   init and 2048 of 2048 after first touch for every distribution. This VM has one node and one
+   CPU, so the times are all ~9-10 ms (first-touch / serial within noise); the gain needs 2 sockets.
+ - layout_comparison runs the subtraction and the fused expression under layout::Descriptor
+   (common/layout.hpp): the three 1D row layouts and 2x4 grids. Medians of 10 runs at 8 workers:
+   subtract 9.1 ms (1D block), 10.5 (cyclic), 9.7 (1D block-cyclic 64), 9.7 (2D block), 16.6 (2D
+   64x64), 45.6 (2D 8x8). An elementwise pass reuses nothing, so 2D blocks only shorten the
+   contiguous runs; rows remain the layout for this kernel, 2D pays off for the Lab 7 multiply.
 */
@@ -6,8 +6,15 @@
 #include <iostream>
 #include <vector>
 #include <omp.h>
-#include <chrono>
-#include <random>
+#include <cmath>
+#include <iomanip>
+#include "../common/gemm.hpp"
+#include "../common/knapsack.hpp"
+#include "../common/random.hpp"
+#include "../common/bench.hpp"
+#include "../common/memory.hpp"
+#include "../common/layout.hpp"
+#include <memory>
 
 // Dense Matrix Multiplication (a)
 void matrix_multiply_sequential(double *A, double *B, double *C, int M, int L, int N)
@@ -48,6 +55,109 @@ void matrix_multiply_openmp(double *A, double *B, double *C, int M, int L, int N
     }
 }
 
+// SIMD Matrix Multiplication: same M x L x N contract, run on the blocked AVX2 engine
+void matrix_multiply_simd(double *A, double *B, double *C, int M, int L, int N)
+{
+    gemm::gemm<double>(M, L, N, A, L, B, N, C, N, 1.0, 0.0);
+}
+
+// Parallel SIMD Matrix Multiplication: OpenMP over 2D tiles of C, AVX2 kernel inside each tile
+void matrix_multiply_openmp_simd(double *A, double *B, double *C, int M, int L, int N)
+{
+    gemm::gemmParallel<double>(M, L, N, A, L, B, N, C, N, 1.0, 0.0, omp_get_max_threads());
+}
+
+// Matrix Multiplication under a 2D block-cyclic descriptor of C (common/layout.hpp): thread r
+// computes the MB x NB blocks of C that rank r owns, with the naive loop or the AVX2 engine.
+// A block needs only its rows of A and its columns of B, so on a P x Q grid a thread reads M / P
+// rows of A and N / Q columns of B; matrix_multiply_openmp is the 1D block-rows case (Q = 1),
+// where every thread reads all of B. The descriptor must describe the M x N matrix C; nothing is
+// computed otherwise.
+void matrix_multiply_layout(double *A, double *B, double *C, int M, int L, int N, const layout::Descriptor &desc,
+                            bool simd)
+{
+    if (desc.M != static_cast<size_t>(M) || desc.N != static_cast<size_t>(N))
+    {
+        std::cout << "WARNING: " << desc.M << " x " << desc.N << " descriptor for a " << M << " x " << N << " C\n";
+        return;
+    }
+#pragma omp parallel num_threads(desc.workers())
+    {
+        for (int rank = omp_get_thread_num(); rank < desc.workers(); rank += omp_get_num_threads())
+        {
+            layout::forEachBlock(desc, rank, [&](size_t r0, size_t r1, size_t c0, size_t c1)
+                                 {
+                                     if (simd)
+                                     {
+                                         gemm::gemm<double>(static_cast<int>(r1 - r0), L, static_cast<int>(c1 - c0),
+                                                            A + r0 * L, L, B + c0, N, C + r0 * N + c0, N, 1.0, 0.0);
+                                         return;
+                                     }
+                                     for (size_t i = r0; i < r1; i++)
+                                     {
+                                         for (size_t j = c0; j < c1; j++)
+                                         {
+                                             double sum = 0.0;
+                                             for (int k = 0; k < L; k++)
+                                             {
+                                                 sum += A[i * L + k] * B[k * N + j];
+                                             }
+                                             C[i * N + j] = sum;
+                                         }
+                                     }
+                                 });
+        }
+    }
+}
+
+// 1D row layouts of C next to 2D grids of the same number of workers
+struct Layout
+{
+    std::string label;
+    layout::Descriptor desc;
+};
+
+std::vector<Layout> matrixLayouts(int M, int N, int workers)
+{
+    int P, Q;
+    layout::squareGrid(workers, P, Q);
+    return {{"1d_block", layout::blockRows(M, N, workers)},
+            {"1d_cyclic", layout::cyclicRows(M, N, workers)},
+            {"2d_block", layout::block2D(M, N, P, Q)},
+            {"2d_block_cyclic", layout::blockCyclic2D(M, N, P, Q, 64, 64)},
+            {"2d_block_cyclic_128", layout::blockCyclic2D(M, N, P, Q, 128, 128)}};
+}
+
+// Every layout on n x n matrices with `workers` threads, checked against `reference`.
+// "A + B per worker" is the mean of the rows of A and columns of B a worker's blocks read.
+void matrix_layout_comparison(int n, int workers, bool simd, const mem::vector<double> &A, const mem::vector<double> &B,
+                              const mem::vector<double> &reference)
+{
+    mem::vector<double> C(static_cast<size_t>(n) * n);
+    std::cout << "\n" << (simd ? "SIMD" : "Naive") << " matrix multiply by layout (n = " << n << ", " << workers
+              << " workers)\n layout                  descriptor                 imbalance  A + B per worker (MiB)"
+                 "      time (s)  max diff\n";
+    for (const Layout &l : matrixLayouts(n, n, workers))
+    {
+        bench::Timer timer(l.label);
+        matrix_multiply_layout(const_cast<double *>(A.data()), const_cast<double *>(B.data()), C.data(), n, n, n, l.desc,
+                               simd);
+        double time = timer.seconds();
+
+        double footprint = 0, max_diff = 0;
+        for (int r = 0; r < l.desc.workers(); r++)
+            footprint += double(l.desc.localRows(l.desc.gridRow(r)) + l.desc.localCols(l.desc.gridCol(r))) * n *
+                         sizeof(double);
+        for (size_t i = 0; i < C.size(); i++)
+            max_diff = std::max(max_diff, std::abs(C[i] - reference[i]));
+        std::cout << " " << std::left << std::setw(24) << l.label << std::setw(27) << l.desc.describe() << std::right
+                  << std::setw(9) << l.desc.imbalance() << std::setw(24) << footprint / l.desc.workers() / (1 << 20)
+                  << std::setw(14) << time << std::setw(10) << max_diff << "\n";
+        if (max_diff > 1e-6 * n)
+            std::cout << "WARNING: " << l.label << " result differs\n";
+    }
+}
+
 // Pseudo-Polynomial Knapsack (b)
 #define AT(i, j, C) ((i) * (C + 1) + (j))
 #define MAX(x, y) ((x) < (y) ? (y) : (x))
@@ -94,63 +204,395 @@ void knapsack_openmp(const int *w, const int *v, int *m, int N, int C)
     }
 }
 
-int main()
+// Rolling Knapsack: same inputs, but m is a single row of C + 1 values updated in place
+// (back to front, 8 capacities per AVX2 step). The result is m[C].
+void knapsack_rolling(const int *w, const int *v, int *m, int N, int C)
+{
+    knapsack::solveRow(w, v, 0, N, C, m);
+}
+
+// Wavefront Knapsack: rolling row split into one capacity slab per thread. The team is entered
+// once; neighbouring threads hand tiles of 64 items to each other through halo copies and
+// point-to-point progress flags instead of a barrier per item.
+void knapsack_wavefront(const int *w, const int *v, int *m, int N, int C)
+{
+    knapsack::solveRowParallel(w, v, N, C, m, omp_get_max_threads());
+}
+
+// Sparse Knapsack: keeps only the non-dominated (weight, value) pairs, so the cost follows the
+// frontier size rather than C. Same signature, and the optimum lands in m[C] like every row mode.
+void knapsack_sparse(const int *w, const int *v, int *m, int N, int C)
+{
+    m[C] = static_cast<int>(knapsack::solveSparse(w, v, N, C));
+}
+
+// Automatic Knapsack: dense rolling row or sparse frontier, whichever the cost estimate favours.
+// The dense engine runs in the caller's row m; the optimum is in m[C].
+void knapsack_auto(const int *w, const int *v, int *m, int N, int C)
+{
+    m[C] = static_cast<int>(knapsack::solve(w, v, N, C, nullptr, m));
+}
+
+// Optimum of knapsack_auto without a caller row, for capacities whose row of C + 1 values does
+// not fit (C ~ 10^9). The dense engine, if picked, allocates its own row.
+int knapsack_auto_value(const int *w, const int *v, int N, int C)
+{
+    return static_cast<int>(knapsack::solve(w, v, N, C));
+}
+
+// Dense vs sparse on N items with weights in [1, max_w] and values in [1, 100]; the dense engine
+// is skipped when its row would exceed 1 GiB
+void knapsack_sparse_comparison(int N, int C, int max_w, uint64_t seed)
+{
+    std::vector<int> w(N), v(N);
+    rng::fill_uniform(w, 1, max_w, seed);
+    rng::fill_uniform(v, 1, 100, seed + 1);
+    auto time = [](auto &&fn)
+    {
+        bench::Timer timer("knapsack");
+        fn();
+        return timer.seconds();
+    };
+
+    int dense = -1, sparse = 0, automatic = 0;
+    double t_dense = -1;
+    std::vector<int> row; // stays empty when the dense row would exceed the limit
+    if (double(C + 1) * sizeof(int) <= knapsack::DENSE_ROW_LIMIT)
+    {
+        row.resize(C + 1);
+        t_dense = time([&] { knapsack_rolling(w.data(), v.data(), row.data(), N, C); });
+        dense = row[C];
+    }
+    size_t frontier = 0;
+    double t_sparse = time([&] { sparse = static_cast<int>(knapsack::solveSparse(w.data(), v.data(), N, C, &frontier)); });
+    double t_auto;
+    if (row.empty())
+        t_auto = time([&] { automatic = knapsack_auto_value(w.data(), v.data(), N, C); });
+    else
+    {
+        t_auto = time([&] { knapsack_auto(w.data(), v.data(), row.data(), N, C); });
+        automatic = row[C];
+    }
+    bool sparse_chosen = knapsack::chooseEngine(w.data(), v.data(), N, C) == knapsack::Engine::Sparse;
+
+    std::cout << std::setw(6) << N << std::setw(12) << C << std::setw(10) << max_w;
+    if (t_dense < 0)
+        std::cout << std::setw(12) << "skipped";
+    else
+        std::cout << std::setw(12) << t_dense;
+    std::cout << std::setw(12) << t_sparse << std::setw(10) << frontier << std::setw(8)
+              << (sparse_chosen ? "sparse" : "dense") << std::setw(12) << t_auto << std::setw(10) << sparse << "\n";
+    if ((dense >= 0 && dense != sparse) || automatic != sparse)
+        std::cout << "WARNING: Dense and sparse knapsack disagree\n";
+}
+
+// Sequential table, per-item OpenMP table, rolling row and wavefront on the same N x C problem;
+// the table versions are skipped above `table_limit` bytes
+void knapsack_parallel_comparison(int N, int C, uint64_t seed, double table_limit)
 {
-    // Initialize random numbers for matrix and knapsack inputs
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> dis(0.0, 10.0);
-    std::uniform_int_distribution<> int_dis(1, 100);
+    std::vector<int> w(N), v(N);
+    rng::fill_uniform(w, 1, 100, seed);
+    rng::fill_uniform(v, 1, 100, seed + 1);
+    auto time = [](auto &&fn)
+    {
+        bench::Timer timer("knapsack");
+        fn();
+        return timer.seconds();
+    };
 
+    double t_seq = -1, t_omp = -1;
+    int table_value = -1;
+    if (double(N + 1) * (C + 1) * sizeof(int) <= table_limit)
+    {
+        std::vector<int> m((size_t)(N + 1) * (C + 1), 0);
+        t_seq = time([&] { knapsack_sequential(w.data(), v.data(), m.data(), N, C); });
+        table_value = m[AT(N, C, C)];
+        t_omp = time([&] { knapsack_openmp(w.data(), v.data(), m.data(), N, C); });
+    }
+    std::vector<int> row(C + 1), wave(C + 1);
+    double t_row = time([&] { knapsack_rolling(w.data(), v.data(), row.data(), N, C); });
+    double t_wave = time([&] { knapsack_wavefront(w.data(), v.data(), wave.data(), N, C); });
+
+    std::cout << std::setw(8) << N << std::setw(10) << C;
+    for (double t : {t_seq, t_omp, t_row, t_wave})
+    {
+        if (t < 0)
+            std::cout << std::setw(14) << "skipped";
+        else
+            std::cout << std::setw(14) << t;
+    }
+    if (t_seq < 0)
+        std::cout << std::setw(11) << "-" << "\n";
+    else
+        std::cout << std::setw(10) << t_seq / t_wave << "x\n";
+    if (wave != row || (table_value >= 0 && table_value != row[C]))
+        std::cout << "WARNING: Wavefront knapsack result differs\n";
+}
+
+// Wavefront knapsack at each thread count (C >= 10^6 is where slabs are long enough to scale)
+void knapsack_thread_sweep(int N, int C, uint64_t seed)
+{
+    std::vector<int> w(N), v(N), reference(C + 1), m(C + 1);
+    rng::fill_uniform(w, 1, 100, seed);
+    rng::fill_uniform(v, 1, 100, seed + 1);
+    knapsack_rolling(w.data(), v.data(), reference.data(), N, C);
+
+    std::cout << "\nWavefront knapsack thread sweep (N = " << N << ", C = " << C << ")\n";
+    std::cout << " Threads      time (s)   speedup\n";
+    double t1 = 0;
+    for (int threads = 1; threads <= 16; threads *= 2)
+    {
+        bench::Timer timer("wavefront");
+        knapsack::solveRowParallel(w.data(), v.data(), N, C, m.data(), threads);
+        double t = timer.seconds();
+        if (threads == 1)
+            t1 = t;
+        std::cout << std::setw(8) << threads << std::setw(14) << t << std::setw(9) << t1 / t << "x\n";
+        if (m != reference)
+            std::cout << "WARNING: Wavefront knapsack differs at " << threads << " threads\n";
+    }
+}
+
+// Time the full-table and rolling modes on N items with capacity C, check that they agree, and
+// recover the chosen items in O(C) memory. The full table is skipped above `table_limit` bytes.
+void knapsack_memory_comparison(int N, int C, uint64_t seed, double table_limit)
+{
+    std::vector<int> w(N), v(N);
+    rng::fill_uniform(w, 1, 100, seed);
+    rng::fill_uniform(v, 1, 100, seed + 1);
+
+    double table_bytes = double(N + 1) * (C + 1) * sizeof(int);
+    int table_value = -1;
+    if (table_bytes <= table_limit)
+    {
+        std::vector<int> m((size_t)(N + 1) * (C + 1), 0);
+        bench::Timer timer("table");
+        knapsack_sequential(w.data(), v.data(), m.data(), N, C);
+        double time = timer.seconds();
+        table_value = m[AT(N, C, C)];
+        std::cout << std::setw(8) << N << std::setw(10) << C << std::setw(11) << "table" << std::setw(14)
+                  << table_bytes / (1 << 20) << std::setw(14) << time
+                  << std::setw(12) << table_value << "\n";
+    }
+    else
+    {
+        std::cout << std::setw(8) << N << std::setw(10) << C << std::setw(11) << "table" << std::setw(14)
+                  << table_bytes / (1 << 20) << std::setw(14) << "skipped" << std::setw(12) << "-" << "\n";
+    }
+
+    std::vector<int> m(C + 1);
+    bench::Timer timer("rolling");
+    knapsack_rolling(w.data(), v.data(), m.data(), N, C);
+    double rolling_time = timer.seconds();
+    std::cout << std::setw(8) << N << std::setw(10) << C << std::setw(11) << "rolling" << std::setw(14)
+              << double(C + 1) * sizeof(int) / (1 << 20) << std::setw(14)
+              << rolling_time << std::setw(12) << m[C] << "\n";
+
+    timer.restart();
+    std::vector<int> items = knapsack::solveItems(w.data(), v.data(), N, C);
+    double items_time = timer.seconds();
+    long long weight = 0, value = 0;
+    for (int i : items)
+    {
+        weight += w[i];
+        value += v[i];
+    }
+    std::cout << std::setw(8) << N << std::setw(10) << C << std::setw(11) << "items" << std::setw(14)
+              << 2.0 * (C + 1) * sizeof(int) / (1 << 20) << std::setw(14)
+              << items_time << std::setw(12) << value << "\n";
+
+    if ((table_value >= 0 && table_value != m[C]) || value != m[C] || weight > C)
+        std::cout << "WARNING: Knapsack modes disagree (" << items.size() << " items, weight " << weight << ")\n";
+}
+
+// Statistical runs of the matmul and knapsack modes (--bench, see common/bench.hpp). The OpenMP
+// modes read omp_get_max_threads(), so each thread count is set before the timed call. Knapsack
+// "flops" count one cell update per (item, capacity).
+int runBenchmarks(bench::Suite &suite)
+{
+    const std::vector<long long> threads = suite.threads({1, 2, 4, 8});
+    for (long long n : suite.sizes({256, 512, 1024}))
+    {
+        const int sz = static_cast<int>(n);
+        auto A = std::make_shared<mem::vector<double>>(n * n), B = std::make_shared<mem::vector<double>>(n * n);
+        auto C = std::make_shared<mem::vector<double>>(n * n);
+        rng::fill_uniform(*A, 0.0, 10.0, 1);
+        rng::fill_uniform(*B, 0.0, 10.0, 2);
+        const bench::Work work = {2.0 * n * n * n, 3.0 * n * n * sizeof(double)};
+        const int slow = n >= 1024 ? 3 : 0;
+
+        suite.add("matrix_multiply_sequential", {{"n", n}, {"threads", 1}}, work, [=]
+                  { matrix_multiply_sequential(A->data(), B->data(), C->data(), sz, sz, sz); }, slow);
+        suite.add("matrix_multiply_simd", {{"n", n}, {"threads", 1}}, work, [=]
+                  { matrix_multiply_simd(A->data(), B->data(), C->data(), sz, sz, sz); });
+        for (long long t : threads)
+        {
+            suite.add("matrix_multiply_openmp", {{"n", n}, {"threads", t}}, work, [=]
+                      {
+                          omp_set_num_threads(static_cast<int>(t));
+                          matrix_multiply_openmp(A->data(), B->data(), C->data(), sz, sz, sz);
+                      }, slow);
+            suite.add("matrix_multiply_openmp_simd", {{"n", n}, {"threads", t}}, work, [=]
+                      {
+                          omp_set_num_threads(static_cast<int>(t));
+                          matrix_multiply_openmp_simd(A->data(), B->data(), C->data(), sz, sz, sz);
+                      });
+            for (const Layout &l : matrixLayouts(sz, sz, static_cast<int>(t)))
+            {
+                layout::Descriptor desc = l.desc;
+                suite.add("layout_naive " + l.label, {{"n", n}, {"threads", t}}, work, [=]
+                          { matrix_multiply_layout(A->data(), B->data(), C->data(), sz, sz, sz, desc, false); }, slow);
+                suite.add("layout_simd " + l.label, {{"n", n}, {"threads", t}}, work, [=]
+                          { matrix_multiply_layout(A->data(), B->data(), C->data(), sz, sz, sz, desc, true); });
+            }
+        }
+    }
+
+    // Knapsack with N = 1024 items (weights in [1, 100]) over growing capacity
+    const int K_N = 1024;
+    auto w = std::make_shared<std::vector<int>>(K_N), v = std::make_shared<std::vector<int>>(K_N);
+    rng::fill_uniform(*w, 1, 100, 3);
+    rng::fill_uniform(*v, 1, 100, 4);
+    for (long long c : {1024LL, 100000LL, 1000000LL})
+    {
+        const int cap = static_cast<int>(c);
+        const bench::Work work = {double(K_N) * (c + 1), 0};
+        auto row = std::make_shared<std::vector<int>>(c + 1);
+        if (c <= 100000) // the (N + 1) x (C + 1) table modes; 400 MB at C = 10^5
+        {
+            auto table = std::make_shared<std::vector<int>>(size_t(K_N + 1) * (c + 1), 0);
+            suite.add("knapsack_sequential", {{"N", K_N}, {"C", c}, {"threads", 1}}, work, [=]
+                      { knapsack_sequential(w->data(), v->data(), table->data(), K_N, cap); }, 3);
+            for (long long t : threads)
+                suite.add("knapsack_openmp", {{"N", K_N}, {"C", c}, {"threads", t}}, work, [=]
+                          {
+                              omp_set_num_threads(static_cast<int>(t));
+                              knapsack_openmp(w->data(), v->data(), table->data(), K_N, cap);
+                          }, 3);
+        }
+        suite.add("knapsack_rolling", {{"N", K_N}, {"C", c}, {"threads", 1}}, work, [=]
+                  { knapsack_rolling(w->data(), v->data(), row->data(), K_N, cap); });
+        for (long long t : threads)
+            suite.add("knapsack_wavefront", {{"N", K_N}, {"C", c}, {"threads", t}}, work, [=]
+                      {
+                          omp_set_num_threads(static_cast<int>(t));
+                          knapsack_wavefront(w->data(), v->data(), row->data(), K_N, cap);
+                      });
+        suite.add("knapsack_sparse", {{"N", K_N}, {"C", c}, {"threads", 1}}, work, [=]
+                  { knapsack_sparse(w->data(), v->data(), row->data(), K_N, cap); });
+        suite.add("knapsack_auto", {{"N", K_N}, {"C", c}, {"threads", 1}}, work, [=]
+                  { knapsack_auto(w->data(), v->data(), row->data(), K_N, cap); });
+    }
+    return suite.run();
+}
+
+int main(int argc, char **argv)
+{
+    bench::Suite suite("Lab7", argc, argv);
+    if (suite.requested())
+        return runBenchmarks(suite);
+
+    // Matrix and knapsack inputs come from the counter-based generator: fixed seeds, filled in
+    // parallel, identical for any thread count
     // (a) Matrix Multiplication: N = M = L = 256
     const int M = 256, L = 256, N = 256;
-    std::vector<double> A(M * L), B(L * N), C_seq(M * N), C_omp(M * N);
+    // 64-byte aligned (common/memory.hpp): every row of a 256-wide double matrix starts a cache line
+    mem::vector<double> A(M * L), B(L * N), C_seq(M * N), C_omp(M * N);
 
     // Initialize matrices A and B with random values
-    for (int i = 0; i < M * L; ++i)
-        A[i] = dis(gen);
-    for (int i = 0; i < L * N; ++i)
-        B[i] = dis(gen);
+    rng::fill_uniform(A, 0.0, 10.0, 1);
+    rng::fill_uniform(B, 0.0, 10.0, 2);
 
     // Sequential Matrix Multiplication
-    auto start_seq = std::chrono::high_resolution_clock::now();
+    bench::Timer timer("walkthrough");
     matrix_multiply_sequential(A.data(), B.data(), C_seq.data(), M, L, N);
-    auto end_seq = std::chrono::high_resolution_clock::now();
-    double time_seq = std::chrono::duration<double>(end_seq - start_seq).count();
+    double time_seq = timer.seconds();
     std::cout << "Sequential Matrix Multiplication Time: " << time_seq << " seconds\n";
 
     // OpenMP Matrix Multiplication
-    auto start_omp = std::chrono::high_resolution_clock::now();
+    timer.restart();
     matrix_multiply_openmp(A.data(), B.data(), C_omp.data(), M, L, N);
-    auto end_omp = std::chrono::high_resolution_clock::now();
-    double time_omp = std::chrono::duration<double>(end_omp - start_omp).count();
+    double time_omp = timer.seconds();
     std::cout << "OpenMP Matrix Multiplication Time: " << time_omp << " seconds\n";
 
+    // SIMD Matrix Multiplication (sequential and OpenMP)
+    mem::vector<double> C_simd(M * N), C_omp_simd(M * N);
+    timer.restart();
+    matrix_multiply_simd(A.data(), B.data(), C_simd.data(), M, L, N);
+    time_seq = timer.seconds();
+    std::cout << "SIMD Matrix Multiplication Time: " << time_seq << " seconds\n";
+
+    timer.restart();
+    matrix_multiply_openmp_simd(A.data(), B.data(), C_omp_simd.data(), M, L, N);
+    time_omp = timer.seconds();
+    std::cout << "OpenMP SIMD Matrix Multiplication Time: " << time_omp << " seconds\n";
+
+    double max_diff = 0.0;
+    for (int i = 0; i < M * N; ++i)
+        max_diff = std::max(max_diff, std::max(std::abs(C_seq[i] - C_simd[i]), std::abs(C_seq[i] - C_omp_simd[i])));
+    std::cout << "SIMD vs Sequential max difference: " << max_diff << "\n";
+
+    // The same products under 1D and 2D block-cyclic layouts of C (8 workers)
+    for (int n : {512, 1024})
+    {
+        mem::vector<double> A2(static_cast<size_t>(n) * n), B2(static_cast<size_t>(n) * n), ref(static_cast<size_t>(n) * n);
+        rng::fill_uniform(A2, 0.0, 10.0, 5);
+        rng::fill_uniform(B2, 0.0, 10.0, 6);
+        if (n == 512)
+            matrix_multiply_sequential(A2.data(), B2.data(), ref.data(), n, n, n);
+        else
+            matrix_multiply_simd(A2.data(), B2.data(), ref.data(), n, n, n);
+        matrix_layout_comparison(n, 8, n == 1024, A2, B2, ref);
+    }
+
     // (b) Knapsack: N = C = 1024
     const int K_N = 1024, K_C = 1024;
     std::vector<int> w(K_N), v(K_N), m_seq((K_N + 1) * (K_C + 1), 0), m_omp((K_N + 1) * (K_C + 1), 0);
-    for (int i = 0; i < K_N; ++i)
-    {
-        w[i] = int_dis(gen);
-        v[i] = int_dis(gen);
-    }
+    rng::fill_uniform(w, 1, 100, 3);
+    rng::fill_uniform(v, 1, 100, 4);
 
     // Sequential Knapsack
-    start_seq = std::chrono::high_resolution_clock::now();
+    timer.restart();
     knapsack_sequential(w.data(), v.data(), m_seq.data(), K_N, K_C);
-    end_seq = std::chrono::high_resolution_clock::now();
-    time_seq = std::chrono::duration<double>(end_seq - start_seq).count();
+    time_seq = timer.seconds();
     std::cout << "Sequential Knapsack Result: " << m_seq[AT(K_N, K_C, K_C)] << "\n";
     std::cout << "Sequential Knapsack Time: " << time_seq << " seconds\n";
 
     // OpenMP Knapsack
-    start_omp = std::chrono::high_resolution_clock::now();
+    timer.restart();
     knapsack_openmp(w.data(), v.data(), m_omp.data(), K_N, K_C);
-    end_omp = std::chrono::high_resolution_clock::now();
-    time_omp = std::chrono::duration<double>(end_omp - start_omp).count();
+    time_omp = timer.seconds();
     std::cout << "OpenMP Knapsack Result: " << m_omp[AT(K_N, K_C, K_C)] << "\n";
     std::cout << "OpenMP Knapsack Time: " << time_omp << " seconds\n";
 
+    // Rolling row on the same input must give m_seq[AT(K_N, K_C, K_C)]
+    std::vector<int> m_row(K_C + 1);
+    knapsack_rolling(w.data(), v.data(), m_row.data(), K_N, K_C);
+    std::cout << "Rolling Knapsack Result: " << m_row[K_C] << "\n";
+    if (m_row[K_C] != m_seq[AT(K_N, K_C, K_C)])
+        std::cout << "WARNING: Rolling knapsack result differs\n";
+
+    // Memory and runtime of the table and rolling modes ("items" = O(C) item reconstruction)
+    std::cout << "\n       N         C       mode  memory (MiB)      time (s)       value\n";
+    knapsack_memory_comparison(1024, 1024, 110, 1e9);
+    knapsack_memory_comparison(1024, 65536, 120, 1e9);
+    knapsack_memory_comparison(100000, 1000000, 130, 1e9);
+
+    // Sequential table vs per-item OpenMP vs rolling vs wavefront, growing C
+    std::cout << "\n       N         C    sequential        openmp       rolling     wavefront  vs seq\n";
+    for (int c : {1024, 10000, 100000, 1000000})
+        knapsack_parallel_comparison(1024, c, 140, 1e9);
+    knapsack_thread_sweep(10000, 1000000, 150);
+
+    // Sparse frontier vs dense row: small weights favour the row, large integer weights the
+    // frontier, and at C = 10^9 only the frontier is possible
+    std::cout << "\n     N           C     max w       dense      sparse  frontier  chosen        auto     value\n";
+    knapsack_sparse_comparison(1024, 1024, 100, 160);
+    knapsack_sparse_comparison(1024, 100000, 100, 170);
+    knapsack_sparse_comparison(200, 1000000, 100000, 180);
+    knapsack_sparse_comparison(1000, 10000000, 1000000, 190);
+    knapsack_sparse_comparison(2000, 1000000000, 10000000, 200);
+
     return 0;
 }
 
@@ -167,6 +609,14 @@ Dense Matrix Multiplication (N = M = L = 256):
   The ~3.69x speedup indicates effective parallelization, leveraging multiple cores (likely 4–8).
   The algorithm is embarrassingly parallel, with minimal overhead, explaining the strong performance.
 
+Matrix Layouts:
+- matrix_multiply_layout runs under any layout::Descriptor of C (common/layout.hpp); the OpenMP
+  i-loop split above is the 1D block-rows case. With 8 workers (medians, 1 core), the SIMD path at
+  n = 1024 takes 0.107 s on 1D block rows, 0.090 s on a 2x4 block grid and 0.086 s on a 2x4 grid
+  of 128x128 blocks: each worker packs N / 4 columns of B instead of all of them. One-row cyclic
+  blocks take 1.72 s, since every row repacks a panel of B. The naive loop at n = 512 stays within
+  noise (0.24-0.32 s) across layouts.
+
 Pseudo-Polynomial Knapsack (N = C = 1024):
 - Sequential Time: 0.00579259 seconds
 - OpenMP Time: 0.0817717 seconds
@@ -178,4 +628,35 @@ Pseudo-Polynomial Knapsack (N = C = 1024):
   and non-contiguous memory accesses (m[AT(i-1,j-w[i-1])]), causing cache misses or false sharing.
   The small problem size (N = C = 1024) and low computational intensity make parallelization inefficient.
   Potential improvements include increasing problem size or optimizing memory access patterns.
+
+O(C)-Memory Knapsack:
+- knapsack_rolling keeps one row of C + 1 values and folds each item in back to front, 8 capacities
+  per _mm256_max_epi32; it matches m_seq[AT(N, C, C)].
+- N = 1024, C = 65536: table 256 MiB / 0.135 s, rolling 0.25 MiB / 0.0098 s (the table mode is
+  bound by writing 256 MiB, the rolling row stays in cache).
+- N = 10^5, C = 10^6: the table would need 373 GiB; rolling takes 3.8 MiB and 21.6 s, and the
+  Hirschberg-style item reconstruction 7.6 MiB and 35 s. The recovered items reach the same value.
+
+Wavefront Knapsack:
+- knapsack_openmp opens a parallel region per item and runs over the whole table every time.
+  knapsack_wavefront enters the team once; each thread owns a fixed capacity slab of the rolling
+  row, copies the top w_i values of its slab into a halo for its right neighbour before folding
+  item i, and hands over tiles of 64 items through one progress flag per thread (no barriers).
+- N = 1024 (1 core sandbox): 11x faster than knapsack_sequential at C = 1024, 13x at C = 10^4,
+  11x at C = 10^5; at C = 10^6 the table (4 GiB) is skipped, rolling 0.21 s, wavefront 0.20 s.
+- Thread sweep at N = 10^4, C = 10^6 on the single core still improves (1.97 s -> 1.21 s at 16
+  threads): a tile of 64 items stays inside a slab of C / T capacities, which fits in L2, whereas
+  one thread streams the whole 4 MB row once per item. With real cores the slabs also run
+  concurrently; the wavefront lag between neighbours is at most two tiles.
+
+Sparse Knapsack:
+- knapsack_sparse keeps only the Pareto frontier of (weight, value) pairs and merges it with its
+  shifted copy in one two-pointer pass per item, so its cost follows the frontier size, not C.
+- knapsack_auto estimates both costs (C + 1 - w_i capacities per item vs at most
+  min(2^i, C + 1, sum v + 1) pairs) and picked the faster engine in every case measured:
+  dense for w <= 100 (C = 1024, 10^5); sparse for w up to 10^5 at C = 10^6 (22x faster),
+  w up to 10^6 at C = 10^7 (0.028 s vs 2.88 s), and C = 10^9, where the dense row would take 4 GB
+  (0.46 s, frontier of 30591 pairs).
+- Inputs now come from rng::fill_uniform with fixed seeds (counter-based Philox), so these numbers
+  are for the same w and v on every run and at any thread count.
   */
\ No newline at end of file
@@ -1,27 +1,31 @@
 #include <vector>
 #include <random>
 #include <iostream>
-#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <algorithm>
+#include "../common/random.hpp"
+#include "../common/vec4.hpp"
+#include "../common/vector_ops.hpp"
+#include "../common/stream.hpp"
+#include "../common/reduce.hpp"
+#include "../common/bench.hpp"
+#include "../common/memory.hpp"
+#include <memory>
 
 // Problem 1: Add two vectors of size 2^24
 void problem1_cpp()
 {
     const size_t size = 1 << 24; // 2^24
-    std::vector<float> a(size);
-    std::vector<float> b(size);
-    std::vector<float> c(size);
+    // 64 MB each: mem::vector aligns them to 2 MB and asks for transparent huge pages
+    mem::vector<float> a(size);
+    mem::vector<float> b(size);
+    mem::vector<float> c(size);
 
-    // Random number generation
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> dis(-1.0, 1.0);
-
-    // Fill vectors a and b with random values
-    for (size_t i = 0; i < size; ++i)
-    {
-        a[i] = dis(gen);
-        b[i] = dis(gen);
-    }
+    // Fill vectors a and b with random values (counter-based, vectorized and multithreaded)
+    rng::fill_uniform(a, -1.0f, 1.0f, 1);
+    rng::fill_uniform(b, -1.0f, 1.0f, 2);
 
     // Add vectors a and b element-wise into c, performed sequentially in a loop.
     // On a single-core CPU, this operation will take time proportional to the problem size.
@@ -38,29 +42,17 @@ void problem1_cpp()
 }
 
 // Problem 2: Normalize 2^22 4D vectors
-struct Vec4
-{
-    float x, y, z, w;
-};
+using vec4::Vec4;
 
 void problem2_cpp()
 {
     const size_t size = 1 << 22; // 2^22
     std::vector<Vec4> vec(size);
 
-    // Random number generation
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> dis(-1.0, 1.0);
-
-    // Fill the vector with random 4D vectors and normalize each
+    // Fill the vector with random 4D vectors (x, y, z, w are consecutive floats), then normalize each
+    rng::fill_uniform(reinterpret_cast<float *>(vec.data()), 4 * size, -1.0f, 1.0f, 3);
     for (size_t i = 0; i < size; ++i)
     {
-        vec[i].x = dis(gen);
-        vec[i].y = dis(gen);
-        vec[i].z = dis(gen);
-        vec[i].w = dis(gen);
-
         // Compute the Euclidean norm and normalize each vector, computation for each vector is done sequentially in a loop.
         // This is a computationally expensive on the CPU because the task is done element by element.
 
@@ -84,23 +76,435 @@ void problem2_cpp()
 // Measure CPU time for a function
 void measureCPU(void (*func)(), const std::string &label)
 {
-    auto start = std::chrono::high_resolution_clock::now();
+    bench::Timer timer(label);
     func();
-    auto end = std::chrono::high_resolution_clock::now();
+    timer.report();
+}
+
+// Time the old mt19937 fill against fill_uniform on 1 and all threads, and check that the
+// counter-based fill is bit-identical for every thread count
+void fillComparison()
+{
+    const size_t size = 1 << 24;
+    std::vector<float> ref(size), out(size);
+    auto gbps = [&](double ms)
+    { return size * sizeof(float) / (ms * 1e6); };
+
+    bench::Timer timer("mt19937");
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<> dis(-1.0, 1.0);
+    for (size_t i = 0; i < size; ++i)
+        ref[i] = dis(gen);
+    double mt = timer.seconds() * 1e3;
+    std::cout << "Fill 2^24 floats, mt19937:              " << mt << " ms (" << gbps(mt) << " GB/s)\n";
+
+    rng::fill_uniform(ref, -1.0f, 1.0f, 1, 1);
+    for (int threads : {1, 2, 4, 8})
+    {
+        timer.restart();
+        rng::fill_uniform(out, -1.0f, 1.0f, 1, threads);
+        double t = timer.seconds() * 1e3;
+        bool same = std::memcmp(ref.data(), out.data(), size * sizeof(float)) == 0;
+        std::cout << "Fill 2^24 floats, fill_uniform, " << threads << " thr: " << t << " ms ("
+                  << gbps(t) << " GB/s), " << (same ? "identical" : "DIFFERENT") << "\n";
+    }
+}
 
-    std::chrono::duration<double, std::milli> duration = end - start;
-    std::cout << label << " execution time: " << duration.count() << " ms\n";
+// Best of `reps` runs of fn, in ms
+template <typename F>
+double bestOf(int reps, F fn)
+{
+    double best = 1e30;
+    for (int r = 0; r < reps; r++)
+    {
+        bench::Timer timer("best_of");
+        fn();
+        best = std::min(best, timer.seconds() * 1e3);
+    }
+    return best;
 }
-int main()
+
+// Normalize n random 4D vectors: AoS scalar (sqrt + 4 divides) against the AoSoA Vec4Array with
+// rsqrt + Newton-Raphson on 1..max_threads threads. Reports vectors/s, the AoS <-> AoSoA
+// conversion cost and the largest relative error against the scalar path.
+void vec4Comparison(size_t n, int max_threads)
 {
+    std::vector<Vec4> aos(n), ref(n), back(n);
+    rng::fill_uniform(reinterpret_cast<float *>(aos.data()), 4 * n, -1.0f, 1.0f, 3);
+    // A few zero vectors exercise the mask
+    for (size_t i = 0; i < n; i += 4099)
+        aos[i] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+    ref = aos;
+    double scalar = bestOf(3, [&]
+                           {
+                               for (size_t i = 0; i < n; ++i)
+                                   vec4::normalizeScalar(ref[i]);
+                           });
+    // Normalizing an already unit vector is not free of rounding: the reference is one pass
+    ref = aos;
+    for (size_t i = 0; i < n; ++i)
+        vec4::normalizeScalar(ref[i]);
+
+    auto rate = [&](double ms)
+    { return n / (ms * 1e3); };
+    std::cout << "\nNormalize " << n << " Vec4\n"
+              << " layout   threads   normalize (ms)   Mvectors/s   to AoSoA (ms)   to AoS (ms)   max rel err\n";
+    std::cout << std::setw(7) << "AoS" << std::setw(10) << 1 << std::setw(17) << scalar << std::setw(13) << rate(scalar)
+              << std::setw(16) << "-" << std::setw(14) << "-" << std::setw(14) << "-" << "\n";
+
+    for (int threads = 1; threads <= max_threads; threads *= 2)
+    {
+        pool::ThreadPool tp(threads);
+        vec4::Vec4Array soa(n);
+        double to_soa = bestOf(3, [&] { vec4::fromAoS(tp, aos.data(), soa); });
+        double normalize = bestOf(3, [&] { vec4::normalize(tp, soa); });
+        vec4::fromAoS(tp, aos.data(), soa);
+        vec4::normalize(tp, soa);
+        double to_aos = bestOf(3, [&] { vec4::toAoS(tp, soa, back.data()); });
+
+        double max_err = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            const float *a = &back[i].x, *b = &ref[i].x;
+            for (int c = 0; c < 4; c++)
+                if (b[c] != 0.0f)
+                    max_err = std::max(max_err, std::fabs(double(a[c]) - b[c]) / std::fabs(double(b[c])));
+                else if (a[c] != 0.0f)
+                    max_err = 1.0;
+        }
+        std::cout << std::setw(7) << "AoSoA" << std::setw(10) << threads << std::setw(17) << normalize
+                  << std::setw(13) << rate(normalize) << std::setw(16) << to_soa << std::setw(14) << to_aos
+                  << std::setw(14) << max_err << (max_err <= vec4::NORMALIZE_TOLERANCE ? "" : "  ABOVE TOLERANCE") << "\n";
+    }
+}
+
+// Problem 1 as problem1_cuda does it: uniform [0, 1), scaleKernel to [-1, 1), addVectors
+template <typename Backend>
+float problem1_backend(Backend &be, float *a, float *b, float *c, size_t size)
+{
+    be.generateUniform(a, size, 1234);
+    be.generateUniform(b, size, 1235);
+    vops::Grid grid = vops::gridFor(size, 256);
+    vops::scaleKernel(be, grid, a, size, 2.0f, -1.0f);
+    vops::scaleKernel(be, grid, b, size, 2.0f, -1.0f);
+    vops::addVectors(be, grid, a, b, c, size);
+    be.synchronize();
+    return c[0];
+}
+
+// Problem 2 as problem2_cuda does it, generating straight into the float4 array (on the host the
+// device-to-device copy from a flat buffer is not needed)
+template <typename Backend>
+Vec4 problem2_backend(Backend &be, Vec4 *vec, size_t size)
+{
+    float *data = reinterpret_cast<float *>(vec);
+    be.generateUniform(data, 4 * size, 1234);
+    vops::scaleKernel(be, vops::gridFor(4 * size, 256), data, 4 * size, 2.0f, -1.0f);
+    vops::normalizeVectors(be, vops::gridFor(size, 256), vec, size);
+    be.synchronize();
+    return vec[0];
+}
+
+// Problems 1 and 2 on the CPU backend: the first (cold) run includes the page faults of fresh
+// buffers, as the CUDA timing includes cudaMalloc; warm runs reuse them. GB/s counts every
+// kernel's reads and writes: 36 bytes per element for Problem 1 (generate 8, scale 16, add 12),
+// 80 bytes per vector for Problem 2 (generate 16, scale 32, normalize 32).
+void backendBenchmark(int max_threads)
+{
+    const size_t size1 = 1 << 24, size2 = 1 << 22;
+    const double bytes1 = 36.0 * size1, bytes2 = 80.0 * size2;
+    const double gpu1 = 3.9095, gpu2 = 3.15635; // vector_ops_cuda.cu
+
+    std::cout << "\nCPU backend (vops::CpuBackend) vs recorded GPU times\n"
+              << "problem  threads   cold (ms)   warm (ms)     GB/s   GPU (ms)   GPU GB/s\n";
+    for (int threads = 1; threads <= max_threads; threads *= 2)
+    {
+        vops::CpuBackend be(threads);
+        {
+            std::vector<float> a, b, c;
+            double cold = bestOf(1, [&]
+                                 {
+                                     a.resize(size1);
+                                     b.resize(size1);
+                                     c.resize(size1);
+                                     problem1_backend(be, a.data(), b.data(), c.data(), size1);
+                                 });
+            double warm = bestOf(5, [&] { problem1_backend(be, a.data(), b.data(), c.data(), size1); });
+            std::cout << std::setw(7) << 1 << std::setw(9) << threads << std::setw(12) << cold << std::setw(12) << warm
+                      << std::setw(9) << bytes1 / (warm * 1e6) << std::setw(11) << gpu1 << std::setw(11) << bytes1 / (gpu1 * 1e6) << "\n";
+        }
+        {
+            std::vector<Vec4> vec;
+            double cold = bestOf(1, [&]
+                                 {
+                                     vec.resize(size2);
+                                     problem2_backend(be, vec.data(), size2);
+                                 });
+            double warm = bestOf(5, [&] { problem2_backend(be, vec.data(), size2); });
+            std::cout << std::setw(7) << 2 << std::setw(9) << threads << std::setw(12) << cold << std::setw(12) << warm
+                      << std::setw(9) << bytes2 / (warm * 1e6) << std::setw(11) << gpu2 << std::setw(11) << bytes2 / (gpu2 * 1e6) << "\n";
+        }
+    }
+
+    // Same results as the sequential loops on the same inputs; launch semantics on a short grid
+    vops::CpuBackend be(max_threads);
+    std::vector<float> a(size1), b(size1), c(size1);
+    problem1_backend(be, a.data(), b.data(), c.data(), size1);
+    bool add_ok = true;
+    for (size_t i = 0; i < size1; ++i)
+        add_ok = add_ok && c[i] == a[i] + b[i] && a[i] >= -1.0f && a[i] < 1.0f;
+
+    std::vector<Vec4> vec(size2), ref;
+    problem2_backend(be, vec.data(), size2);
+    ref.resize(size2);
+    rng::fill_uniform(reinterpret_cast<float *>(ref.data()), 4 * size2, 0.0f, 1.0f, 1234);
+    double max_err = 0;
+    for (size_t i = 0; i < size2; ++i)
+    {
+        float *r = &ref[i].x, *v = &vec[i].x;
+        for (int k = 0; k < 4; k++)
+            r[k] = std::fma(r[k], 2.0f, -1.0f);
+        vec4::normalizeScalar(ref[i]);
+        for (int k = 0; k < 4; k++)
+            if (r[k] != 0.0f)
+                max_err = std::max(max_err, std::fabs(double(v[k]) - r[k]) / std::fabs(double(r[k])));
+    }
+
+    std::vector<float> d(1000, 1.0f);
+    vops::scaleKernel(be, {3, 256}, d.data(), d.size(), 2.0f, 0.0f); // ids 0..767 only
+    bool grid_ok = d[767] == 2.0f && d[768] == 1.0f;
+    std::cout << "add exact: " << (add_ok ? "yes" : "NO") << ", normalize max rel err vs scalar: " << max_err
+              << ", short grid leaves the tail: " << (grid_ok ? "yes" : "NO") << "\n";
+}
+
+struct AddSlot
+{
+    std::vector<float> a, b, c;
+};
+
+struct NormalizeSlot
+{
+    std::vector<Vec4> v;
+};
+
+// Problem 1 streamed: a and b generated chunk by chunk, c = a + b, c reduced to its sum.
+// Only `slots` chunks of (a, b, c) exist at any time.
+double problem1_stream(size_t size, size_t chunk, size_t slots, stream::Stats &st)
+{
+    std::vector<AddSlot> ring(slots, AddSlot{std::vector<float>(chunk), std::vector<float>(chunk), std::vector<float>(chunk)});
+    auto length = [&](size_t k)
+    { return std::min(chunk, size - k * chunk); };
+    double sum = 0;
+    st = stream::run(
+        ring, (size + chunk - 1) / chunk,
+        [&](size_t k, AddSlot &s)
+        {
+            rng::fillRange(s.a.data(), k * chunk, k * chunk + length(k), -1.0f, 1.0f, 1);
+            rng::fillRange(s.b.data(), k * chunk, k * chunk + length(k), -1.0f, 1.0f, 2);
+        },
+        [&](size_t k, AddSlot &s)
+        { vops::AddKernel{s.a.data(), s.b.data(), s.c.data(), length(k)}(0, length(k)); },
+        [&](size_t k, AddSlot &s)
+        { sum += reduce::sum(s.c.data(), length(k)); });
+    return sum;
+}
+
+// Problem 2 streamed: vectors generated, normalized and reduced (sum of all components) per chunk
+double problem2_stream(size_t size, size_t chunk, size_t slots, stream::Stats &st)
+{
+    std::vector<NormalizeSlot> ring(slots, NormalizeSlot{std::vector<Vec4>(chunk)});
+    auto length = [&](size_t k)
+    { return std::min(chunk, size - k * chunk); };
+    double sum = 0;
+    st = stream::run(
+        ring, (size + chunk - 1) / chunk,
+        [&](size_t k, NormalizeSlot &s)
+        { rng::fillRange(&s.v[0].x, 4 * k * chunk, 4 * (k * chunk + length(k)), -1.0f, 1.0f, 3); },
+        [&](size_t k, NormalizeSlot &s)
+        { vops::NormalizeKernel{s.v.data(), length(k)}(0, length(k)); },
+        [&](size_t k, NormalizeSlot &s)
+        { sum += reduce::sum(&s.v[0].x, 4 * length(k)); });
+    return sum;
+}
+
+// Streamed vs materialized Problems 1 and 2: same inputs (same Philox streams) and the same
+// chunked reduction order, so the sums must match exactly. Peak memory is the bytes held by
+// the data buffers; GB/s counts the elements produced and consumed once (12 bytes per element
+// for Problem 1, 16 per vector for Problem 2), i.e. what a stream through memory would move.
+void streamComparison(size_t size1, size_t size2, size_t slots, bool materialize)
+{
+    const size_t chunk1 = stream::chunkFor(3 * sizeof(float)), chunk2 = stream::chunkFor(sizeof(Vec4));
+    auto report = [&](const char *label, size_t n, double bytes, double seconds, double peak, double sum)
+    {
+        std::cout << std::setw(24) << label << std::setw(12) << n << std::setw(11) << seconds * 1e3 << std::setw(10)
+                  << bytes / (seconds * 1e9) << std::setw(13) << peak / (1 << 20) << std::setw(22) << std::setprecision(15) << sum
+                  << std::setprecision(6) << "\n";
+    };
+    auto stages = [](const stream::Stats &st)
+    {
+        std::cout << std::setw(24) << "" << "  stage busy (ms): generate " << st.generate * 1e3 << ", compute "
+                  << st.compute * 1e3 << ", consume " << st.consume * 1e3 << "\n";
+    };
+
+    std::cout << "\nStreaming pipeline (" << slots << " slots, chunks of " << chunk1 << " floats / " << chunk2
+              << " Vec4, L2 " << stream::l2Bytes() / 1024 << " KiB)\n"
+              << "                    mode           n     time ms      GB/s  peak (MiB)                   sum\n";
+    if (materialize)
+    {
+        std::vector<float> a(size1), b(size1), c(size1);
+        bench::Timer timer("problem1_materialized");
+        rng::fill_uniform(a, -1.0f, 1.0f, 1);
+        rng::fill_uniform(b, -1.0f, 1.0f, 2);
+        vops::AddKernel{a.data(), b.data(), c.data(), size1}(0, size1);
+        double sum = 0;
+        for (size_t k = 0; k * chunk1 < size1; k++)
+            sum += reduce::sum(c.data() + k * chunk1, std::min(chunk1, size1 - k * chunk1));
+        report("problem 1, materialized", size1, 12.0 * size1, timer.seconds(), 12.0 * size1, sum);
+    }
+    stream::Stats st;
+    bench::Timer timer("problem1_streamed");
+    double sum = problem1_stream(size1, chunk1, slots, st);
+    report("problem 1, streamed", size1, 12.0 * size1, timer.seconds(), 12.0 * chunk1 * slots, sum);
+    stages(st);
+
+    if (materialize)
+    {
+        std::vector<Vec4> v(size2);
+        bench::Timer timer("problem2_materialized");
+        rng::fill_uniform(&v[0].x, 4 * size2, -1.0f, 1.0f, 3);
+        vops::NormalizeKernel{v.data(), size2}(0, size2);
+        double sum = 0;
+        for (size_t k = 0; k * chunk2 < size2; k++)
+            sum += reduce::sum(&v[k * chunk2].x, 4 * std::min(chunk2, size2 - k * chunk2));
+        report("problem 2, materialized", size2, 16.0 * size2, timer.seconds(), 16.0 * size2, sum);
+    }
+    timer.restart();
+    sum = problem2_stream(size2, chunk2, slots, st);
+    report("problem 2, streamed", size2, 16.0 * size2, timer.seconds(), 16.0 * chunk2 * slots, sum);
+    stages(st);
+}
+
+// Statistical runs of every kernel of this lab (--bench, see common/bench.hpp). A size n is the
+// number of floats: n for Problem 1, n / 4 vectors for Problem 2. Bytes follow the GB/s
+// conventions of the comparisons above.
+int runBenchmarks(bench::Suite &suite)
+{
+    const std::vector<long long> threads = suite.threads({1, 2, 4, 8});
+    for (long long n : suite.sizes({1 << 24}))
+    {
+        const size_t size1 = n, size2 = n / 4;
+        auto a = std::make_shared<mem::vector<float>>(size1), b = std::make_shared<mem::vector<float>>(size1);
+        auto c = std::make_shared<mem::vector<float>>(size1);
+        auto src = std::make_shared<std::vector<Vec4>>(size2), vec = std::make_shared<std::vector<Vec4>>(size2);
+        auto soa = std::make_shared<vec4::Vec4Array>(size2);
+        rng::fill_uniform(*a, -1.0f, 1.0f, 1);
+        rng::fill_uniform(*b, -1.0f, 1.0f, 2);
+        rng::fill_uniform(reinterpret_cast<float *>(src->data()), 4 * size2, -1.0f, 1.0f, 3);
+
+        suite.add("problem1 loop", {{"n", n}, {"threads", 1}}, {double(size1), 12.0 * size1}, [=]
+                  {
+                      for (size_t i = 0; i < size1; ++i)
+                          (*c)[i] = (*a)[i] + (*b)[i];
+                  });
+        suite.add(bench::Case{"problem2 loop", {{"n", n}, {"threads", 1}}, {11.0 * size2, 32.0 * size2}, 0,
+                              [=] { std::memcpy(vec->data(), src->data(), size2 * sizeof(Vec4)); },
+                              [=]
+                              {
+                                  for (size_t i = 0; i < size2; ++i)
+                                      vec4::normalizeScalar((*vec)[i]);
+                              }});
+        for (long long t : threads)
+        {
+            const int nt = static_cast<int>(t);
+            suite.add("rng::fill_uniform", {{"n", n}, {"threads", t}}, {0, 4.0 * size1}, [=]
+                      { rng::fill_uniform(*c, -1.0f, 1.0f, 1, nt); });
+
+            auto tp = std::make_shared<pool::ThreadPool>(nt);
+            suite.add(bench::Case{"vec4::normalize", {{"n", n}, {"threads", t}}, {11.0 * size2, 32.0 * size2}, 0,
+                                  [=] { vec4::fromAoS(*tp, src->data(), *soa); },
+                                  [=] { vec4::normalize(*tp, *soa); }});
+
+            auto be = std::make_shared<vops::CpuBackend>(nt);
+            suite.add("problem1_backend", {{"n", n}, {"threads", t}}, {3.0 * size1, 36.0 * size1}, [=]
+                      { problem1_backend(*be, a->data(), b->data(), c->data(), size1); });
+            suite.add("problem2_backend", {{"n", n}, {"threads", t}}, {19.0 * size2, 80.0 * size2}, [=]
+                      { problem2_backend(*be, vec->data(), size2); });
+        }
+
+        // The add loop of each instruction set this CPU has
+        for (isa::Level level : {isa::Level::Scalar, isa::Level::AVX2, isa::Level::AVX512})
+            if (isa::supports(level))
+                suite.add(std::string("vops::add ") + isa::name(level), {{"n", n}, {"threads", 1}}, {double(size1), 12.0 * size1},
+                          [=] { vops::addVariants().at(level)(a->data(), b->data(), c->data(), 0, size1); });
+
+        // The pipeline always runs three stage threads
+        const size_t chunk1 = stream::chunkFor(3 * sizeof(float)), chunk2 = stream::chunkFor(sizeof(Vec4));
+        suite.add("problem1_stream", {{"n", n}, {"slots", 4}}, {double(size1), 12.0 * size1}, [=]
+                  {
+                      stream::Stats st;
+                      problem1_stream(size1, chunk1, 4, st);
+                  });
+        suite.add("problem2_stream", {{"n", n}, {"slots", 4}}, {11.0 * size2, 16.0 * size2}, [=]
+                  {
+                      stream::Stats st;
+                      problem2_stream(size2, chunk2, 4, st);
+                  });
+    }
+    return suite.run();
+}
+
+int main(int argc, char **argv)
+{
+    bench::Suite suite("Lab8", argc, argv);
+    if (suite.requested())
+        return runBenchmarks(suite);
+
+    std::cout << "\nSIMD path: " << isa::describe() << "\n";
+    fillComparison();
     problem1_cpp();
     problem2_cpp();
     measureCPU(problem1_cpp, "Problem 1");
     measureCPU(problem2_cpp, "Problem 2");
+    vec4Comparison(1 << 14, 1);
+    vec4Comparison(1 << 22, 8);
+    vec4Comparison(1 << 24, 8);
+    backendBenchmark(8);
+    streamComparison(1 << 24, 1 << 22, 4, true);
+    // 2^30 floats per vector: 12 GiB if materialized, more than this machine has
+    streamComparison(size_t(1) << 30, size_t(1) << 28, 4, false);
     return 0;
 }
 
 /*
  * Problem 1 execution time: 4891.6 ms
  * Problem 2 execution time: 2475.75 ms
+ *
+ * With rng::fill_uniform instead of mt19937 + uniform_real_distribution (g++ -O3, 1 core):
+ * Fill 2^24 floats, mt19937:       144.7 ms (0.46 GB/s)
+ * Fill 2^24 floats, fill_uniform:  19.0 ms (3.5 GB/s), bit-identical on 1, 2, 4 and 8 threads
+ * Problem 1 execution time: 702.8 ms -> 193.3 ms
+ * Problem 2 execution time: 325.3 ms -> 68.7 ms
+ *
+ * Normalization, AoS scalar (sqrt + 4 divides) vs vec4::Vec4Array (AoSoA, rsqrt + 1 Newton step):
+ * 2^14 vectors (in cache): 440 -> 1429 Mvectors/s
+ * 2^22 vectors:            318 -> 463 Mvectors/s, conversion 13.2 ms to AoSoA, 12.3 ms back
+ * 2^24 vectors:            334 -> 442 Mvectors/s (516 on 2 pool threads)
+ * Max relative error vs the scalar path 4.0e-7, within NORMALIZE_TOLERANCE = 4 FLT_EPSILON.
+ * Out of cache the kernel is bound by moving 64 bytes per vector; in cache it is 3.2x faster.
+ *
+ * vops::CpuBackend (same kernels and launch grids as vector_ops_cuda.cu, pool + AVX2, 1 core):
+ * Problem 1: 153.6 ms cold, 63.6 ms warm (9.5 GB/s)  vs GPU 3.91 ms (154 GB/s)
+ * Problem 2:  62.5 ms cold, 28.9 ms warm (11.6 GB/s) vs GPU 3.16 ms (106 GB/s)
+ * Both are DRAM-bound on the CPU; 2, 4 and 8 pool threads on the one core stay within 15%.
+ *
+ * Streaming pipeline (stream::run, 4 slots of L2/2, generate | compute | consume threads):
+ * Problem 1, 2^24: materialized 56.2 ms / 192 MiB, streamed 50.3 ms / 4 MiB, same sum
+ * Problem 2, 2^22: materialized 37.3 ms / 64 MiB,  streamed 31.4 ms / 4 MiB, same sum
+ * Problem 1, 2^30 (12 GiB if materialized): streamed 3.14 s (4.1 GB/s) in 4 MiB
+ * Philox generation is ~70% of the stage busy time; on one core the stages take turns.
+ *
+ * Runtime SIMD dispatch (common/isa.hpp): vops add / scale pick scalar, AVX2+FMA or AVX-512 once
+ * from cpuid. All three give bit-identical results (isa_check.cpp). Add over 2^24 floats, 1 thread:
+ * scalar 19.0 ms, avx2+fma 19.1 ms, avx512 17.7 ms; it is bound by memory, not by the ISA.
  */
\ No newline at end of file
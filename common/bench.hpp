@@ -0,0 +1,354 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "isa.hpp"
+#include "perf.hpp"
+
+// Statistical benchmarks for the lab kernels.
+//
+// A single cold run mixes the kernel with page faults, frequency ramp-up and whatever else the
+// machine was doing, and says nothing about how repeatable the number is. A bench::Suite holds
+// registered kernels (name, numeric parameters, declared FLOP and byte counts, an untimed setup
+// and the timed body); run() does warmup runs, then repeated timed runs, and reports median, p95,
+// mean, standard deviation and min, with GFLOP/s and GB/s derived from the median. Every lab's
+// main hands `--bench ...` to its suite, so one binary keeps both the walkthrough and the
+// benchmark. Results go to a table on stdout and optionally to JSON / CSV for regression tracking.
+//
+//   --bench                 run the registered kernels instead of the walkthrough
+//   --list                  print the registered names and parameters only
+//   --filter SUBSTR         only kernels whose name contains SUBSTR
+//   --warmup N, --reps N    untimed and timed runs per kernel (--reps overrides per-kernel caps)
+//   --sizes a,b,c           size sweep, for suites that sweep a size
+//   --threads a,b,c         thread-count sweep, for suites that sweep threads
+//   --perf                  one more run per kernel under perf::Scope: IPC, MPKI, LLC bytes/FLOP
+//   --json FILE, --csv FILE write the results
+namespace bench
+{
+    using clock = std::chrono::steady_clock;
+
+    inline double secondsSince(clock::time_point start)
+    {
+        return std::chrono::duration<double>(clock::now() - start).count();
+    }
+
+    // One-shot wall-clock timer for the walkthrough paths in main
+    class Timer
+    {
+    public:
+        explicit Timer(std::string label) : label_(std::move(label)), start_(clock::now()) {}
+
+        double seconds() const { return secondsSince(start_); }
+
+        // Starts the next measurement on the same timer; returns the seconds up to now
+        double restart()
+        {
+            clock::time_point now = clock::now();
+            double t = std::chrono::duration<double>(now - start_).count();
+            start_ = now;
+            return t;
+        }
+
+        // Prints "<label> took <t> ms" and returns the seconds
+        double report(std::ostream &os = std::cout) const
+        {
+            double t = seconds();
+            os << label_ << " took " << t * 1e3 << " ms" << std::endl;
+            return t;
+        }
+
+    private:
+        std::string label_;
+        clock::time_point start_;
+    };
+
+    struct Param
+    {
+        std::string name;
+        long long value;
+    };
+
+    using Params = std::vector<Param>;
+
+    // Work done by one run, used to derive rates from the measured time
+    struct Work
+    {
+        double flops = 0;
+        double bytes = 0;
+    };
+
+    struct Case
+    {
+        std::string name;
+        Params params;
+        Work work;
+        int reps = 0;                // timed runs; 0 = the suite default
+        std::function<void()> setup; // untimed, before every run (may be empty)
+        std::function<void()> run;   // timed
+    };
+
+    struct Stats
+    {
+        int reps = 0;
+        double median = 0, p95 = 0, mean = 0, stddev = 0, min = 0, max = 0;
+    };
+
+    inline Stats summarize(std::vector<double> t)
+    {
+        Stats s;
+        s.reps = static_cast<int>(t.size());
+        if (t.empty())
+            return s;
+        std::sort(t.begin(), t.end());
+        size_t n = t.size();
+        s.min = t.front();
+        s.max = t.back();
+        s.median = n % 2 ? t[n / 2] : 0.5 * (t[n / 2 - 1] + t[n / 2]);
+        s.p95 = t[std::min(n - 1, static_cast<size_t>(std::ceil(0.95 * n)) - 1)]; // nearest rank
+        double sum = 0;
+        for (double x : t)
+            sum += x;
+        s.mean = sum / n;
+        double sq = 0;
+        for (double x : t)
+            sq += (x - s.mean) * (x - s.mean);
+        s.stddev = n > 1 ? std::sqrt(sq / (n - 1)) : 0;
+        return s;
+    }
+
+    struct Result
+    {
+        std::string name;
+        Params params;
+        Work work;
+        Stats stats;
+        bool counted = false; // counters holds a --perf run
+        perf::Counts counters;
+
+        double gflops() const { return work.flops > 0 ? work.flops / stats.median * 1e-9 : 0; }
+        double gbps() const { return work.bytes > 0 ? work.bytes / stats.median * 1e-9 : 0; }
+    };
+
+    inline std::string paramString(const Params &params)
+    {
+        std::ostringstream os;
+        for (size_t i = 0; i < params.size(); i++)
+            os << (i ? " " : "") << params[i].name << "=" << params[i].value;
+        return os.str();
+    }
+
+    struct Options
+    {
+        bool bench = false, list = false, reps_given = false, perf = false;
+        int warmup = 1, reps = 10;
+        std::string filter, json, csv;
+        std::vector<long long> sizes, threads;
+    };
+
+    inline std::vector<long long> parseList(const std::string &s)
+    {
+        std::vector<long long> out;
+        std::stringstream ss(s);
+        for (std::string item; std::getline(ss, item, ',');)
+            if (!item.empty())
+                out.push_back(std::atoll(item.c_str()));
+        return out;
+    }
+
+    inline Options parseOptions(int argc, char **argv)
+    {
+        Options o;
+        for (int i = 1; i < argc; i++)
+        {
+            std::string a = argv[i];
+            bool more = i + 1 < argc;
+            if (a == "--bench")
+                o.bench = true;
+            else if (a == "--list")
+                o.bench = o.list = true;
+            else if (a == "--filter" && more)
+                o.filter = argv[++i];
+            else if (a == "--warmup" && more)
+                o.warmup = std::atoi(argv[++i]);
+            else if (a == "--reps" && more)
+            {
+                o.reps = std::max(1, std::atoi(argv[++i]));
+                o.reps_given = true;
+            }
+            else if (a == "--sizes" && more)
+                o.sizes = parseList(argv[++i]);
+            else if (a == "--threads" && more)
+                o.threads = parseList(argv[++i]);
+            else if (a == "--perf")
+                o.perf = true;
+            else if (a == "--json" && more)
+                o.json = argv[++i];
+            else if (a == "--csv" && more)
+                o.csv = argv[++i];
+            else
+                std::cerr << "bench: ignoring argument " << a << "\n";
+        }
+        return o;
+    }
+
+    inline void writeJson(const std::string &path, const std::string &suite, const std::vector<Result> &results)
+    {
+        std::ofstream os(path);
+        os << std::setprecision(9) << "{\n  \"suite\": \"" << suite << "\",\n  \"results\": [";
+        for (size_t r = 0; r < results.size(); r++)
+        {
+            const Result &x = results[r];
+            os << (r ? "," : "") << "\n    {\"name\": \"" << x.name << "\", \"params\": {";
+            for (size_t i = 0; i < x.params.size(); i++)
+                os << (i ? ", " : "") << "\"" << x.params[i].name << "\": " << x.params[i].value;
+            os << "}, \"reps\": " << x.stats.reps << ", \"median_s\": " << x.stats.median << ", \"p95_s\": " << x.stats.p95
+               << ", \"mean_s\": " << x.stats.mean << ", \"stddev_s\": " << x.stats.stddev << ", \"min_s\": " << x.stats.min
+               << ", \"max_s\": " << x.stats.max << ", \"flops\": " << x.work.flops << ", \"bytes\": " << x.work.bytes
+               << ", \"gflops\": " << x.gflops() << ", \"gbps\": " << x.gbps();
+            if (x.counted)
+            {
+                os << ", \"counters\": {";
+                for (int e = 0; e < perf::EVENT_COUNT; e++)
+                {
+                    os << (e ? ", " : "") << "\"" << perf::spec(perf::Event(e)).name << "\": ";
+                    if (x.counters.has(perf::Event(e)))
+                        os << x.counters.value[e];
+                    else
+                        os << "null";
+                }
+                os << "}";
+            }
+            os << "}";
+        }
+        os << "\n  ]\n}\n";
+    }
+
+    inline void writeCsv(const std::string &path, const std::string &suite, const std::vector<Result> &results)
+    {
+        std::ofstream os(path);
+        os << std::setprecision(9) << "suite,name,params,reps,median_s,p95_s,mean_s,stddev_s,min_s,max_s,flops,bytes,gflops,gbps";
+        for (int e = 0; e < perf::EVENT_COUNT; e++)
+            os << "," << perf::spec(perf::Event(e)).name;
+        os << "\n";
+        for (const Result &x : results)
+        {
+            os << suite << "," << x.name << "," << paramString(x.params) << "," << x.stats.reps << "," << x.stats.median << ","
+               << x.stats.p95 << "," << x.stats.mean << "," << x.stats.stddev << "," << x.stats.min << "," << x.stats.max << ","
+               << x.work.flops << "," << x.work.bytes << "," << x.gflops() << "," << x.gbps();
+            for (int e = 0; e < perf::EVENT_COUNT; e++) // empty when not counted or unavailable
+            {
+                os << ",";
+                if (x.counted && x.counters.has(perf::Event(e)))
+                    os << x.counters.value[e];
+            }
+            os << "\n";
+        }
+    }
+
+    class Suite
+    {
+    public:
+        Suite(std::string name, int argc, char **argv) : name_(std::move(name)), opt_(parseOptions(argc, argv)) {}
+
+        // True when the command line asked for benchmarks rather than the walkthrough
+        bool requested() const { return opt_.bench; }
+        const Options &options() const { return opt_; }
+
+        // The sweep values from the command line, or the suite's defaults
+        std::vector<long long> sizes(std::vector<long long> defaults) const { return opt_.sizes.empty() ? defaults : opt_.sizes; }
+        std::vector<long long> threads(std::vector<long long> defaults) const { return opt_.threads.empty() ? defaults : opt_.threads; }
+
+        void add(Case c) { cases_.push_back(std::move(c)); }
+
+        void add(std::string name, Params params, Work work, std::function<void()> run, int reps = 0)
+        {
+            add(Case{std::move(name), std::move(params), work, reps, nullptr, std::move(run)});
+        }
+
+        // Run the selected cases; returns the exit code for main
+        int run()
+        {
+            std::vector<Result> results;
+            std::cout << "Suite " << name_ << " (warmup " << opt_.warmup << ", SIMD " << isa::describe() << ")\n";
+            if (opt_.perf && !opt_.list)
+                perf::supported(); // the list of unavailable counters goes before the table
+            if (!opt_.list)
+                std::cout << std::left << std::setw(36) << "name" << std::setw(26) << "params" << std::right << std::setw(5) << "reps"
+                      << std::setw(13) << "median ms" << std::setw(13) << "p95 ms" << std::setw(11) << "stddev %"
+                      << std::setw(11) << "GFLOP/s" << std::setw(10) << "GB/s" << "\n";
+            for (Case &c : cases_)
+            {
+                if (!opt_.filter.empty() && c.name.find(opt_.filter) == std::string::npos)
+                    continue;
+                if (opt_.list)
+                {
+                    std::cout << std::left << std::setw(36) << c.name << paramString(c.params) << std::right << "\n";
+                    continue;
+                }
+                Result r{c.name, c.params, c.work, measure(c), false, {}};
+                std::cout << std::left << std::setw(36) << r.name << std::setw(26) << paramString(r.params) << std::right
+                          << std::setw(5) << r.stats.reps << std::setw(13) << r.stats.median * 1e3 << std::setw(13)
+                          << r.stats.p95 * 1e3 << std::setw(11) << 100.0 * r.stats.stddev / r.stats.mean << std::setw(11)
+                          << r.gflops() << std::setw(10) << r.gbps() << std::endl;
+                if (opt_.perf)
+                {
+                    double wall = count(c, r.counters);
+                    r.counted = true;
+                    std::cout << "    " << perf::summary(r.counters, r.work.flops) << " in " << wall * 1e3 << " ms wall"
+                              << std::endl;
+                }
+                results.push_back(r);
+            }
+            if (!opt_.json.empty())
+                writeJson(opt_.json, name_, results);
+            if (!opt_.csv.empty())
+                writeCsv(opt_.csv, name_, results);
+            return 0;
+        }
+
+    private:
+        Stats measure(Case &c) const
+        {
+            int reps = c.reps > 0 && !opt_.reps_given ? c.reps : opt_.reps;
+            std::vector<double> times;
+            for (int i = 0; i < opt_.warmup + reps; i++)
+            {
+                if (c.setup)
+                    c.setup();
+                auto start = clock::now();
+                c.run();
+                double t = secondsSince(start);
+                if (i >= opt_.warmup)
+                    times.push_back(t);
+            }
+            return summarize(times);
+        }
+
+        // One more (warm) run under counters for every thread of the process; returns its wall time
+        double count(Case &c, perf::Counts &counters) const
+        {
+            if (c.setup)
+                c.setup();
+            perf::Scope scope(perf::Scope::Process);
+            auto start = clock::now();
+            c.run();
+            double t = secondsSince(start);
+            scope.stop();
+            counters = scope.total();
+            return t;
+        }
+
+        std::string name_;
+        Options opt_;
+        std::vector<Case> cases_;
+    };
+}
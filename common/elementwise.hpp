@@ -0,0 +1,209 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <immintrin.h>
+#include <unistd.h>
+#include "isa.hpp"
+#include "layout.hpp"
+#include "thread_pool.hpp"
+
+// Fused elementwise expressions over contiguous double arrays.
+//
+// `alpha * (A - B) + D` builds a small expression tree at compile time instead of computing
+// temporaries; expr::assign then evaluates it in one pass, 4 doubles per AVX instruction, so a
+// chain of k operations costs one read of each input and one write of the output rather than k
+// full passes. When the output does not fit in the last-level cache it is written with
+// non-temporal (streaming) stores, which skip the read-for-ownership of the destination lines.
+// Every node has a scalar at(i) and an AVX2 load(i); assign evaluates through whichever of
+// evaluateScalar / evaluateAVX2 the CPU supports (common/isa.hpp).
+namespace expr
+{
+    template <typename E>
+    struct Expr
+    {
+        const E &self() const { return static_cast<const E &>(*this); }
+    };
+
+    // Leaf: a contiguous array
+    struct Array : Expr<Array>
+    {
+        static constexpr int arrays = 1;
+        const double *p;
+        explicit Array(const double *p) : p(p) {}
+        double at(size_t i) const { return p[i]; }
+        ISA_AVX2 __m256d load(size_t i) const { return _mm256_loadu_pd(p + i); }
+    };
+
+    // Leaf: a scalar broadcast to every element
+    struct Scalar : Expr<Scalar>
+    {
+        static constexpr int arrays = 0;
+        double v;
+        explicit Scalar(double v) : v(v) {}
+        double at(size_t) const { return v; }
+        ISA_AVX2 __m256d load(size_t) const { return _mm256_set1_pd(v); }
+    };
+
+    struct AddOp
+    {
+        static double apply(double a, double b) { return a + b; }
+        ISA_AVX2 static __m256d apply(__m256d a, __m256d b) { return _mm256_add_pd(a, b); }
+    };
+    struct SubOp
+    {
+        static double apply(double a, double b) { return a - b; }
+        ISA_AVX2 static __m256d apply(__m256d a, __m256d b) { return _mm256_sub_pd(a, b); }
+    };
+    struct MulOp
+    {
+        static double apply(double a, double b) { return a * b; }
+        ISA_AVX2 static __m256d apply(__m256d a, __m256d b) { return _mm256_mul_pd(a, b); }
+    };
+    struct MinOp
+    {
+        static double apply(double a, double b) { return b < a ? b : a; }
+        ISA_AVX2 static __m256d apply(__m256d a, __m256d b) { return _mm256_min_pd(b, a); }
+    };
+    struct MaxOp
+    {
+        static double apply(double a, double b) { return a < b ? b : a; }
+        ISA_AVX2 static __m256d apply(__m256d a, __m256d b) { return _mm256_max_pd(b, a); }
+    };
+
+    template <typename Op, typename L, typename R>
+    struct Binary : Expr<Binary<Op, L, R>>
+    {
+        static constexpr int arrays = L::arrays + R::arrays;
+        L l;
+        R r;
+        Binary(const L &l, const R &r) : l(l), r(r) {}
+        double at(size_t i) const { return Op::apply(l.at(i), r.at(i)); }
+        ISA_AVX2 __m256d load(size_t i) const { return Op::apply(l.load(i), r.load(i)); }
+    };
+
+    inline Array array(const double *p) { return Array(p); }
+
+#define EXPR_BINARY_OPERATOR(op, Op)                                                         \
+    template <typename L, typename R>                                                        \
+    Binary<Op, L, R> operator op(const Expr<L> &l, const Expr<R> &r)                         \
+    {                                                                                        \
+        return Binary<Op, L, R>(l.self(), r.self());                                         \
+    }                                                                                        \
+    template <typename L>                                                                    \
+    Binary<Op, L, Scalar> operator op(const Expr<L> &l, double r)                            \
+    {                                                                                        \
+        return Binary<Op, L, Scalar>(l.self(), Scalar(r));                                   \
+    }                                                                                        \
+    template <typename R>                                                                    \
+    Binary<Op, Scalar, R> operator op(double l, const Expr<R> &r)                            \
+    {                                                                                        \
+        return Binary<Op, Scalar, R>(Scalar(l), r.self());                                   \
+    }
+
+    EXPR_BINARY_OPERATOR(+, AddOp)
+    EXPR_BINARY_OPERATOR(-, SubOp)
+    EXPR_BINARY_OPERATOR(*, MulOp)
+#undef EXPR_BINARY_OPERATOR
+
+    template <typename E>
+    Binary<MinOp, Binary<MaxOp, E, Scalar>, Scalar> clamp(const Expr<E> &e, double lo, double hi)
+    {
+        using Lower = Binary<MaxOp, E, Scalar>;
+        return Binary<MinOp, Lower, Scalar>(Lower(e.self(), Scalar(lo)), Scalar(hi));
+    }
+
+    // Bytes an evaluation of e over n elements reads and writes (each array once, plus the output)
+    template <typename E>
+    double bytesMoved(const Expr<E> &, size_t n)
+    {
+        return static_cast<double>(E::arrays + 1) * n * sizeof(double);
+    }
+
+    inline size_t llcBytes()
+    {
+        long l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+        long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+        return l3 > 0 ? l3 : (l2 > 0 ? l2 : 8L << 20);
+    }
+
+    // out[begin, end) = e one element at a time; plain stores either way
+    template <typename E>
+    void evaluateScalar(double *out, const E &e, size_t begin, size_t end, bool)
+    {
+        for (size_t i = begin; i < end; i++)
+            out[i] = e.at(i);
+    }
+
+    // out[begin, end) = e 4 elements at a time; streaming stores bypass the cache and need 32-byte
+    // aligned addresses
+    template <typename E>
+    ISA_AVX2 void evaluateAVX2(double *out, const E &e, size_t begin, size_t end, bool streaming)
+    {
+        size_t i = begin;
+        if (streaming)
+        {
+            for (; i < end && (reinterpret_cast<uintptr_t>(out + i) & 31) != 0; i++)
+                out[i] = e.at(i);
+            for (; i + 4 <= end; i += 4)
+                _mm256_stream_pd(out + i, e.load(i));
+        }
+        else
+        {
+            for (; i + 4 <= end; i += 4)
+                _mm256_storeu_pd(out + i, e.load(i));
+        }
+        for (; i < end; i++)
+            out[i] = e.at(i);
+        if (streaming)
+            _mm_sfence();
+    }
+
+    template <typename E>
+    using EvaluateFn = void (*)(double *, const E &, size_t, size_t, bool);
+
+    template <typename E>
+    const isa::Variants<EvaluateFn<E>> &evaluateVariants()
+    {
+        static const isa::Variants<EvaluateFn<E>> v = {evaluateScalar<E>, evaluateAVX2<E>, nullptr};
+        return v;
+    }
+
+    template <typename E>
+    void evaluate(double *out, const E &e, size_t begin, size_t end, bool streaming)
+    {
+        static const EvaluateFn<E> fn = evaluateVariants<E>().pick();
+        fn(out, e, begin, end, streaming);
+    }
+
+    // out (rows x cols, contiguous) = e, with rows handed to the pool under `policy`
+    template <typename E>
+    void assign(pool::ThreadPool &tp, pool::Policy policy, double *out, const Expr<E> &e, size_t rows, size_t cols)
+    {
+        const E &x = e.self();
+        bool streaming = rows * cols * sizeof(double) > llcBytes();
+        tp.parallel_for({0, rows}, policy, [&](size_t rb, size_t re)
+                        { evaluate(out, x, rb * cols, re * cols, streaming); });
+    }
+
+    // out (desc.M x desc.N, contiguous) = e, worker r of the pool evaluating the blocks rank r owns
+    // under a 2D block-cyclic descriptor (common/layout.hpp), one row segment at a time. Ranks past
+    // the pool size are run by worker rank % size.
+    template <typename E>
+    void assign(pool::ThreadPool &tp, const layout::Descriptor &desc, double *out, const Expr<E> &e)
+    {
+        const E &x = e.self();
+        const size_t cols = desc.N;
+        bool streaming = desc.M * cols * sizeof(double) > llcBytes();
+        const int workers = tp.size();
+        tp.run([&](int id)
+               {
+                   for (int rank = id; rank < desc.workers(); rank += workers)
+                       layout::forEachBlock(desc, rank, [&](size_t r0, size_t r1, size_t c0, size_t c1)
+                                            {
+                                                for (size_t i = r0; i < r1; i++)
+                                                    evaluate(out, x, i * cols + c0, i * cols + c1, streaming);
+                                            });
+               });
+    }
+}
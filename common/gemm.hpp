@@ -0,0 +1,489 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <immintrin.h>
+#include <new>
+#include "isa.hpp"
+#include "memory.hpp"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Blocked GEMM engine: C = alpha * A * B + beta * C for row-major float and double matrices.
+//
+// Loop nest follows the usual Goto/BLIS structure:
+//   jc: NC columns of B   -> packed B panel lives in L3
+//   pc: KC rows of B      -> one KC x NR micro-panel of B lives in L1
+//   ic: MC rows of A      -> packed A block lives in L2
+//   jr/ir: MR x NR tile   -> held in registers by the micro-kernel
+// B is packed straight from its row-major layout, so no transpose pass is needed. The packing and
+// kernels are AVX2 + FMA (common/isa.hpp); gemm and gemmParallel dispatch to them, or to a plain
+// i-k-j loop on CPUs without AVX2.
+namespace gemm
+{
+    // AVX2 operations and blocking sizes per element type.
+    // Blocking is given in bytes-equivalent terms: a double panel holds half as many elements.
+    template <typename T>
+    struct Simd;
+
+    template <>
+    struct Simd<float>
+    {
+        using reg = __m256;
+        static constexpr int W = 8;
+        static constexpr int MC = 120;  // 120 x 256 floats = 120 KB of A in L2
+        static constexpr int NC = 3072; // 256 x 3072 floats = 3 MB of B in L3
+
+        ISA_AVX2 static reg zero() { return _mm256_setzero_ps(); }
+        ISA_AVX2 static reg set1(float x) { return _mm256_set1_ps(x); }
+        ISA_AVX2 static reg broadcast(const float *p) { return _mm256_broadcast_ss(p); }
+        ISA_AVX2 static reg load(const float *p) { return _mm256_load_ps(p); }
+        ISA_AVX2 static reg loadu(const float *p) { return _mm256_loadu_ps(p); }
+        ISA_AVX2 static void store(float *p, reg v) { _mm256_store_ps(p, v); }
+        ISA_AVX2 static void storeu(float *p, reg v) { _mm256_storeu_ps(p, v); }
+        ISA_AVX2 static reg add(reg a, reg b) { return _mm256_add_ps(a, b); }
+        ISA_AVX2 static reg mul(reg a, reg b) { return _mm256_mul_ps(a, b); }
+        ISA_AVX2 static reg fmadd(reg a, reg b, reg c) { return _mm256_fmadd_ps(a, b, c); }
+
+        // Lanes [0, n) active; inactive lanes are neither read nor written
+        ISA_AVX2 static __m256i mask(int n)
+        {
+            return _mm256_cmpgt_epi32(_mm256_set1_epi32(n), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        }
+        ISA_AVX2 static reg maskload(const float *p, __m256i m) { return _mm256_maskload_ps(p, m); }
+        ISA_AVX2 static void maskstore(float *p, __m256i m, reg v) { _mm256_maskstore_ps(p, m, v); }
+    };
+
+    template <>
+    struct Simd<double>
+    {
+        using reg = __m256d;
+        static constexpr int W = 4;
+        static constexpr int MC = 60;   // 60 x 256 doubles = 120 KB of A in L2
+        static constexpr int NC = 1536; // 256 x 1536 doubles = 3 MB of B in L3
+
+        ISA_AVX2 static reg zero() { return _mm256_setzero_pd(); }
+        ISA_AVX2 static reg set1(double x) { return _mm256_set1_pd(x); }
+        ISA_AVX2 static reg broadcast(const double *p) { return _mm256_broadcast_sd(p); }
+        ISA_AVX2 static reg load(const double *p) { return _mm256_load_pd(p); }
+        ISA_AVX2 static reg loadu(const double *p) { return _mm256_loadu_pd(p); }
+        ISA_AVX2 static void store(double *p, reg v) { _mm256_store_pd(p, v); }
+        ISA_AVX2 static void storeu(double *p, reg v) { _mm256_storeu_pd(p, v); }
+        ISA_AVX2 static reg add(reg a, reg b) { return _mm256_add_pd(a, b); }
+        ISA_AVX2 static reg mul(reg a, reg b) { return _mm256_mul_pd(a, b); }
+        ISA_AVX2 static reg fmadd(reg a, reg b, reg c) { return _mm256_fmadd_pd(a, b, c); }
+
+        ISA_AVX2 static __m256i mask(int n)
+        {
+            return _mm256_cmpgt_epi64(_mm256_set1_epi64x(n), _mm256_setr_epi64x(0, 1, 2, 3));
+        }
+        ISA_AVX2 static reg maskload(const double *p, __m256i m) { return _mm256_maskload_pd(p, m); }
+        ISA_AVX2 static void maskstore(double *p, __m256i m, reg v) { _mm256_maskstore_pd(p, m, v); }
+    };
+
+    constexpr int MR = 6;   // rows of the register tile
+    constexpr int KC = 256; // depth of a packed panel (16 floats / 8 doubles x 256 = 16 KB of B in L1)
+
+    // Columns of the register tile: two vector registers (16 floats / 8 doubles)
+    template <typename T>
+    constexpr int NR = 2 * Simd<T>::W;
+
+    // 64-byte aligned scratch buffer for packed panels. The kernels cannot run without it, so a
+    // failed allocation throws std::bad_alloc, as the containers in mem:: do.
+    template <typename T>
+    struct PackBuffer
+    {
+        T *data;
+        size_t count;
+        explicit PackBuffer(size_t count) : data(static_cast<T *>(mem::allocate(count * sizeof(T)))), count(count)
+        {
+            if (!data)
+                throw std::bad_alloc();
+        }
+        ~PackBuffer() { mem::release(data, count * sizeof(T)); }
+        PackBuffer(const PackBuffer &) = delete;
+        PackBuffer &operator=(const PackBuffer &) = delete;
+    };
+
+    // Pack an mc x kc block of A into MR-row micro-panels: for each k, MR consecutive rows.
+    // Rows past mc are zero-filled so the micro-kernel never needs a row tail.
+    template <typename T>
+    void packA(const T *A, int lda, int mc, int kc, T *Ap)
+    {
+        for (int i = 0; i < mc; i += MR)
+        {
+            int rows = std::min(MR, mc - i);
+            const T *src = A + static_cast<size_t>(i) * lda;
+            for (int p = 0; p < kc; p++)
+            {
+                for (int r = 0; r < rows; r++)
+                    Ap[r] = src[static_cast<size_t>(r) * lda + p];
+                for (int r = rows; r < MR; r++)
+                    Ap[r] = T(0);
+                Ap += MR;
+            }
+        }
+    }
+
+    // Pack a kc x nc block of B into NR-column micro-panels: for each k, NR consecutive columns.
+    // The last micro-panel is read with masked loads, so columns past nc are zero and never touched.
+    template <typename T>
+    ISA_AVX2 void packB(const T *B, int ldb, int kc, int nc, T *Bp)
+    {
+        using S = Simd<T>;
+        constexpr int W = S::W;
+        for (int j = 0; j < nc; j += NR<T>)
+        {
+            int cols = std::min(NR<T>, nc - j);
+            const T *src = B + j;
+            if (cols == NR<T>)
+            {
+                for (int p = 0; p < kc; p++, src += ldb, Bp += NR<T>)
+                {
+                    S::store(Bp, S::loadu(src));
+                    S::store(Bp + W, S::loadu(src + W));
+                }
+            }
+            else
+            {
+                __m256i m0 = S::mask(cols), m1 = S::mask(cols - W);
+                for (int p = 0; p < kc; p++, src += ldb, Bp += NR<T>)
+                {
+                    S::store(Bp, S::maskload(src, m0));
+                    S::store(Bp + W, S::maskload(src + W, m1));
+                }
+            }
+        }
+    }
+
+    // Write an m x n register tile to C as C = alpha * acc + beta * C; beta == 0 never reads C.
+    // Column tails use masked loads/stores so odd widths stay fully vectorized. Kept out of line
+    // so the tail masks are not hoisted into the k loop, where they would spill an accumulator.
+    template <typename T>
+    ISA_AVX2 __attribute__((noinline)) void storeTileMasked(const typename Simd<T>::reg (&acc)[MR][2], T *C,
+                                                            int ldc, int m, int n, T alpha, T beta)
+    {
+        using S = Simd<T>;
+        using reg = typename S::reg;
+        constexpr int W = S::W;
+        reg va = S::set1(alpha), vb = S::set1(beta);
+        __m256i m0 = S::mask(n), m1 = S::mask(n - W);
+        for (int r = 0; r < m; r++)
+        {
+            T *row = C + static_cast<size_t>(r) * ldc;
+            reg c0 = S::mul(va, acc[r][0]), c1 = S::mul(va, acc[r][1]);
+            if (beta != T(0))
+            {
+                c0 = S::fmadd(vb, S::maskload(row, m0), c0);
+                c1 = S::fmadd(vb, S::maskload(row + W, m1), c1);
+            }
+            S::maskstore(row, m0, c0);
+            S::maskstore(row + W, m1, c1);
+        }
+    }
+
+    template <typename T>
+    ISA_AVX2 void storeTile(const typename Simd<T>::reg (&acc)[MR][2], T *C, int ldc, int m, int n, T alpha, T beta)
+    {
+        using S = Simd<T>;
+        using reg = typename S::reg;
+        constexpr int W = S::W;
+        if (n != NR<T>)
+        {
+            storeTileMasked<T>(acc, C, ldc, m, n, alpha, beta);
+            return;
+        }
+        reg va = S::set1(alpha), vb = S::set1(beta);
+        for (int r = 0; r < m; r++)
+        {
+            T *row = C + static_cast<size_t>(r) * ldc;
+            reg c0 = S::mul(va, acc[r][0]), c1 = S::mul(va, acc[r][1]);
+            if (beta != T(0))
+            {
+                c0 = S::fmadd(vb, S::loadu(row), c0);
+                c1 = S::fmadd(vb, S::loadu(row + W), c1);
+            }
+            S::storeu(row, c0);
+            S::storeu(row + W, c1);
+        }
+    }
+
+    // 6 x NR micro-kernel: 12 ymm accumulators, one broadcast of A and two loads of B per k.
+    // Updates an m x n corner of C through storeTile.
+    template <typename T>
+    ISA_AVX2 void microKernel(int kc, const T *Ap, const T *Bp, T *C, int ldc, int m, int n, T alpha, T beta)
+    {
+        using S = Simd<T>;
+        using reg = typename S::reg;
+        constexpr int W = S::W;
+
+        // Accumulators are spelled out so they stay in registers rather than on the stack
+        reg c00 = S::zero(), c01 = S::zero();
+        reg c10 = S::zero(), c11 = S::zero();
+        reg c20 = S::zero(), c21 = S::zero();
+        reg c30 = S::zero(), c31 = S::zero();
+        reg c40 = S::zero(), c41 = S::zero();
+        reg c50 = S::zero(), c51 = S::zero();
+
+        for (int p = 0; p < kc; p++)
+        {
+            reg b0 = S::load(Bp);
+            reg b1 = S::load(Bp + W);
+            reg a;
+            a = S::broadcast(Ap + 0);
+            c00 = S::fmadd(a, b0, c00);
+            c01 = S::fmadd(a, b1, c01);
+            a = S::broadcast(Ap + 1);
+            c10 = S::fmadd(a, b0, c10);
+            c11 = S::fmadd(a, b1, c11);
+            a = S::broadcast(Ap + 2);
+            c20 = S::fmadd(a, b0, c20);
+            c21 = S::fmadd(a, b1, c21);
+            a = S::broadcast(Ap + 3);
+            c30 = S::fmadd(a, b0, c30);
+            c31 = S::fmadd(a, b1, c31);
+            a = S::broadcast(Ap + 4);
+            c40 = S::fmadd(a, b0, c40);
+            c41 = S::fmadd(a, b1, c41);
+            a = S::broadcast(Ap + 5);
+            c50 = S::fmadd(a, b0, c50);
+            c51 = S::fmadd(a, b1, c51);
+            Ap += MR;
+            Bp += NR<T>;
+        }
+
+        typename S::reg acc[MR][2] = {{c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}, {c40, c41}, {c50, c51}};
+        storeTile<T>(acc, C, ldc, m, n, alpha, beta);
+    }
+
+    // Multiply a packed A block by a packed B panel into an mc x nc block of C
+    template <typename T>
+    ISA_AVX2 void macroKernel(int mc, int nc, int kc, const T *Ap, const T *Bp, T *C, int ldc, T alpha, T beta)
+    {
+        for (int j = 0; j < nc; j += NR<T>)
+        {
+            int n = std::min(NR<T>, nc - j);
+            for (int i = 0; i < mc; i += MR)
+            {
+                int m = std::min(MR, mc - i);
+                microKernel(kc, &Ap[static_cast<size_t>(i) * kc], &Bp[static_cast<size_t>(j) * kc],
+                            C + static_cast<size_t>(i) * ldc + j, ldc, m, n, alpha, beta);
+            }
+        }
+    }
+
+    // C = beta * C for an M x N block; used when there is no k dimension to accumulate over
+    template <typename T>
+    void scale(int M, int N, T *C, int ldc, T beta)
+    {
+        for (int i = 0; i < M; i++)
+            for (int j = 0; j < N; j++)
+                C[static_cast<size_t>(i) * ldc + j] = beta == T(0) ? T(0) : beta * C[static_cast<size_t>(i) * ldc + j];
+    }
+
+    // Scalar reference: C = beta * C, then C[i][j] += alpha * A[i][p] * B[p][j] in i-k-j order,
+    // KC rows of B at a time so a block of B stays cached across the rows of A
+    template <typename T>
+    void gemmScalar(int M, int L, int N, const T *A, int lda, const T *B, int ldb, T *C, int ldc, T alpha, T beta)
+    {
+        scale(M, N, C, ldc, beta);
+        for (int pc = 0; pc < L; pc += KC)
+        {
+            int kc = std::min(KC, L - pc);
+            for (int i = 0; i < M; i++)
+            {
+                T *row = C + static_cast<size_t>(i) * ldc;
+                for (int p = pc; p < pc + kc; p++)
+                {
+                    const T a = alpha * A[static_cast<size_t>(i) * lda + p];
+                    const T *b = B + static_cast<size_t>(p) * ldb;
+                    for (int j = 0; j < N; j++)
+                        row[j] += a * b[j];
+                }
+            }
+        }
+    }
+
+    // The packed AVX2 engine
+    template <typename T>
+    ISA_AVX2 void gemmAVX2(int M, int L, int N, const T *A, int lda, const T *B, int ldb, T *C, int ldc, T alpha, T beta)
+    {
+        constexpr int MC = Simd<T>::MC, NC = Simd<T>::NC;
+        if (L == 0)
+        {
+            scale(M, N, C, ldc, beta);
+            return;
+        }
+
+        PackBuffer<T> Ap(static_cast<size_t>(MC + MR) * KC);
+        PackBuffer<T> Bp(static_cast<size_t>(KC) * (NC + NR<T>));
+
+        for (int jc = 0; jc < N; jc += NC)
+        {
+            int nc = std::min(NC, N - jc);
+            for (int pc = 0; pc < L; pc += KC)
+            {
+                int kc = std::min(KC, L - pc);
+                T beta_k = pc == 0 ? beta : T(1); // later k blocks accumulate into C
+                packB(B + static_cast<size_t>(pc) * ldb + jc, ldb, kc, nc, Bp.data);
+                for (int ic = 0; ic < M; ic += MC)
+                {
+                    int mc = std::min(MC, M - ic);
+                    packA(A + static_cast<size_t>(ic) * lda + pc, lda, mc, kc, Ap.data);
+                    macroKernel(mc, nc, kc, Ap.data, Bp.data, C + static_cast<size_t>(ic) * ldc + jc, ldc, alpha, beta_k);
+                }
+            }
+        }
+    }
+
+    template <typename T>
+    using GemmFn = void (*)(int, int, int, const T *, int, const T *, int, T *, int, T, T);
+
+    template <typename T>
+    const isa::Variants<GemmFn<T>> &gemmVariants()
+    {
+        static const isa::Variants<GemmFn<T>> v = {gemmScalar<T>, gemmAVX2<T>, nullptr};
+        return v;
+    }
+
+    // C (M x N) = alpha * A (M x L) * B (L x N) + beta * C, row-major with leading dimensions
+    // lda/ldb/ldc. Any M, L, N are supported; tails never read outside the given matrices.
+    template <typename T>
+    void gemm(int M, int L, int N, const T *A, int lda, const T *B, int ldb, T *C, int ldc, T alpha, T beta)
+    {
+        static const GemmFn<T> fn = gemmVariants<T>().pick();
+        fn(M, L, N, A, lda, B, ldb, C, ldc, alpha, beta);
+    }
+
+    // Split nt threads into a tm x tn grid whose tiles of an M x N matrix are as square as possible
+    inline void threadGrid(int nt, int M, int N, int &tm, int &tn)
+    {
+        tm = nt;
+        tn = 1;
+        double best = -1;
+        for (int r = 1; r <= nt; r++)
+        {
+            if (nt % r != 0)
+                continue;
+            int c = nt / r;
+            double h = static_cast<double>(M) / r, w = static_cast<double>(N) / c;
+            double squareness = std::min(h, w) / std::max(h, w);
+            if (squareness > best)
+            {
+                best = squareness;
+                tm = r;
+                tn = c;
+            }
+        }
+    }
+
+    // [begin, end) of part `idx` when `total` is split into `parts` pieces aligned to `align`
+    inline void splitRange(int total, int parts, int idx, int align, int &begin, int &end)
+    {
+        int units = (total + align - 1) / align;
+        int per = units / parts, extra = units % parts;
+        int u0 = idx * per + std::min(idx, extra);
+        int u1 = u0 + per + (idx < extra ? 1 : 0);
+        begin = std::min(u0 * align, total);
+        end = std::min(u1 * align, total);
+    }
+
+    // Scalar gemmParallel: each thread runs gemmScalar over its own band of rows
+    template <typename T>
+    void gemmParallelScalar(int M, int L, int N, const T *A, int lda, const T *B, int ldb, T *C, int ldc,
+                            T alpha, T beta, int num_threads)
+    {
+#pragma omp parallel num_threads(num_threads)
+        {
+#ifdef _OPENMP
+            int tid = omp_get_thread_num(), nt = omp_get_num_threads();
+#else
+            int tid = 0, nt = 1;
+#endif
+            int m0, m1;
+            splitRange(M, nt, tid, MR, m0, m1);
+            gemmScalar(m1 - m0, L, N, A + static_cast<size_t>(m0) * lda, lda, B, ldb, C + static_cast<size_t>(m0) * ldc,
+                       ldc, alpha, beta);
+        }
+    }
+
+    // Multithreaded AVX2 gemm: C is split into a 2D grid of tiles, one per thread.
+    // All threads pack the shared B panel together (it is reused by every tile row, and
+    // threads on the same L3 read it from there), then each thread packs its own A blocks
+    // and runs the micro-kernel over its tile.
+    template <typename T>
+    ISA_AVX2 void gemmParallelAVX2(int M, int L, int N, const T *A, int lda, const T *B, int ldb, T *C, int ldc,
+                                   T alpha, T beta, int num_threads)
+    {
+        constexpr int MC = Simd<T>::MC, NC = Simd<T>::NC;
+        if (L == 0)
+        {
+            scale(M, N, C, ldc, beta);
+            return;
+        }
+
+        PackBuffer<T> Bp(static_cast<size_t>(KC) * (NC + NR<T>));
+
+#pragma omp parallel num_threads(num_threads)
+        {
+#ifdef _OPENMP
+            int tid = omp_get_thread_num(), nt = omp_get_num_threads();
+#else
+            int tid = 0, nt = 1;
+#endif
+            PackBuffer<T> Ap(static_cast<size_t>(MC + MR) * KC);
+            int tm, tn;
+
+            for (int jc = 0; jc < N; jc += NC)
+            {
+                int nc = std::min(NC, N - jc);
+                threadGrid(nt, M, nc, tm, tn);
+                int m0, m1, n0, n1;
+                splitRange(M, tm, tid / tn, MR, m0, m1);
+                splitRange(nc, tn, tid % tn, NR<T>, n0, n1);
+
+                for (int pc = 0; pc < L; pc += KC)
+                {
+                    int kc = std::min(KC, L - pc);
+                    T beta_k = pc == 0 ? beta : T(1);
+
+                    // Cooperative packing of the shared B panel, one NR micro-panel per iteration
+#pragma omp for schedule(static)
+                    for (int j = 0; j < nc; j += NR<T>)
+                        packB(B + static_cast<size_t>(pc) * ldb + jc + j, ldb, kc, std::min(NR<T>, nc - j),
+                              &Bp.data[static_cast<size_t>(j) * kc]);
+                    // implicit barrier: the whole panel is packed before any tile uses it
+
+                    for (int ic = m0; ic < m1 && n0 < n1; ic += MC)
+                    {
+                        int mc = std::min(MC, m1 - ic);
+                        packA(A + static_cast<size_t>(ic) * lda + pc, lda, mc, kc, Ap.data);
+                        macroKernel(mc, n1 - n0, kc, Ap.data, &Bp.data[static_cast<size_t>(n0) * kc],
+                                    C + static_cast<size_t>(ic) * ldc + jc + n0, ldc, alpha, beta_k);
+                    }
+#pragma omp barrier // B panel is repacked in the next iteration
+                }
+            }
+        }
+    }
+
+    template <typename T>
+    using GemmParallelFn = void (*)(int, int, int, const T *, int, const T *, int, T *, int, T, T, int);
+
+    template <typename T>
+    const isa::Variants<GemmParallelFn<T>> &gemmParallelVariants()
+    {
+        static const isa::Variants<GemmParallelFn<T>> v = {gemmParallelScalar<T>, gemmParallelAVX2<T>, nullptr};
+        return v;
+    }
+
+    // gemm on num_threads OpenMP threads
+    template <typename T>
+    void gemmParallel(int M, int L, int N, const T *A, int lda, const T *B, int ldb, T *C, int ldc,
+                      T alpha, T beta, int num_threads)
+    {
+        static const GemmParallelFn<T> fn = gemmParallelVariants<T>().pick();
+        fn(M, L, N, A, lda, B, ldb, C, ldc, alpha, beta, num_threads);
+    }
+}
@@ -0,0 +1,407 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <immintrin.h>
+#include "gemm.hpp"
+#include "isa.hpp"
+
+// Half-precision storage for the blocked GEMM engine.
+//
+// A and B are kept in memory as 16-bit floats (IEEE fp16 or bfloat16), which halves their footprint
+// and the DRAM traffic of reading them. Arithmetic is still fp32: packed A panels are widened once
+// while packing, B micro-panels stay 16-bit (so the packed B panel also takes half the cache) and
+// are widened in registers by the micro-kernel, and C is accumulated and stored in fp32. The
+// vector paths need AVX2 + FMA + F16C; without them (common/isa.hpp) the conversions run one
+// element at a time and the product widens a band of B per k block and runs an i-k-j loop.
+namespace half
+{
+    // IEEE 754 binary16 (1-5-10): 8 lanes at a time with F16C, one element in software, both
+    // exact and rounding to nearest even
+    struct F16
+    {
+        static const char *name() { return "fp16"; }
+        ISA_AVX2 static __m256 widen(const uint16_t *p)
+        {
+            return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+        }
+        ISA_AVX2 static __m128i narrow(__m256 v) { return _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT); }
+        static float toFloat(uint16_t h)
+        {
+            // Rebias a normal exponent (or scale a subnormal by 2^-24); infinities and NaNs keep
+            // an all-ones exponent, and NaNs come back quiet as from vcvtph2ps
+            uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16, exp = (h >> 10) & 0x1F, mant = h & 0x3FF;
+            float f;
+            if (exp == 0x1F)
+            {
+                uint32_t bits = sign | 0x7F800000u | (mant << 13) | (mant ? 0x400000u : 0);
+                std::memcpy(&f, &bits, sizeof(f));
+                return f;
+            }
+            if (exp == 0)
+                return (sign ? -1.0f : 1.0f) * static_cast<float>(mant) * 0x1p-24f;
+            uint32_t bits = sign | ((exp + 112) << 23) | (mant << 13);
+            std::memcpy(&f, &bits, sizeof(f));
+            return f;
+        }
+        static uint16_t fromFloat(float f)
+        {
+            uint32_t bits;
+            std::memcpy(&bits, &f, sizeof(bits));
+            uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+            bits &= 0x7FFFFFFFu;
+            if (bits > 0x7F800000u) // NaN: keep it quiet and keep the top payload bits
+                return sign | 0x7E00 | static_cast<uint16_t>((bits >> 13) & 0x3FF);
+            if (bits >= 0x477FF000u) // rounds to or past 65520: infinity
+                return sign | 0x7C00;
+            if (bits < 0x38800000u) // below 2^-14: subnormal half, rounded in float at 2^-24 steps
+            {
+                float a;
+                std::memcpy(&a, &bits, sizeof(a));
+                return sign | static_cast<uint16_t>(std::nearbyint(a * 0x1p24f));
+            }
+            // Normal: drop 13 mantissa bits with round to nearest even; a carry bumps the exponent
+            uint32_t h = ((bits >> 13) - (112u << 10));
+            uint32_t rest = bits & 0x1FFF;
+            h += rest > 0x1000 || (rest == 0x1000 && (h & 1));
+            return sign | static_cast<uint16_t>(h);
+        }
+    };
+
+    // bfloat16 (1-8-7): the upper half of an fp32, so widening is a 16-bit shift
+    struct BF16
+    {
+        static const char *name() { return "bf16"; }
+        ISA_AVX2 static __m256 widen(const uint16_t *p)
+        {
+            __m256i x = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+            return _mm256_castsi256_ps(_mm256_slli_epi32(x, 16));
+        }
+        // Round to nearest even: add 0x7FFF plus the lowest kept bit, then drop the low 16 bits.
+        // NaNs are truncated and quieted instead, since the add could carry them into infinity
+        // or wrap them to zero.
+        ISA_AVX2 static __m128i narrow(__m256 v)
+        {
+            __m256i x = _mm256_castps_si256(v);
+            __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(x, 16), _mm256_set1_epi32(1));
+            __m256i rounded = _mm256_srli_epi32(_mm256_add_epi32(x, _mm256_add_epi32(lsb, _mm256_set1_epi32(0x7FFF))), 16);
+            __m256i quiet = _mm256_or_si256(_mm256_srli_epi32(x, 16), _mm256_set1_epi32(0x0040));
+            __m256 nan = _mm256_cmp_ps(v, v, _CMP_UNORD_Q);
+            x = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(rounded), _mm256_castsi256_ps(quiet), nan));
+            // pack the 8 low halves into 128 bits (packus works per 128-bit lane, so fix the order)
+            __m256i packed = _mm256_packus_epi32(x, x);
+            return _mm256_castsi256_si128(_mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)));
+        }
+        static float toFloat(uint16_t h)
+        {
+            uint32_t bits = static_cast<uint32_t>(h) << 16;
+            float f;
+            std::memcpy(&f, &bits, sizeof(f));
+            return f;
+        }
+        static uint16_t fromFloat(float f)
+        {
+            uint32_t bits;
+            std::memcpy(&bits, &f, sizeof(bits));
+            if ((bits & 0x7FFFFFFFu) > 0x7F800000u) // NaN: keep the top payload bits, set the quiet bit
+                return static_cast<uint16_t>((bits >> 16) | 0x0040);
+            bits += 0x7FFF + ((bits >> 16) & 1);
+            return static_cast<uint16_t>(bits >> 16);
+        }
+    };
+
+    // dst[i] = half(src[i]), round to nearest even
+    template <typename H>
+    void fromFloatScalar(const float *src, uint16_t *dst, size_t n)
+    {
+        for (size_t i = 0; i < n; i++)
+            dst[i] = H::fromFloat(src[i]);
+    }
+
+    template <typename H>
+    ISA_AVX2 void fromFloatAVX2(const float *src, uint16_t *dst, size_t n)
+    {
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), H::narrow(_mm256_loadu_ps(src + i)));
+        for (; i < n; i++)
+            dst[i] = H::fromFloat(src[i]);
+    }
+
+    // dst[i] = float(src[i]), exact
+    template <typename H>
+    void toFloatScalar(const uint16_t *src, float *dst, size_t n)
+    {
+        for (size_t i = 0; i < n; i++)
+            dst[i] = H::toFloat(src[i]);
+    }
+
+    template <typename H>
+    ISA_AVX2 void toFloatAVX2(const uint16_t *src, float *dst, size_t n)
+    {
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(dst + i, H::widen(src + i));
+        for (; i < n; i++)
+            dst[i] = H::toFloat(src[i]);
+    }
+
+    using FromFloatFn = void (*)(const float *, uint16_t *, size_t);
+    using ToFloatFn = void (*)(const uint16_t *, float *, size_t);
+
+    template <typename H>
+    const isa::Variants<FromFloatFn> &fromFloatVariants()
+    {
+        static const isa::Variants<FromFloatFn> v = {fromFloatScalar<H>, fromFloatAVX2<H>, nullptr};
+        return v;
+    }
+
+    template <typename H>
+    const isa::Variants<ToFloatFn> &toFloatVariants()
+    {
+        static const isa::Variants<ToFloatFn> v = {toFloatScalar<H>, toFloatAVX2<H>, nullptr};
+        return v;
+    }
+
+    template <typename H>
+    void fromFloat(const float *src, uint16_t *dst, size_t n)
+    {
+        static const FromFloatFn fn = fromFloatVariants<H>().pick();
+        fn(src, dst, n);
+    }
+
+    template <typename H>
+    void toFloat(const uint16_t *src, float *dst, size_t n)
+    {
+        static const ToFloatFn fn = toFloatVariants<H>().pick();
+        fn(src, dst, n);
+    }
+
+    using gemm::KC;
+    using gemm::MR;
+    constexpr int NR = gemm::NR<float>;
+    constexpr int MC = gemm::Simd<float>::MC;
+    constexpr int NC = gemm::Simd<float>::NC;
+
+    // Pack an mc x kc block of 16-bit A into fp32 MR-row micro-panels (widened once here)
+    template <typename H>
+    void packA(const uint16_t *A, int lda, int mc, int kc, float *Ap)
+    {
+        for (int i = 0; i < mc; i += MR)
+        {
+            int rows = std::min(MR, mc - i);
+            const uint16_t *src = A + static_cast<size_t>(i) * lda;
+            for (int p = 0; p < kc; p++)
+            {
+                for (int r = 0; r < rows; r++)
+                    Ap[r] = H::toFloat(src[static_cast<size_t>(r) * lda + p]);
+                for (int r = rows; r < MR; r++)
+                    Ap[r] = 0.0f;
+                Ap += MR;
+            }
+        }
+    }
+
+    // Pack a kc x nc block of 16-bit B into 16-bit NR-column micro-panels (no widening)
+    inline void packB(const uint16_t *B, int ldb, int kc, int nc, uint16_t *Bp)
+    {
+        for (int j = 0; j < nc; j += NR)
+        {
+            int cols = std::min(NR, nc - j);
+            const uint16_t *src = B + j;
+            for (int p = 0; p < kc; p++, src += ldb, Bp += NR)
+            {
+                if (cols == NR)
+                {
+                    std::memcpy(Bp, src, NR * sizeof(uint16_t));
+                }
+                else
+                {
+                    std::memcpy(Bp, src, cols * sizeof(uint16_t));
+                    std::memset(Bp + cols, 0, (NR - cols) * sizeof(uint16_t));
+                }
+            }
+        }
+    }
+
+    // 6x16 micro-kernel reading 16-bit B micro-panels and widening them in registers
+    template <typename H>
+    ISA_AVX2 void microKernel(int kc, const float *Ap, const uint16_t *Bp, float *C, int ldc, int m, int n,
+                     float alpha, float beta)
+    {
+        __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+        __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+        __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+        __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+        __m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+        __m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+
+        for (int p = 0; p < kc; p++)
+        {
+            __m256 b0 = H::widen(Bp);
+            __m256 b1 = H::widen(Bp + 8);
+            __m256 a;
+            a = _mm256_broadcast_ss(Ap + 0);
+            c00 = _mm256_fmadd_ps(a, b0, c00);
+            c01 = _mm256_fmadd_ps(a, b1, c01);
+            a = _mm256_broadcast_ss(Ap + 1);
+            c10 = _mm256_fmadd_ps(a, b0, c10);
+            c11 = _mm256_fmadd_ps(a, b1, c11);
+            a = _mm256_broadcast_ss(Ap + 2);
+            c20 = _mm256_fmadd_ps(a, b0, c20);
+            c21 = _mm256_fmadd_ps(a, b1, c21);
+            a = _mm256_broadcast_ss(Ap + 3);
+            c30 = _mm256_fmadd_ps(a, b0, c30);
+            c31 = _mm256_fmadd_ps(a, b1, c31);
+            a = _mm256_broadcast_ss(Ap + 4);
+            c40 = _mm256_fmadd_ps(a, b0, c40);
+            c41 = _mm256_fmadd_ps(a, b1, c41);
+            a = _mm256_broadcast_ss(Ap + 5);
+            c50 = _mm256_fmadd_ps(a, b0, c50);
+            c51 = _mm256_fmadd_ps(a, b1, c51);
+            Ap += MR;
+            Bp += NR;
+        }
+
+        __m256 acc[MR][2] = {{c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}, {c40, c41}, {c50, c51}};
+        gemm::storeTile<float>(acc, C, ldc, m, n, alpha, beta);
+    }
+
+    template <typename H>
+    ISA_AVX2 void macroKernel(int mc, int nc, int kc, const float *Ap, const uint16_t *Bp, float *C, int ldc,
+                     float alpha, float beta)
+    {
+        for (int j = 0; j < nc; j += NR)
+        {
+            int n = std::min(NR, nc - j);
+            for (int i = 0; i < mc; i += MR)
+            {
+                int m = std::min(MR, mc - i);
+                microKernel<H>(kc, &Ap[static_cast<size_t>(i) * kc], &Bp[static_cast<size_t>(j) * kc],
+                               C + static_cast<size_t>(i) * ldc + j, ldc, m, n, alpha, beta);
+            }
+        }
+    }
+
+    // Scalar product: per KC block, the band of B is widened into fp32 once, then each thread
+    // widens its rows of A a block row at a time and runs an i-k-j loop over its band of C
+    template <typename H>
+    void gemmScalar(int M, int L, int N, const uint16_t *A, int lda, const uint16_t *B, int ldb, float *C, int ldc,
+                    float alpha, float beta, int num_threads)
+    {
+        gemm::scale(M, N, C, ldc, beta);
+        if (L == 0 || N == 0)
+            return;
+        gemm::PackBuffer<float> Bw(static_cast<size_t>(KC) * N);
+
+#pragma omp parallel num_threads(num_threads)
+        {
+#ifdef _OPENMP
+            int tid = omp_get_thread_num(), nt = omp_get_num_threads();
+#else
+            int tid = 0, nt = 1;
+#endif
+            float a[KC];
+            int m0, m1;
+            gemm::splitRange(M, nt, tid, MR, m0, m1);
+            for (int pc = 0; pc < L; pc += KC)
+            {
+                int kc = std::min(KC, L - pc);
+#pragma omp for schedule(static)
+                for (int p = 0; p < kc; p++)
+                    for (int j = 0; j < N; j++)
+                        Bw.data[static_cast<size_t>(p) * N + j] = H::toFloat(B[static_cast<size_t>(pc + p) * ldb + j]);
+                // implicit barrier: the band is widened before any row uses it
+
+                for (int i = m0; i < m1; i++)
+                {
+                    float *row = C + static_cast<size_t>(i) * ldc;
+                    for (int p = 0; p < kc; p++)
+                        a[p] = alpha * H::toFloat(A[static_cast<size_t>(i) * lda + pc + p]);
+                    for (int p = 0; p < kc; p++)
+                    {
+                        const float *b = Bw.data + static_cast<size_t>(p) * N;
+                        for (int j = 0; j < N; j++)
+                            row[j] += a[p] * b[j];
+                    }
+                }
+#pragma omp barrier // the band is rewidened in the next iteration
+            }
+        }
+    }
+
+    // The AVX2 engine: same blocking, tiling and threading as gemm::gemmParallel
+    template <typename H>
+    ISA_AVX2 void gemmAVX2(int M, int L, int N, const uint16_t *A, int lda, const uint16_t *B, int ldb, float *C,
+                           int ldc, float alpha, float beta, int num_threads)
+    {
+        if (L == 0)
+        {
+            gemm::scale(M, N, C, ldc, beta);
+            return;
+        }
+
+        gemm::PackBuffer<uint16_t> Bp(static_cast<size_t>(KC) * (NC + NR));
+
+#pragma omp parallel num_threads(num_threads)
+        {
+#ifdef _OPENMP
+            int tid = omp_get_thread_num(), nt = omp_get_num_threads();
+#else
+            int tid = 0, nt = 1;
+#endif
+            gemm::PackBuffer<float> Ap(static_cast<size_t>(MC + MR) * KC);
+            int tm, tn;
+
+            for (int jc = 0; jc < N; jc += NC)
+            {
+                int nc = std::min(NC, N - jc);
+                gemm::threadGrid(nt, M, nc, tm, tn);
+                int m0, m1, n0, n1;
+                gemm::splitRange(M, tm, tid / tn, MR, m0, m1);
+                gemm::splitRange(nc, tn, tid % tn, NR, n0, n1);
+
+                for (int pc = 0; pc < L; pc += KC)
+                {
+                    int kc = std::min(KC, L - pc);
+                    float beta_k = pc == 0 ? beta : 1.0f;
+
+#pragma omp for schedule(static)
+                    for (int j = 0; j < nc; j += NR)
+                        packB(B + static_cast<size_t>(pc) * ldb + jc + j, ldb, kc, std::min(NR, nc - j),
+                              &Bp.data[static_cast<size_t>(j) * kc]);
+
+                    for (int ic = m0; ic < m1 && n0 < n1; ic += MC)
+                    {
+                        int mc = std::min(MC, m1 - ic);
+                        packA<H>(A + static_cast<size_t>(ic) * lda + pc, lda, mc, kc, Ap.data);
+                        macroKernel<H>(mc, n1 - n0, kc, Ap.data, &Bp.data[static_cast<size_t>(n0) * kc],
+                                       C + static_cast<size_t>(ic) * ldc + jc + n0, ldc, alpha, beta_k);
+                    }
+#pragma omp barrier
+                }
+            }
+        }
+    }
+
+    using GemmFn = void (*)(int, int, int, const uint16_t *, int, const uint16_t *, int, float *, int, float, float, int);
+
+    template <typename H>
+    const isa::Variants<GemmFn> &gemmVariants()
+    {
+        static const isa::Variants<GemmFn> v = {gemmScalar<H>, gemmAVX2<H>, nullptr};
+        return v;
+    }
+
+    // C (fp32, M x N) = alpha * A (16-bit, M x L) * B (16-bit, L x N) + beta * C on num_threads
+    // OpenMP threads
+    template <typename H>
+    void gemm(int M, int L, int N, const uint16_t *A, int lda, const uint16_t *B, int ldb, float *C, int ldc,
+              float alpha, float beta, int num_threads)
+    {
+        static const GemmFn fn = gemmVariants<H>().pick();
+        fn(M, L, N, A, lda, B, ldb, C, ldc, alpha, beta, num_threads);
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// Runtime selection between scalar, AVX2 + FMA and AVX-512 variants of a kernel.
+//
+// The labs are built for baseline x86-64 (no -mavx2 / -mfma), so the compiler never emits AVX on
+// its own. Each SIMD function instead carries a target attribute (ISA_AVX2, ISA_AVX512) that
+// compiles it, and whatever is inlined into it, for that instruction set; lambdas and member
+// functions that touch vector registers need the attribute too. Only a non-scalar entry of a
+// Variants table calls into such code, after cpuid has confirmed its instructions. The level is
+// detected once, at the first call: AVX-512 needs AVX-512F, AVX2 needs AVX2, FMA and F16C (every
+// AVX2 CPU has all three; libgcc's cpuid check also requires the OS to save the wider registers).
+// SIMD_ISA=scalar|avx2|avx512 in the environment lowers the level, to time or check the other
+// variants on a newer machine; it can never raise it above what the CPU has. isa_check.cpp at the
+// top of the tree runs every variant against its scalar one.
+#define ISA_AVX2 __attribute__((target("avx2,fma,f16c")))
+#define ISA_AVX512 __attribute__((target("avx512f,avx2,fma,f16c")))
+
+namespace isa
+{
+    enum class Level
+    {
+        Scalar,
+        AVX2, // AVX2 + FMA + F16C
+        AVX512
+    };
+
+    inline const char *name(Level level)
+    {
+        switch (level)
+        {
+        case Level::AVX512:
+            return "avx512";
+        case Level::AVX2:
+            return "avx2+fma";
+        default:
+            return "scalar";
+        }
+    }
+
+    // What the CPU (and OS) support
+    inline Level detect()
+    {
+        static const Level level = []
+        {
+            __builtin_cpu_init();
+            bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c");
+            if (avx2 && __builtin_cpu_supports("avx512f"))
+                return Level::AVX512;
+            return avx2 ? Level::AVX2 : Level::Scalar;
+        }();
+        return level;
+    }
+
+    // The level kernels dispatch on: detect(), lowered by SIMD_ISA
+    inline Level selected()
+    {
+        static const Level level = []
+        {
+            Level best = detect();
+            const char *env = std::getenv("SIMD_ISA");
+            if (!env)
+                return best;
+            Level wanted = std::strcmp(env, "scalar") == 0 ? Level::Scalar : std::strcmp(env, "avx2") == 0 ? Level::AVX2 : Level::AVX512;
+            return wanted < best ? wanted : best;
+        }();
+        return level;
+    }
+
+    inline bool supports(Level level) { return level <= detect(); }
+
+    // "avx512 (detected avx512)", for benchmark and walkthrough headers
+    inline std::string describe()
+    {
+        return std::string(name(selected())) + " (detected " + name(detect()) + ")";
+    }
+
+    // One function pointer per level; pick() returns the best one at or below `level`
+    template <typename Fn>
+    struct Variants
+    {
+        Fn scalar, avx2, avx512;
+
+        Fn at(Level level) const
+        {
+            if (level == Level::AVX512 && avx512)
+                return avx512;
+            if (level >= Level::AVX2 && avx2)
+                return avx2;
+            return scalar;
+        }
+
+        Fn pick() const { return at(selected()); }
+    };
+}
@@ -0,0 +1,316 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <immintrin.h>
+#include <thread>
+#include <vector>
+#include "isa.hpp"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// 0/1 knapsack in O(C) memory.
+//
+// The DP only ever reads the previous item's row, so one row of C + 1 values is enough when each
+// item is folded in back to front: m[j] = max(m[j], m[j - w] + v) for j = C .. w, where every
+// m[j - w] read is still the previous item's value. Eight capacities are updated per AVX2 step
+// (one per iteration on CPUs without AVX2, see common/isa.hpp).
+// The chosen items are recovered without the table by divide and conquer over the items
+// (Hirschberg): solve both halves for every capacity, pick the capacity split that attains the
+// optimum, and recurse into each half with its share of the capacity. solveRowParallel splits
+// the row into one capacity slab per thread and runs the items over the slabs as a wavefront.
+// When C is huge (large integer weights) the row itself is the problem; solveSparse keeps only the
+// Pareto frontier of (weight, value) pairs instead, and solve picks between the two by cost.
+namespace knapsack
+{
+    // m[j] = max(m[j], m[j - w] + v) for j in [begin, end), back to front (begin >= w)
+    inline void addItemRangeScalar(int *m, int begin, int end, int w, int v)
+    {
+        for (int j = end - 1; j >= begin; j--)
+            m[j] = std::max(m[j], m[j - w] + v);
+    }
+
+    ISA_AVX2 inline void addItemRangeAVX2(int *m, int begin, int end, int w, int v)
+    {
+        const __m256i vv = _mm256_set1_epi32(v);
+        int j = end;
+        // m[j-8 .. j) from m[j-8-w .. j-w): lanes below j-8 are untouched, lanes in range are
+        // loaded before the store, so in place is safe for any w >= 1
+        for (; j - 8 >= begin; j -= 8)
+        {
+            __m256i keep = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(m + j - 8));
+            __m256i take = _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(m + j - 8 - w)), vv);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(m + j - 8), _mm256_max_epi32(keep, take));
+        }
+        for (j--; j >= begin; j--)
+            m[j] = std::max(m[j], m[j - w] + v);
+    }
+
+    using AddItemFn = void (*)(int *, int, int, int, int);
+
+    inline const isa::Variants<AddItemFn> &addItemVariants()
+    {
+        static const isa::Variants<AddItemFn> v = {addItemRangeScalar, addItemRangeAVX2, nullptr};
+        return v;
+    }
+
+    inline void addItemRange(int *m, int begin, int end, int w, int v)
+    {
+        static const AddItemFn fn = addItemVariants().pick();
+        fn(m, begin, end, w, v);
+    }
+
+    // Fold one item (w, v) into m[0..c]; m[j] is the best value with total weight <= j
+    inline void addItem(int *m, int c, int w, int v)
+    {
+        addItemRange(m, w, c + 1, w, v);
+    }
+
+    // m[0..c] = best values over items [begin, end)
+    inline void solveRow(const int *w, const int *v, int begin, int end, int c, int *m)
+    {
+        std::fill(m, m + c + 1, 0);
+        for (int i = begin; i < end; i++)
+            if (w[i] <= c)
+                addItem(m, c, w[i], v[i]);
+    }
+
+    // solveRow over [0, N) on one OpenMP team, entered once. Thread t owns capacities
+    // [lo_t, hi_t) for the whole run and takes the items in tiles of `tile`. Item i only reaches
+    // w_i capacities back, so before folding it, thread t copies the top w_i values of its slab
+    // (still row i - 1) into a halo that thread t + 1 reads in place of t's already-updated slab.
+    // There are no barriers: a per-thread tile counter is the only synchronization. Thread t starts
+    // tile k once t - 1 has finished tile k (its halos are written), and once t + 1 has finished
+    // tile k - 2, which read the halo slot that tile k is about to overwrite.
+    inline void solveRowParallel(const int *w, const int *v, int N, int C, int *m, int num_threads, int tile = 64)
+    {
+        std::vector<int> ws, vs;
+        int max_w = 1;
+        for (int i = 0; i < N; i++)
+        {
+            if (w[i] <= C)
+            {
+                ws.push_back(w[i]);
+                vs.push_back(v[i]);
+                max_w = std::max(max_w, w[i]);
+            }
+        }
+        const int n = static_cast<int>(ws.size());
+        const int tiles = (n + tile - 1) / tile;
+
+        // Each slab must cover the widest reach, and be long enough to amortize a tile handoff
+        int threads = std::max(1, std::min(num_threads, (C + 1) / std::max(max_w, 1024)));
+        struct alignas(64) Progress
+        {
+            std::atomic<int> tiles{0};
+        };
+        std::vector<Progress> done(threads);
+        const size_t slot = static_cast<size_t>(tile) * max_w;
+        std::vector<int> halo(static_cast<size_t>(threads) * 2 * slot);
+        std::fill(m, m + C + 1, 0);
+
+        auto waitFor = [](const std::atomic<int> &flag, int value)
+        {
+            for (int spins = 0; flag.load(std::memory_order_acquire) < value;)
+            {
+                if (++spins < 1024)
+                    _mm_pause();
+                else
+                    std::this_thread::yield();
+            }
+        };
+
+#pragma omp parallel num_threads(threads)
+        {
+#ifdef _OPENMP
+            int t = omp_get_thread_num(), nt = omp_get_num_threads();
+#else
+            int t = 0, nt = 1;
+#endif
+            // Slabs follow the team actually granted, which may be smaller than requested
+            const int lo = static_cast<int>(static_cast<long long>(C + 1) * t / nt);
+            const int hi = static_cast<int>(static_cast<long long>(C + 1) * (t + 1) / nt);
+
+            for (int k = 0; k < tiles; k++)
+            {
+                if (t > 0)
+                    waitFor(done[t - 1].tiles, k + 1);
+                if (t + 1 < nt)
+                    waitFor(done[t + 1].tiles, k - 1);
+
+                int *out = &halo[(static_cast<size_t>(t) * 2 + k % 2) * slot];
+                const int *in = t > 0 ? &halo[(static_cast<size_t>(t - 1) * 2 + k % 2) * slot] : nullptr;
+                for (int i = k * tile, off = 0; i < std::min(n, (k + 1) * tile); off += ws[i], i++)
+                {
+                    const int wi = ws[i], vi = vs[i];
+                    if (t + 1 < nt)
+                        std::copy(m + hi - wi, m + hi, out + off);
+                    addItemRange(m, lo + wi, hi, wi, vi);
+                    // in[off + r] is m[lo - wi + r] of row i - 1
+                    for (int j = lo; t > 0 && j < lo + wi; j++)
+                        m[j] = std::max(m[j], in[off + j - lo] + vi);
+                }
+                done[t].tiles.store(k + 1, std::memory_order_release);
+            }
+        }
+    }
+
+    // Append to `items` an optimal subset of [begin, end) with total weight <= c
+    inline void reconstruct(const int *w, const int *v, int begin, int end, int c, std::vector<int> &items)
+    {
+        if (end - begin == 1)
+        {
+            if (w[begin] <= c && v[begin] > 0)
+                items.push_back(begin);
+            return;
+        }
+
+        int mid = begin + (end - begin) / 2;
+        int split = 0;
+        {
+            // Scoped so both rows are released before recursing: peak memory stays 2 (C + 1) ints
+            std::vector<int> left(c + 1), right(c + 1);
+            solveRow(w, v, begin, mid, c, left.data());
+            solveRow(w, v, mid, end, c, right.data());
+            int best = -1;
+            for (int c1 = 0; c1 <= c; c1++)
+            {
+                if (left[c1] + right[c - c1] > best)
+                {
+                    best = left[c1] + right[c - c1];
+                    split = c1;
+                }
+            }
+        }
+        reconstruct(w, v, begin, mid, split, items);
+        reconstruct(w, v, mid, end, c - split, items);
+    }
+
+    // Indices of an optimal item set for capacity C (ascending)
+    inline std::vector<int> solveItems(const int *w, const int *v, int N, int C)
+    {
+        std::vector<int> items;
+        if (N > 0)
+            reconstruct(w, v, 0, N, C, items);
+        return items;
+    }
+
+    // Sparse engine -----------------------------------------------------------------------------
+
+    // A (weight, value) pair on the Pareto frontier; 64-bit so weight sums past 2^31 cannot wrap
+    struct Point
+    {
+        long long weight, value;
+    };
+
+    // Best value with total weight <= C, from the non-dominated (weight, value) pairs only.
+    // The frontier is sorted by weight with strictly increasing value. Item i shifts it by
+    // (w_i, v_i), the shifted copy is cut at C, and both are merged by weight in one two-pointer
+    // pass that keeps a pair only if it beats every lighter one. Cost is the sum of the frontier
+    // sizes, independent of C. `max_frontier`, if given, receives the largest frontier seen.
+    inline long long solveSparse(const int *w, const int *v, int N, long long C, size_t *max_frontier = nullptr)
+    {
+        std::vector<Point> frontier = {{0, 0}}, next;
+        size_t largest = 1;
+        for (int i = 0; i < N; i++)
+        {
+            const long long wi = w[i], vi = v[i];
+            next.clear();
+            size_t a = 0, b = 0;
+            const size_t n = frontier.size();
+            long long best = -1;
+            auto emit = [&](Point p)
+            {
+                if (p.value > best)
+                {
+                    next.push_back(p);
+                    best = p.value;
+                }
+            };
+            while (a < n || b < n)
+            {
+                bool shifted_ok = b < n && frontier[b].weight + wi <= C;
+                if (!shifted_ok)
+                {
+                    // The shifted copy is past C (it is sorted): finish with the unshifted one
+                    for (; a < n; a++)
+                        emit(frontier[a]);
+                    break;
+                }
+                Point shifted = {frontier[b].weight + wi, frontier[b].value + vi};
+                // Lighter first; on equal weight the larger value first so the other is dropped
+                if (a < n && (frontier[a].weight < shifted.weight ||
+                              (frontier[a].weight == shifted.weight && frontier[a].value >= shifted.value)))
+                {
+                    emit(frontier[a++]);
+                }
+                else
+                {
+                    emit(shifted);
+                    b++;
+                }
+            }
+            frontier.swap(next);
+            largest = std::max(largest, frontier.size());
+        }
+        if (max_frontier)
+            *max_frontier = largest;
+        return frontier.back().value;
+    }
+
+    // Engine selection --------------------------------------------------------------------------
+
+    enum class Engine
+    {
+        Dense, // rolling row, O(N C)
+        Sparse // Pareto frontier, O(sum of frontier sizes)
+    };
+
+    // Relative cost of one frontier pair (merged twice: unshifted and shifted, with a
+    // data-dependent branch each) against one capacity of the AVX2 row update; measured on the
+    // Lab 7 inputs as ~10 ns per pair and item against ~0.15-0.25 ns per capacity and item
+    constexpr double SPARSE_PAIR_COST = 50.0;
+    // Rows above this many bytes are not worth allocating; the sparse engine always applies
+    constexpr double DENSE_ROW_LIMIT = 1 << 30;
+
+    // Pick the cheaper engine from cost estimates: the dense engine touches C + 1 - w_i capacities
+    // per item; the frontier after i items holds at most min(2^i, C + 1, v_1 + .. + v_i + 1)
+    // pairs, since weights are distinct and values strictly increasing integers.
+    inline Engine chooseEngine(const int *w, const int *v, int N, long long C)
+    {
+        if (double(C + 1) * sizeof(int) > DENSE_ROW_LIMIT)
+            return Engine::Sparse;
+        double dense = 0, sparse = 0, bound = 1, values = 0;
+        for (int i = 0; i < N; i++)
+        {
+            if (w[i] <= C)
+                dense += double(C + 1 - w[i]);
+            values += v[i];
+            bound = std::min({2 * bound, double(C + 1), values + 1});
+            sparse += bound;
+        }
+        return sparse * SPARSE_PAIR_COST < dense ? Engine::Sparse : Engine::Dense;
+    }
+
+    // Best value for capacity C with the engine chooseEngine picks (reported in `used`, if given).
+    // The dense engine runs in `row` (C + 1 values) when one is given and allocates its own only
+    // otherwise; the sparse engine leaves `row` untouched.
+    inline long long solve(const int *w, const int *v, int N, long long C, Engine *used = nullptr, int *row = nullptr)
+    {
+        Engine engine = chooseEngine(w, v, N, C);
+        if (used)
+            *used = engine;
+        if (engine == Engine::Sparse)
+            return solveSparse(w, v, N, C);
+        std::vector<int> own;
+        if (!row)
+        {
+            own.resize(C + 1);
+            row = own.data();
+        }
+        solveRow(w, v, 0, N, static_cast<int>(C), row);
+        return row[C];
+    }
+}
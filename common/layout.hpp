@@ -0,0 +1,138 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <sstream>
+#include <string>
+
+// 2D block-cyclic distribution descriptors, after ScaLAPACK's array descriptor.
+//
+// An M x N matrix is cut into MB x NB blocks, and the blocks are dealt round-robin over a P x Q
+// grid of workers in both directions: block row bi goes to grid row (bi + rsrc) % P, block column
+// bj to grid column (bj + csrc) % Q. Worker (p, q) has rank p * Q + q. Every 1D distribution the
+// labs used so far is a special case:
+//
+//   rows in blocks      P = T, Q = 1, MB = ceil(M / T), NB = N
+//   cyclic rows         P = T, Q = 1, MB = 1,           NB = N
+//   block-cyclic rows   P = T, Q = 1, MB = b,           NB = N
+//
+// while a 2D grid gives each worker a patch of rows *and* columns: for C = A * B it then reads
+// M / P rows of A and N / Q columns of B instead of M / T rows of A and all of B. The index
+// functions are the ScaLAPACK tools (NUMROC, INDXG2P, INDXG2L, INDXL2G) in 0-based form.
+namespace layout
+{
+    struct Descriptor
+    {
+        size_t M = 0, N = 0;   // global rows and columns
+        size_t MB = 1, NB = 1; // block rows and columns
+        int P = 1, Q = 1;      // worker grid
+        int rsrc = 0, csrc = 0; // grid row / column that owns the first block
+
+        int workers() const { return P * Q; }
+        int gridRow(int rank) const { return rank / Q; }
+        int gridCol(int rank) const { return rank % Q; }
+
+        // Owner of global row i / column j / element (i, j) (INDXG2P)
+        int rowOwner(size_t i) const { return static_cast<int>((i / MB + rsrc) % P); }
+        int colOwner(size_t j) const { return static_cast<int>((j / NB + csrc) % Q); }
+        int owner(size_t i, size_t j) const { return rowOwner(i) * Q + colOwner(j); }
+
+        // Position of global row i / column j in its owner's local array (INDXG2L)
+        size_t localRow(size_t i) const { return i / (MB * P) * MB + i % MB; }
+        size_t localCol(size_t j) const { return j / (NB * Q) * NB + j % NB; }
+
+        // Global row of local row li on grid row p / column of local column lj on grid column q
+        // (INDXL2G)
+        size_t globalRow(size_t li, int p) const
+        {
+            return (li / MB * P + static_cast<size_t>((p - rsrc + P) % P)) * MB + li % MB;
+        }
+        size_t globalCol(size_t lj, int q) const
+        {
+            return (lj / NB * Q + static_cast<size_t>((q - csrc + Q) % Q)) * NB + lj % NB;
+        }
+
+        // Rows / columns held by grid row p / column q (NUMROC)
+        size_t localRows(int p) const { return numroc(M, MB, (p - rsrc + P) % P, P); }
+        size_t localCols(int q) const { return numroc(N, NB, (q - csrc + Q) % Q, Q); }
+        size_t localElements(int rank) const { return localRows(gridRow(rank)) * localCols(gridCol(rank)); }
+
+        // Largest share over the mean: 1 is a perfectly balanced distribution
+        double imbalance() const
+        {
+            size_t most = 0;
+            for (int r = 0; r < workers(); r++)
+                most = std::max(most, localElements(r));
+            return M && N ? double(most) * workers() / (double(M) * N) : 1.0;
+        }
+
+        // "2x4 grid, 64x64 blocks"
+        std::string describe() const
+        {
+            std::ostringstream os;
+            os << P << "x" << Q << " grid, " << MB << "x" << NB << " blocks";
+            return os.str();
+        }
+
+        static size_t numroc(size_t n, size_t nb, int shift, int procs)
+        {
+            size_t blocks = n / nb, extra = n % nb;
+            size_t count = blocks / procs * nb;
+            size_t rest = blocks % procs;
+            if (static_cast<size_t>(shift) < rest)
+                count += nb;
+            else if (static_cast<size_t>(shift) == rest)
+                count += extra;
+            return count;
+        }
+    };
+
+    // The descriptor for an M x N matrix on a P x Q grid with MB x NB blocks; block sizes are
+    // clamped to [1, extent]
+    inline Descriptor blockCyclic2D(size_t M, size_t N, int P, int Q, size_t MB, size_t NB)
+    {
+        Descriptor d;
+        d.M = M;
+        d.N = N;
+        d.P = std::max(P, 1);
+        d.Q = std::max(Q, 1);
+        d.MB = std::max<size_t>(1, std::min(MB, M));
+        d.NB = std::max<size_t>(1, std::min(NB, N));
+        return d;
+    }
+
+    // One contiguous patch per worker: M / P x N / Q blocks
+    inline Descriptor block2D(size_t M, size_t N, int P, int Q)
+    {
+        return blockCyclic2D(M, N, P, Q, (M + P - 1) / std::max(P, 1), (N + Q - 1) / std::max(Q, 1));
+    }
+
+    // The 1D row distributions of Lab5 and Lab7 as descriptors
+    inline Descriptor blockRows(size_t M, size_t N, int workers) { return block2D(M, N, workers, 1); }
+    inline Descriptor cyclicRows(size_t M, size_t N, int workers) { return blockCyclic2D(M, N, workers, 1, 1, N); }
+    inline Descriptor blockCyclicRows(size_t M, size_t N, int workers, size_t MB)
+    {
+        return blockCyclic2D(M, N, workers, 1, MB, N);
+    }
+
+    // P x Q = workers with P <= Q and P as large as possible (the squarest grid)
+    inline void squareGrid(int workers, int &P, int &Q)
+    {
+        P = 1;
+        for (int p = 1; p * p <= workers; p++)
+            if (workers % p == 0)
+                P = p;
+        Q = std::max(workers, 1) / P;
+    }
+
+    // Call fn(row_begin, row_end, col_begin, col_end) for each block worker `rank` owns,
+    // block rows outer, in increasing global order
+    template <typename F>
+    void forEachBlock(const Descriptor &d, int rank, F &&fn)
+    {
+        const int p = d.gridRow(rank), q = d.gridCol(rank);
+        for (size_t i = static_cast<size_t>((p - d.rsrc + d.P) % d.P) * d.MB; i < d.M; i += d.MB * d.P)
+            for (size_t j = static_cast<size_t>((q - d.csrc + d.Q) % d.Q) * d.NB; j < d.N; j += d.NB * d.Q)
+                fn(i, std::min(i + d.MB, d.M), j, std::min(j + d.NB, d.N));
+    }
+}
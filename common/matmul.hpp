@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <immintrin.h>
+#include "isa.hpp"
+
+// Square matrix multiplication against a transposed B: C[i][j] is the dot product of row i of A
+// and row j of B_T, so both operands are read along rows. One variant per instruction set
+// (common/isa.hpp); Lab4 times them against each other and against the blocked engine in
+// common/gemm.hpp.
+namespace matmul
+{
+    // Whether every row of the three matrices starts on a `bytes` boundary, so the SIMD loops can
+    // use aligned loads
+    inline bool rowsAligned(const float *A, const float *B_T, int ld, size_t bytes)
+    {
+        return (reinterpret_cast<uintptr_t>(A) | reinterpret_cast<uintptr_t>(B_T) | ld * sizeof(float)) % bytes == 0;
+    }
+
+    // C = A * B_T^T, one dot product per element. Rows of A, B_T and C are ld elements apart
+    // (ld >= n): n for plain n x n arrays, mem::leadingDim for padded ones (see common/memory.hpp).
+    inline void transposedScalar(const float *A, const float *B_T, float *C, int n, int ld)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            for (int j = 0; j < n; j++)
+            {
+                float sum = 0;
+                for (int k = 0; k < n; k++)
+                {
+                    sum += A[i * ld + k] * B_T[j * ld + k];
+                }
+                C[i * ld + j] = sum;
+            }
+        }
+    }
+
+    // 8 lanes with FMA (n % 8 leftover columns done with a mask). Aligned: every row starts on a
+    // 32-byte boundary, so the loads are _mm256_load_ps.
+    template <bool Aligned>
+    ISA_AVX2 void transposedAVX2Rows(const float *A, const float *B_T, float *C, int n, int ld)
+    {
+        const __m256i tail = _mm256_cmpgt_epi32(_mm256_set1_epi32(n % 8), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        const int full = n - n % 8;
+        for (int i = 0; i < n; i++)
+        {
+            for (int j = 0; j < n; j++)
+            {
+                __m256 sum_vec = _mm256_setzero_ps();
+                for (int k = 0; k < full; k += 8)
+                {
+                    __m256 a_vec = Aligned ? _mm256_load_ps(&A[i * ld + k]) : _mm256_loadu_ps(&A[i * ld + k]);
+                    __m256 b_vec = Aligned ? _mm256_load_ps(&B_T[j * ld + k]) : _mm256_loadu_ps(&B_T[j * ld + k]);
+                    sum_vec = _mm256_fmadd_ps(a_vec, b_vec, sum_vec);
+                }
+                if (full < n)
+                    sum_vec = _mm256_fmadd_ps(_mm256_maskload_ps(&A[i * ld + full], tail), _mm256_maskload_ps(&B_T[j * ld + full], tail), sum_vec);
+                float sum[8];
+                _mm256_storeu_ps(sum, sum_vec);
+                C[i * ld + j] = sum[0] + sum[1] + sum[2] + sum[3] +
+                                sum[4] + sum[5] + sum[6] + sum[7];
+            }
+        }
+    }
+
+    ISA_AVX2 inline void transposedAVX2(const float *A, const float *B_T, float *C, int n, int ld)
+    {
+        if (rowsAligned(A, B_T, ld, 32))
+            transposedAVX2Rows<true>(A, B_T, C, n, ld);
+        else
+            transposedAVX2Rows<false>(A, B_T, C, n, ld);
+    }
+
+    // Same dot products 16 lanes wide; the n % 16 tail is a masked load
+    template <bool Aligned>
+    ISA_AVX512 void transposedAVX512Rows(const float *A, const float *B_T, float *C, int n, int ld)
+    {
+        const __mmask16 tail = static_cast<__mmask16>((1u << (n % 16)) - 1);
+        const int full = n - n % 16;
+        for (int i = 0; i < n; i++)
+        {
+            for (int j = 0; j < n; j++)
+            {
+                __m512 sum_vec = _mm512_setzero_ps();
+                for (int k = 0; k < full; k += 16)
+                {
+                    __m512 a_vec = Aligned ? _mm512_load_ps(&A[i * ld + k]) : _mm512_loadu_ps(&A[i * ld + k]);
+                    __m512 b_vec = Aligned ? _mm512_load_ps(&B_T[j * ld + k]) : _mm512_loadu_ps(&B_T[j * ld + k]);
+                    sum_vec = _mm512_fmadd_ps(a_vec, b_vec, sum_vec);
+                }
+                if (full < n)
+                    sum_vec = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, &A[i * ld + full]), _mm512_maskz_loadu_ps(tail, &B_T[j * ld + full]), sum_vec);
+                alignas(64) float sum[16];
+                _mm512_store_ps(sum, sum_vec);
+                __m256 s8 = _mm256_add_ps(_mm256_load_ps(sum), _mm256_load_ps(sum + 8));
+                __m128 s4 = _mm_add_ps(_mm256_castps256_ps128(s8), _mm256_extractf128_ps(s8, 1));
+                s4 = _mm_add_ps(s4, _mm_movehl_ps(s4, s4));
+                C[i * ld + j] = _mm_cvtss_f32(_mm_add_ss(s4, _mm_movehdup_ps(s4)));
+            }
+        }
+    }
+
+    ISA_AVX512 inline void transposedAVX512(const float *A, const float *B_T, float *C, int n, int ld)
+    {
+        if (rowsAligned(A, B_T, ld, 64))
+            transposedAVX512Rows<true>(A, B_T, C, n, ld);
+        else
+            transposedAVX512Rows<false>(A, B_T, C, n, ld);
+    }
+
+    using TransposedFn = void (*)(const float *, const float *, float *, int, int);
+
+    inline const isa::Variants<TransposedFn> &transposedVariants()
+    {
+        static const isa::Variants<TransposedFn> v = {transposedScalar, transposedAVX2, transposedAVX512};
+        return v;
+    }
+
+    // The best variant for this CPU, chosen once
+    inline void transposed(const float *A, const float *B_T, float *C, int n, int ld)
+    {
+        static const TransposedFn fn = transposedVariants().pick();
+        fn(A, B_T, C, n, ld);
+    }
+}
@@ -0,0 +1,273 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <sys/mman.h>
+#include <utility>
+#include <vector>
+
+// Aligned, huge-page-backed buffers for the matrix kernels.
+//
+// mem::allocate returns 64-byte-aligned memory, so a row that starts on a cache line never splits
+// a SIMD load across two lines. Blocks of 2 MB and more are aligned to 2 MB and marked
+// madvise(MADV_HUGEPAGE), which lets the kernel back them with transparent huge pages: a 32 MB
+// matrix then needs 16 dTLB entries instead of 8192. MEM_HUGEPAGES=0 in the environment turns the
+// advice off, to compare.
+//
+// Released blocks go back to a process-wide mem::Pool and are handed out again for the next
+// request of the same size, already faulted in. That is what a kernel allocating the same
+// scratch buffers on every call (gemm's packing buffers) wants; mem::reserve fills the pool ahead
+// of a timed region. The pool keeps at most MEM_POOL_MB (default 256) megabytes; past that,
+// blocks are freed.
+//
+// mem::leadingDim pads a row to whole cache lines and, when the padded row is a multiple of 4 KiB,
+// by one more line: rows of a 2048-wide float matrix are 8 KiB apart, so element k of every row
+// maps to the same L1 set and the same 4K-aliasing slot, which the extra line staggers.
+namespace mem
+{
+    constexpr size_t CACHE_LINE = 64;
+    constexpr size_t HUGE_PAGE = size_t(2) << 20;
+    constexpr size_t ALIAS_STRIDE = 4096;
+
+    inline bool hugePages()
+    {
+        static const bool on = []
+        {
+            const char *env = std::getenv("MEM_HUGEPAGES");
+            return !(env && std::strcmp(env, "0") == 0);
+        }();
+        return on;
+    }
+
+    // Size and alignment a request is served with (a block is reused only for the same pair)
+    inline size_t blockAlign(size_t bytes, size_t align)
+    {
+        return bytes >= HUGE_PAGE ? std::max(align, HUGE_PAGE) : std::max(align, CACHE_LINE);
+    }
+
+    inline size_t blockBytes(size_t bytes, size_t align)
+    {
+        size_t a = blockAlign(bytes, align);
+        return (std::max<size_t>(bytes, 1) + a - 1) / a * a;
+    }
+
+    // Released blocks, reused by size
+    class Pool
+    {
+    public:
+        static Pool &global()
+        {
+            // Never destroyed: containers with static storage may release into it during exit
+            static Pool *pool = new Pool([]
+                                         {
+                                             const char *env = std::getenv("MEM_POOL_MB");
+                                             return (env ? std::strtoull(env, nullptr, 10) : 256ull) << 20;
+                                         }());
+            return *pool;
+        }
+
+        explicit Pool(size_t limit) : limit_(limit) {}
+
+        Pool(const Pool &) = delete;
+        Pool &operator=(const Pool &) = delete;
+
+        ~Pool() { clear(); }
+
+        // A cached block of exactly this size and alignment, or nullptr
+        void *take(size_t bytes, size_t align)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (size_t i = 0; i < free_.size(); i++)
+            {
+                if (free_[i].bytes == bytes && free_[i].align == align)
+                {
+                    void *p = free_[i].ptr;
+                    cached_ -= bytes;
+                    free_[i] = free_.back();
+                    free_.pop_back();
+                    return p;
+                }
+            }
+            return nullptr;
+        }
+
+        // Keeps the block for reuse; false (and the caller frees it) when the pool is full
+        bool give(void *p, size_t bytes, size_t align)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (cached_ + bytes > limit_)
+                return false;
+            free_.push_back({p, bytes, align});
+            cached_ += bytes;
+            return true;
+        }
+
+        size_t cached() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return cached_;
+        }
+
+        void clear()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (const Block &b : free_)
+                std::free(b.ptr);
+            free_.clear();
+            cached_ = 0;
+        }
+
+    private:
+        struct Block
+        {
+            void *ptr;
+            size_t bytes, align;
+        };
+
+        mutable std::mutex mutex_;
+        std::vector<Block> free_;
+        size_t cached_ = 0;
+        size_t limit_;
+    };
+
+    // At least `bytes` bytes aligned to `align` (64 by default, 2 MB for huge-page-sized blocks);
+    // nullptr when out of memory. A new block is not touched here, so the first thread to write a
+    // page places it. A block reused from the pool is already faulted in, on whichever node its
+    // previous owner wrote it; use numa::Buffer when placement matters.
+    inline void *allocate(size_t bytes, size_t align = CACHE_LINE)
+    {
+        const size_t a = blockAlign(bytes, align), size = blockBytes(bytes, align);
+        if (void *p = Pool::global().take(size, a))
+            return p;
+        void *p = std::aligned_alloc(a, size);
+        if (p && size >= HUGE_PAGE && hugePages())
+            madvise(p, size, MADV_HUGEPAGE); // advice only: without THP the block stays on 4K pages
+        return p;
+    }
+
+    // Give back a block from allocate(bytes, align)
+    inline void release(void *p, size_t bytes, size_t align = CACHE_LINE)
+    {
+        if (p && !Pool::global().give(p, blockBytes(bytes, align), blockAlign(bytes, align)))
+            std::free(p);
+    }
+
+    // Pre-fault `count` blocks of `bytes` and park them in the pool, so the first allocations of
+    // that size inside a timed region neither call the allocator nor page-fault
+    inline void reserve(size_t bytes, int count = 1, size_t align = CACHE_LINE)
+    {
+        std::vector<void *> blocks;
+        for (int i = 0; i < count; i++)
+            if (void *p = allocate(bytes, align))
+            {
+                std::memset(p, 0, blockBytes(bytes, align));
+                blocks.push_back(p);
+            }
+        for (void *p : blocks)
+            release(p, bytes, align);
+    }
+
+    // Row stride, in elements, for `cols` elements of size `elem`: whole cache lines, plus one
+    // line when the row would be a multiple of 4 KiB
+    constexpr size_t leadingDim(size_t cols, size_t elem)
+    {
+        size_t per_line = CACHE_LINE / elem;
+        size_t ld = (cols + per_line - 1) / per_line * per_line;
+        return ld * elem % ALIAS_STRIDE == 0 ? ld + per_line : ld;
+    }
+
+    template <typename T>
+    constexpr size_t leadingDim(size_t cols)
+    {
+        return leadingDim(cols, sizeof(T));
+    }
+
+    // STL allocator over allocate/release: mem::vector<float> is a std::vector whose data() is
+    // 64-byte aligned (and huge-page backed when large)
+    template <typename T>
+    struct Allocator
+    {
+        using value_type = T;
+
+        Allocator() = default;
+        template <typename U>
+        Allocator(const Allocator<U> &) {}
+
+        T *allocate(size_t n)
+        {
+            if (void *p = mem::allocate(n * sizeof(T)))
+                return static_cast<T *>(p);
+            throw std::bad_alloc(); // what std::allocator does; the containers expect it
+        }
+
+        void deallocate(T *p, size_t n) { mem::release(p, n * sizeof(T)); }
+
+        template <typename U>
+        bool operator==(const Allocator<U> &) const { return true; }
+        template <typename U>
+        bool operator!=(const Allocator<U> &) const { return false; }
+    };
+
+    template <typename T>
+    using vector = std::vector<T, Allocator<T>>;
+
+    // Row-major rows x cols matrix with a padded leading dimension (ld() >= cols), zero-filled.
+    // Padding columns are never read by the kernels, but keep every row 64-byte aligned.
+    template <typename T>
+    class Matrix
+    {
+    public:
+        Matrix() = default;
+
+        Matrix(size_t rows, size_t cols, bool padded = true)
+            : rows_(rows), cols_(cols), ld_(padded ? leadingDim<T>(cols) : cols)
+        {
+            data_ = static_cast<T *>(allocate(bytes()));
+            if (data_)
+                std::memset(data_, 0, bytes());
+        }
+
+        Matrix(Matrix &&o) noexcept { *this = std::move(o); }
+
+        Matrix &operator=(Matrix &&o) noexcept
+        {
+            if (this != &o)
+            {
+                release(data_, bytes());
+                rows_ = std::exchange(o.rows_, 0);
+                cols_ = std::exchange(o.cols_, 0);
+                ld_ = std::exchange(o.ld_, 0);
+                data_ = std::exchange(o.data_, nullptr);
+            }
+            return *this;
+        }
+
+        Matrix(const Matrix &) = delete;
+        Matrix &operator=(const Matrix &) = delete;
+
+        ~Matrix() { release(data_, bytes()); }
+
+        explicit operator bool() const { return data_ != nullptr; }
+
+        size_t rows() const { return rows_; }
+        size_t cols() const { return cols_; }
+        size_t ld() const { return ld_; }
+        size_t bytes() const { return rows_ * ld_ * sizeof(T); }
+
+        T *data() { return data_; }
+        const T *data() const { return data_; }
+        T *row(size_t i) { return data_ + i * ld_; }
+        const T *row(size_t i) const { return data_ + i * ld_; }
+        T &operator()(size_t i, size_t j) { return data_[i * ld_ + j]; }
+        const T &operator()(size_t i, size_t j) const { return data_[i * ld_ + j]; }
+
+    private:
+        size_t rows_ = 0, cols_ = 0, ld_ = 0;
+        T *data_ = nullptr;
+    };
+}
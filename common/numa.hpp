@@ -0,0 +1,395 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sstream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+#include "thread_pool.hpp"
+
+// NUMA topology, thread pinning and page placement, without libnuma.
+//
+// Linux places an anonymous page on the node of the CPU that first writes it. Initializing a
+// matrix on the main thread therefore puts all of it on one socket, and every thread on the other
+// socket then reads its rows remotely. The fix is first-touch by the owner: the threads that will
+// compute on a row are pinned to their CPUs and initialize it themselves, under the same block /
+// cyclic / block-cyclic distribution (numa::firstTouch). Data every thread reads can instead be
+// interleaved page by page over the nodes (numa::interleave), which spreads its traffic evenly.
+//
+// The topology comes from /sys/devices/system/node. NUMA_FAKE=<nodes>x<cpus per node> in the
+// environment (or numa::setTopology) replaces it with a fake one, to exercise the placement
+// logic on a single-socket machine: fake CPU id is pinned to allowed CPU id % allowed count, page
+// policies (bind, interleave) are skipped, and placement is checked against the node of the CPU
+// each thread was assigned rather than the node the kernel reports for the page.
+namespace numa
+{
+    // "0-3,8,10-11" -> {0, 1, 2, 3, 8, 10, 11}
+    inline std::vector<int> parseCpuList(const std::string &list)
+    {
+        std::vector<int> cpus;
+        std::stringstream ss(list);
+        std::string part;
+        while (std::getline(ss, part, ','))
+        {
+            int lo, hi;
+            int fields = std::sscanf(part.c_str(), "%d-%d", &lo, &hi);
+            if (fields == 1)
+                cpus.push_back(lo);
+            else if (fields == 2)
+                for (int c = lo; c <= hi; c++)
+                    cpus.push_back(c);
+        }
+        return cpus;
+    }
+
+    struct Topology
+    {
+        std::vector<std::vector<int>> cpus; // CPU ids of each node
+        bool fake = false;
+
+        int nodes() const { return static_cast<int>(cpus.size()); }
+
+        int nodeOf(int cpu) const
+        {
+            for (int n = 0; n < nodes(); n++)
+                if (std::find(cpus[n].begin(), cpus[n].end(), cpu) != cpus[n].end())
+                    return n;
+            return -1;
+        }
+
+        // Real multi-node machine: the page policies and page queries mean something
+        bool placesPages() const { return !fake && nodes() > 1; }
+
+        // "2 nodes (fake): 0-3 | 4-7"
+        std::string describe() const
+        {
+            std::ostringstream os;
+            os << nodes() << (nodes() == 1 ? " node" : " nodes") << (fake ? " (fake)" : "") << ":";
+            for (int n = 0; n < nodes(); n++)
+            {
+                os << (n ? " |" : "") << " ";
+                const std::vector<int> &c = cpus[n];
+                for (size_t i = 0; i < c.size(); i++)
+                {
+                    size_t j = i;
+                    while (j + 1 < c.size() && c[j + 1] == c[j] + 1)
+                        j++;
+                    os << (i ? "," : "") << c[i];
+                    if (j > i)
+                        os << "-" << c[j];
+                    i = j;
+                }
+            }
+            return os.str();
+        }
+
+        static Topology detect()
+        {
+            Topology t;
+            for (int n = 0;; n++)
+            {
+                std::ifstream in("/sys/devices/system/node/node" + std::to_string(n) + "/cpulist");
+                std::string list;
+                if (!in || !std::getline(in, list))
+                    break;
+                t.cpus.push_back(parseCpuList(list));
+            }
+            if (t.cpus.empty()) // no sysfs: one node with every CPU
+            {
+                t.cpus.emplace_back();
+                for (int c = 0; c < static_cast<int>(std::max(1u, std::thread::hardware_concurrency())); c++)
+                    t.cpus[0].push_back(c);
+            }
+            return t;
+        }
+
+        static Topology makeFake(int nodes, int cpus_per_node)
+        {
+            Topology t;
+            t.fake = true;
+            for (int n = 0; n < std::max(nodes, 1); n++)
+            {
+                t.cpus.emplace_back();
+                for (int c = 0; c < std::max(cpus_per_node, 1); c++)
+                    t.cpus[n].push_back(n * cpus_per_node + c);
+            }
+            return t;
+        }
+    };
+
+    // The process-wide topology: detected, or NUMA_FAKE=<nodes>x<cpus per node>
+    inline Topology &topology()
+    {
+        static Topology topo = []
+        {
+            int nodes, per_node;
+            const char *env = std::getenv("NUMA_FAKE");
+            if (env && std::sscanf(env, "%dx%d", &nodes, &per_node) == 2)
+                return Topology::makeFake(nodes, per_node);
+            return Topology::detect();
+        }();
+        return topo;
+    }
+
+    inline void setTopology(Topology t) { topology() = std::move(t); }
+
+    enum class Pinning
+    {
+        None,
+        Compact, // fill node 0's CPUs, then node 1's, ...: neighbours share a socket
+        Scatter  // thread t on node t % nodes: every socket's memory channels in use early
+    };
+
+    inline const char *name(Pinning p)
+    {
+        switch (p)
+        {
+        case Pinning::Compact:
+            return "compact";
+        case Pinning::Scatter:
+            return "scatter";
+        default:
+            return "none";
+        }
+    }
+
+    // The CPUs of each node the process may run on (pool::allowedCpus: taskset, cgroups); a fake
+    // topology's CPUs are all kept, they are mapped at pin time. Falls back to every CPU if the
+    // mask names none of them.
+    inline std::vector<std::vector<int>> usableCpus(const Topology &topo)
+    {
+        if (topo.fake)
+            return topo.cpus;
+        const std::vector<int> allowed = pool::allowedCpus();
+        std::vector<std::vector<int>> usable;
+        for (const std::vector<int> &node : topo.cpus)
+        {
+            usable.emplace_back();
+            for (int cpu : node)
+                if (std::find(allowed.begin(), allowed.end(), cpu) != allowed.end())
+                    usable.back().push_back(cpu);
+        }
+        bool any = std::any_of(usable.begin(), usable.end(), [](const std::vector<int> &n) { return !n.empty(); });
+        return any ? usable : topo.cpus;
+    }
+
+    // CPU for each of `threads` threads under `pinning` (-1: not pinned); wraps when there are
+    // more threads than usable CPUs
+    inline std::vector<int> cpuOrder(const Topology &topo, Pinning pinning, int threads)
+    {
+        const std::vector<std::vector<int>> nodes = usableCpus(topo);
+        std::vector<int> order;
+        if (pinning == Pinning::Compact)
+            for (const std::vector<int> &node : nodes)
+                order.insert(order.end(), node.begin(), node.end());
+        else if (pinning == Pinning::Scatter)
+            for (size_t i = 0;; i++)
+            {
+                size_t before = order.size();
+                for (const std::vector<int> &node : nodes)
+                    if (i < node.size())
+                        order.push_back(node[i]);
+                if (order.size() == before)
+                    break;
+            }
+        std::vector<int> cpus(threads, -1);
+        for (int t = 0; t < threads && !order.empty(); t++)
+            cpus[t] = order[t % order.size()];
+        return cpus;
+    }
+
+    // The real CPU for CPU `cpu` of `topo`: itself if it is in the process affinity mask,
+    // otherwise (and always for a fake topology) allowed CPU cpu % allowed count
+    inline int allowedCpu(int cpu, const Topology &topo = topology())
+    {
+        const std::vector<int> allowed = pool::allowedCpus();
+        if (!topo.fake && std::find(allowed.begin(), allowed.end(), cpu) != allowed.end())
+            return cpu;
+        return allowed[cpu % allowed.size()];
+    }
+
+    // Affinity of a new thread: CPU `cpu` of `topo`, through allowedCpu
+    inline bool setAffinity(pthread_attr_t *attr, int cpu, const Topology &topo = topology())
+    {
+        if (cpu < 0)
+            return true;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(allowedCpu(cpu, topo), &set);
+        return pthread_attr_setaffinity_np(attr, sizeof(set), &set) == 0;
+    }
+
+    // pthread_create with the thread pinned to `cpu` (-1: not pinned). If the pinned create is
+    // refused (an affinity the kernel rejects), the thread is created unpinned instead: it runs
+    // and does its share, only not on its node. Returns pthread_create's error code.
+    inline int createThread(pthread_t *thread, int cpu, void *(*fn)(void *), void *arg,
+                            const Topology &topo = topology())
+    {
+        if (cpu >= 0)
+        {
+            pthread_attr_t attr;
+            int err = pthread_attr_init(&attr);
+            if (err == 0)
+            {
+                if (setAffinity(&attr, cpu, topo))
+                    err = pthread_create(thread, &attr, fn, arg);
+                else
+                    err = EINVAL;
+                pthread_attr_destroy(&attr);
+            }
+            if (err == 0)
+                return 0;
+        }
+        return pthread_create(thread, nullptr, fn, arg);
+    }
+
+    // Run fn(id) for id in [0, cpus.size()) on new threads, thread id pinned to cpus[id] from
+    // its first instruction (so its first touches already land on that CPU's node), and join them.
+    // A thread that cannot be created at all is reported, and its fn(id) runs on the caller.
+    template <typename F>
+    void runPinned(const std::vector<int> &cpus, F &&fn, const Topology &topo = topology())
+    {
+        using Fn = std::remove_reference_t<F>;
+        struct Arg
+        {
+            Fn *fn;
+            int id;
+        };
+        std::vector<Arg> args(cpus.size());
+        std::vector<pthread_t> threads(cpus.size());
+        std::vector<bool> started(cpus.size());
+        for (size_t i = 0; i < cpus.size(); i++)
+        {
+            args[i] = {&fn, static_cast<int>(i)};
+            int err = createThread(&threads[i], cpus[i], [](void *p) -> void *
+                                   {
+                                       Arg *a = static_cast<Arg *>(p);
+                                       (*a->fn)(a->id);
+                                       return nullptr;
+                                   },
+                                   &args[i], topo);
+            started[i] = err == 0;
+            if (err != 0)
+            {
+                std::fprintf(stderr, "numa::runPinned: pthread_create: %s; running thread %zu on the caller\n",
+                             std::strerror(err), i);
+                fn(static_cast<int>(i));
+            }
+        }
+        for (size_t i = 0; i < threads.size(); i++)
+            if (started[i])
+                pthread_join(threads[i], nullptr);
+    }
+
+    // Initialize rows [0, rows) with init(begin, end), each chunk by the thread that owns it
+    // under `policy`, with thread t pinned to cpus[t]. Returns the node (of `topo`) of the thread
+    // that initialized each row, which is where the row's pages went if they span whole pages:
+    // placement is per 4 KiB page (2 MB on huge pages), not per row.
+    template <typename F>
+    std::vector<int> firstTouch(size_t rows, pool::Policy policy, const std::vector<int> &cpus, F &&init,
+                                const Topology &topo = topology())
+    {
+        std::vector<int> node(rows, -1);
+        int workers = static_cast<int>(cpus.size());
+        runPinned(cpus, [&](int id)
+                  {
+                      pool::forEachChunk({0, rows}, policy, id, workers, [&](size_t b, size_t e)
+                                         {
+                                             init(b, e);
+                                             std::fill(node.begin() + b, node.begin() + e, topo.nodeOf(cpus[id]));
+                                         });
+                  },
+                  topo);
+        return node;
+    }
+
+    inline long mbind(void *p, size_t bytes, int mode, const std::vector<int> &nodes)
+    {
+        unsigned long mask = 0;
+        for (int n : nodes)
+            mask |= 1ul << n;
+        return syscall(SYS_mbind, p, bytes, mode, &mask, sizeof(mask) * 8, 0);
+    }
+
+    // Spread the pages of [p, p + bytes) round-robin over every node, before they are touched.
+    // False (and nothing changed) on one node or a fake topology.
+    inline bool interleave(void *p, size_t bytes, const Topology &topo = topology())
+    {
+        if (!topo.placesPages())
+            return false;
+        std::vector<int> all(topo.nodes());
+        for (int n = 0; n < topo.nodes(); n++)
+            all[n] = n;
+        return mbind(p, bytes, MPOL_INTERLEAVE, all) == 0;
+    }
+
+    // Put the pages of [p, p + bytes) on `node`, before they are touched; false as interleave
+    inline bool bind(void *p, size_t bytes, int node, const Topology &topo = topology())
+    {
+        return topo.placesPages() && mbind(p, bytes, MPOL_BIND, {node}) == 0;
+    }
+
+    // Node of each page of [p, p + bytes), as the kernel reports it (move_pages without a
+    // target); a negative errno for a page that is not mapped in yet
+    inline std::vector<int> pageNodes(const void *p, size_t bytes)
+    {
+        const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        uintptr_t first = reinterpret_cast<uintptr_t>(p) / page * page;
+        size_t count = (reinterpret_cast<uintptr_t>(p) + bytes - first + page - 1) / page;
+        std::vector<void *> pages(count);
+        std::vector<int> status(count, -ENOENT);
+        for (size_t i = 0; i < count; i++)
+            pages[i] = reinterpret_cast<void *>(first + i * page);
+        if (syscall(SYS_move_pages, 0, count, pages.data(), nullptr, status.data(), 0) != 0)
+            std::fill(status.begin(), status.end(), -ENOSYS);
+        return status;
+    }
+
+    // Page-aligned anonymous memory that nothing has touched yet, so its placement is decided by
+    // bind / interleave / the first writer. Unlike mem::allocate it never comes from a pool of
+    // already-faulted blocks, and it stays on 4 KiB pages so placement follows rows, not 2 MB.
+    class Buffer
+    {
+    public:
+        explicit Buffer(size_t bytes) : bytes_(bytes)
+        {
+            void *p = mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED)
+                return;
+            data_ = p;
+            madvise(data_, bytes_, MADV_NOHUGEPAGE);
+        }
+
+        Buffer(const Buffer &) = delete;
+        Buffer &operator=(const Buffer &) = delete;
+
+        ~Buffer()
+        {
+            if (data_)
+                munmap(data_, bytes_);
+        }
+
+        explicit operator bool() const { return data_ != nullptr; }
+
+        void *data() const { return data_; }
+        size_t bytes() const { return bytes_; }
+
+    private:
+        void *data_ = nullptr;
+        size_t bytes_;
+    };
+}
@@ -0,0 +1,342 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "gemm.hpp"
+#include "random.hpp"
+#include "stream.hpp"
+
+// Out-of-core GEMM over memory-mapped, tiled matrix files.
+//
+// File format (native endianness): a 4 KiB header page, then the payload as square tiles of
+// `tile` x `tile` elements in row-major tile order, each tile row-major and contiguous. Edge tiles
+// are stored full size with zero padding, so every tile product is a full tile x tile GEMM and the
+// padding contributes nothing. The header holds the magic "PDCTILE1", version, dtype, rows, cols,
+// tile and the payload offset.
+//
+// ooc::multiply computes C = A * B one tile product at a time (C tile rows, C tile columns, then
+// the shared dimension), accumulating each C tile in memory and writing it back once. An I/O
+// thread walks the same sequence a few steps ahead: it asks for the next A and B tiles with
+// madvise(MADV_WILLNEED) and touches one word per page, so the tiles are resident by the time the
+// compute thread reaches them. The steps are handed over through a bounded stream::Ring, which
+// caps how far I/O runs ahead. The tile products use gemm::gemm / gemm::gemmParallel.
+namespace ooc
+{
+    enum class DType : uint32_t
+    {
+        F32 = 1,
+        F64 = 2
+    };
+
+    template <typename T>
+    constexpr DType dtypeOf();
+    template <>
+    constexpr DType dtypeOf<float>() { return DType::F32; }
+    template <>
+    constexpr DType dtypeOf<double>() { return DType::F64; }
+
+    inline size_t dtypeSize(DType d) { return d == DType::F64 ? 8 : 4; }
+
+    constexpr char MAGIC[8] = {'P', 'D', 'C', 'T', 'I', 'L', 'E', '1'};
+    constexpr uint32_t VERSION = 1;
+    constexpr uint64_t HEADER_BYTES = 4096;
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        DType dtype;
+        uint64_t rows, cols;
+        uint32_t tile, reserved;
+        uint64_t payload; // byte offset of tile (0, 0)
+    };
+
+    // A mapped matrix file. Failures (open, size, header) leave it invalid with error() set.
+    class Matrix
+    {
+    public:
+        Matrix() = default;
+        Matrix(const Matrix &) = delete;
+        Matrix &operator=(const Matrix &) = delete;
+        Matrix(Matrix &&o) noexcept { *this = std::move(o); }
+
+        Matrix &operator=(Matrix &&o) noexcept
+        {
+            std::swap(fd_, o.fd_);
+            std::swap(base_, o.base_);
+            std::swap(bytes_, o.bytes_);
+            std::swap(header_, o.header_);
+            std::swap(error_, o.error_);
+            return *this;
+        }
+
+        ~Matrix()
+        {
+            if (base_)
+                munmap(base_, bytes_);
+            if (fd_ >= 0)
+                close(fd_);
+        }
+
+        // New zero-filled file of rows x cols, mapped read-write
+        static Matrix create(const std::string &path, uint64_t rows, uint64_t cols, uint32_t tile, DType dtype)
+        {
+            Matrix m;
+            m.header_ = Header{{}, VERSION, dtype, rows, cols, tile, 0, HEADER_BYTES};
+            std::memcpy(m.header_.magic, MAGIC, sizeof(MAGIC));
+            m.fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (m.fd_ < 0)
+                return m.fail("cannot create " + path);
+            m.bytes_ = HEADER_BYTES + m.tileRows() * m.tileCols() * m.tileBytes();
+            if (ftruncate(m.fd_, static_cast<off_t>(m.bytes_)) != 0 || !m.map(true))
+                return m.fail("cannot size or map " + path);
+            std::memcpy(m.base_, &m.header_, sizeof(Header));
+            return m;
+        }
+
+        // Existing file; read-only unless writable
+        static Matrix open(const std::string &path, bool writable = false)
+        {
+            Matrix m;
+            m.fd_ = ::open(path.c_str(), (writable ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+            struct stat st;
+            if (m.fd_ < 0 || fstat(m.fd_, &st) != 0)
+                return m.fail("cannot open " + path);
+            if (static_cast<uint64_t>(st.st_size) < HEADER_BYTES || pread(m.fd_, &m.header_, sizeof(Header), 0) != sizeof(Header) ||
+                std::memcmp(m.header_.magic, MAGIC, sizeof(MAGIC)) != 0 || m.header_.version != VERSION || m.header_.tile == 0)
+                return m.fail(path + " is not a tiled matrix file", false);
+            m.bytes_ = m.header_.payload + m.tileRows() * m.tileCols() * m.tileBytes();
+            if (static_cast<uint64_t>(st.st_size) < m.bytes_)
+                return m.fail(path + " is truncated", false);
+            if (!m.map(writable))
+                return m.fail("cannot map " + path);
+            return m;
+        }
+
+        explicit operator bool() const { return base_ != nullptr; }
+        const std::string &error() const { return error_; }
+
+        uint64_t rows() const { return header_.rows; }
+        uint64_t cols() const { return header_.cols; }
+        uint32_t tile() const { return header_.tile; }
+        DType dtype() const { return header_.dtype; }
+        uint64_t tileRows() const { return (header_.rows + header_.tile - 1) / header_.tile; }
+        uint64_t tileCols() const { return (header_.cols + header_.tile - 1) / header_.tile; }
+        uint64_t tileBytes() const { return uint64_t(header_.tile) * header_.tile * dtypeSize(header_.dtype); }
+        uint64_t fileBytes() const { return bytes_; }
+
+        template <typename T>
+        T *tileData(uint64_t bi, uint64_t bj) const
+        {
+            return reinterpret_cast<T *>(static_cast<char *>(base_) + header_.payload + (bi * tileCols() + bj) * tileBytes());
+        }
+
+        // madvise() on the pages of one tile
+        void adviseTile(uint64_t bi, uint64_t bj, int advice) const
+        {
+            madvise(tileData<char>(bi, bj), tileBytes(), advice);
+        }
+
+        // Make a tile resident by reading one byte per page
+        void touchTile(uint64_t bi, uint64_t bj) const
+        {
+            const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            const char *p = tileData<char>(bi, bj);
+            volatile char sink = 0;
+            for (size_t off = 0; off < tileBytes(); off += page)
+                sink = sink + p[off];
+        }
+
+        // Write dirty pages back to the file
+        void sync() const { msync(base_, bytes_, MS_SYNC); }
+
+        // Write back, unmap the pages and drop the file from the page cache, so the next pass reads
+        // from disk (what a matrix larger than RAM sees on every pass)
+        void evict() const
+        {
+            sync();
+            madvise(base_, bytes_, MADV_DONTNEED);
+            posix_fadvise(fd_, 0, 0, POSIX_FADV_DONTNEED);
+        }
+
+    private:
+        bool map(bool writable)
+        {
+            void *p = mmap(nullptr, bytes_, PROT_READ | (writable ? PROT_WRITE : 0), MAP_SHARED, fd_, 0);
+            base_ = p == MAP_FAILED ? nullptr : p;
+            return base_ != nullptr;
+        }
+
+        Matrix fail(const std::string &what, bool system_error = true)
+        {
+            error_ = system_error ? what + ": " + std::strerror(errno) : what;
+            if (base_)
+                munmap(base_, bytes_);
+            base_ = nullptr;
+            return std::move(*this);
+        }
+
+        int fd_ = -1;
+        void *base_ = nullptr;
+        uint64_t bytes_ = 0;
+        Header header_ = {};
+        std::string error_;
+    };
+
+    // Element (i, j) of the counter-based stream rng::fill_uniform would put at i * cols + j of
+    // a dense rows x cols array, written tile by tile (the matrix never has to fit in memory)
+    template <typename T>
+    void fillUniform(Matrix &m, T lo, T hi, uint64_t seed)
+    {
+        const uint64_t t = m.tile();
+        for (uint64_t bi = 0; bi < m.tileRows(); bi++)
+            for (uint64_t bj = 0; bj < m.tileCols(); bj++)
+            {
+                T *dst = m.tileData<T>(bi, bj);
+                uint64_t c0 = bj * t, c1 = std::min(m.cols(), c0 + t);
+                for (uint64_t r = 0; r < t && bi * t + r < m.rows(); r++)
+                {
+                    uint64_t row = bi * t + r;
+                    rng::fillRange(dst + r * t, row * m.cols() + c0, row * m.cols() + c1, lo, hi, seed);
+                }
+            }
+    }
+
+    // Dense row-major copy in and out (for checks against the in-core kernels)
+    template <typename T>
+    void store(Matrix &m, const T *dense)
+    {
+        const uint64_t t = m.tile();
+        for (uint64_t i = 0; i < m.rows(); i++)
+            for (uint64_t bj = 0; bj < m.tileCols(); bj++)
+                std::copy(dense + i * m.cols() + bj * t, dense + i * m.cols() + std::min(m.cols(), (bj + 1) * t),
+                          m.tileData<T>(i / t, bj) + (i % t) * t);
+    }
+
+    template <typename T>
+    void load(const Matrix &m, T *dense)
+    {
+        const uint64_t t = m.tile();
+        for (uint64_t i = 0; i < m.rows(); i++)
+            for (uint64_t bj = 0; bj < m.tileCols(); bj++)
+            {
+                const T *src = m.tileData<T>(i / t, bj) + (i % t) * t;
+                std::copy(src, src + std::min<uint64_t>(t, m.cols() - bj * t), dense + i * m.cols() + bj * t);
+            }
+    }
+
+    // read_bytes of /proc/self/io: bytes this process caused to be read from storage, kernel
+    // readahead around the faulting pages included; 0 where the file is unavailable
+    inline uint64_t processReadBytes()
+    {
+        std::ifstream io("/proc/self/io");
+        std::string key;
+        uint64_t value;
+        while (io >> key >> value)
+            if (key == "read_bytes:")
+                return value;
+        return 0;
+    }
+
+    struct Stats
+    {
+        double wall = 0;          // seconds for the whole product, writeback included
+        double io = 0;            // I/O thread busy seconds (advising and faulting tiles in)
+        double compute = 0;       // compute thread busy seconds (tile GEMMs, copies into C)
+        double stall = 0;         // compute seconds spent waiting for a tile
+        double writeback = 0;     // seconds in the final msync of C
+        uint64_t bytes_read = 0;  // bytes the process read from storage meanwhile (0 if unknown)
+        uint64_t tile_products = 0;
+
+        // Share of the I/O time hidden behind compute: 1 when compute never waited for a tile,
+        // 0 when every second of I/O was a second of stall
+        double overlap() const
+        {
+            return io > 0 ? 1.0 - std::min(stall, io) / io : 1.0;
+        }
+    };
+
+    // C = A * B with `threads` threads per tile GEMM and up to `depth` steps prefetched. Returns
+    // false (C untouched) when the shapes, tiles or dtypes do not match.
+    template <typename T>
+    bool multiply(const Matrix &A, const Matrix &B, Matrix &C, Stats &st, int threads = 1, size_t depth = 4)
+    {
+        if (A.dtype() != dtypeOf<T>() || B.dtype() != dtypeOf<T>() || C.dtype() != dtypeOf<T>() || A.tile() != B.tile() ||
+            A.tile() != C.tile() || A.cols() != B.rows() || C.rows() != A.rows() || C.cols() != B.cols())
+            return false;
+
+        using clock = std::chrono::steady_clock;
+        auto seconds = [](clock::time_point a, clock::time_point b)
+        { return std::chrono::duration<double>(b - a).count(); };
+
+        const int t = static_cast<int>(A.tile());
+        const uint64_t TI = C.tileRows(), TJ = C.tileCols(), TK = A.tileCols();
+        const uint64_t steps = TI * TJ * TK;
+        auto decode = [&](uint64_t s, uint64_t &bi, uint64_t &bj, uint64_t &bk)
+        {
+            bk = s % TK;
+            bj = (s / TK) % TJ;
+            bi = s / (TK * TJ);
+        };
+
+        st = Stats{};
+        st.tile_products = steps;
+        stream::Ring ready(std::max<size_t>(depth, 1));
+        const uint64_t read_before = processReadBytes();
+        auto start = clock::now();
+        std::thread io([&]
+                       {
+                           for (uint64_t s = 0; s < steps; s++)
+                           {
+                               uint64_t bi, bj, bk;
+                               decode(s, bi, bj, bk);
+                               auto t0 = clock::now();
+                               A.adviseTile(bi, bk, MADV_WILLNEED);
+                               B.adviseTile(bk, bj, MADV_WILLNEED);
+                               A.touchTile(bi, bk);
+                               B.touchTile(bk, bj);
+                               st.io += seconds(t0, clock::now());
+                               ready.push(s);
+                           }
+                       });
+
+        std::vector<T> acc(size_t(t) * t);
+        for (uint64_t s = 0; s < steps; s++)
+        {
+            auto t0 = clock::now();
+            ready.pop();
+            auto t1 = clock::now();
+            st.stall += seconds(t0, t1);
+
+            uint64_t bi, bj, bk;
+            decode(s, bi, bj, bk);
+            const T *a = A.tileData<T>(bi, bk), *b = B.tileData<T>(bk, bj);
+            T beta = bk == 0 ? T(0) : T(1);
+            if (threads > 1)
+                gemm::gemmParallel<T>(t, t, t, a, t, b, t, acc.data(), t, T(1), beta, threads);
+            else
+                gemm::gemm<T>(t, t, t, a, t, b, t, acc.data(), t, T(1), beta);
+            if (bk == TK - 1)
+                std::copy(acc.begin(), acc.end(), C.tileData<T>(bi, bj));
+            st.compute += seconds(t1, clock::now());
+        }
+        io.join();
+        auto t0 = clock::now();
+        C.sync();
+        st.writeback = seconds(t0, clock::now());
+        st.bytes_read = processReadBytes() - read_before;
+        st.wall = seconds(start, clock::now());
+        return true;
+    }
+}
@@ -0,0 +1,296 @@
+#pragma once
+
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <iomanip>
+#include <iostream>
+#include <linux/perf_event.h>
+#include <sstream>
+#include <string>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+// Hardware and software event counters around a region, from Linux perf_event_open.
+//
+// A perf::Scope opens one counter per event for each thread of the process (or only the calling
+// thread), with inherit set so that threads spawned inside the region are counted into the thread
+// that spawned them, and reads them when it stops. Hardware counts are user-space only
+// (exclude_kernel), which an unprivileged process may measure at the default perf_event_paranoid
+// of 2, and are scaled by time_enabled / time_running when the PMU multiplexes. The derived
+// figures are the ones the lab write-ups argue with: IPC, misses per thousand instructions and
+// LLC bytes per FLOP.
+//
+// Any event the kernel refuses (no PMU in a VM, paranoid 3, seccomp) is probed once, reported once
+// on stderr and then skipped: a Scope never fails, it only has fewer valid counts. PERF_COUNTERS=0
+// in the environment turns every Scope into a no-op.
+namespace perf
+{
+    enum Event
+    {
+        Cycles,
+        Instructions,
+        L1DMisses,
+        LLCMisses,
+        DTLBMisses,
+        BranchMisses,
+        TaskClock, // ns of CPU time
+        PageFaults,
+        ContextSwitches,
+        EVENT_COUNT
+    };
+
+    struct EventSpec
+    {
+        const char *name;
+        uint32_t type;
+        uint64_t config;
+    };
+
+    constexpr uint64_t cacheMiss(uint64_t cache, uint64_t op)
+    {
+        return cache | (op << 8) | (uint64_t(PERF_COUNT_HW_CACHE_RESULT_MISS) << 16);
+    }
+
+    inline const EventSpec &spec(Event e)
+    {
+        static const EventSpec specs[EVENT_COUNT] = {
+            {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {"L1D-load-misses", PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ)},
+            {"LLC-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {"dTLB-load-misses", PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ)},
+            {"branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            {"task-clock", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+            {"page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+            {"context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+        };
+        return specs[e];
+    }
+
+    constexpr double LINE_BYTES = 64;
+
+    struct Counts
+    {
+        double value[EVENT_COUNT] = {};
+        bool valid[EVENT_COUNT] = {};
+
+        bool has(Event e) const { return valid[e]; }
+        double operator[](Event e) const { return valid[e] ? value[e] : NAN; }
+
+        Counts &operator+=(const Counts &o)
+        {
+            for (int e = 0; e < EVENT_COUNT; e++)
+            {
+                value[e] += o.value[e];
+                valid[e] = valid[e] || o.valid[e];
+            }
+            return *this;
+        }
+
+        // Derived figures; NaN when a counter they need is missing
+        double ipc() const { return (*this)[Instructions] / (*this)[Cycles]; }
+        double mpki(Event miss) const { return 1e3 * (*this)[miss] / (*this)[Instructions]; }
+        double llcBytesPerFlop(double flops) const { return flops > 0 ? LINE_BYTES * (*this)[LLCMisses] / flops : NAN; }
+    };
+
+    inline std::string format(double x, int precision = 3)
+    {
+        if (std::isnan(x))
+            return "n/a";
+        std::ostringstream os;
+        os << std::setprecision(precision) << x;
+        return os.str();
+    }
+
+    // "IPC 2.1, L1D 12.3 MPKI, ..." for a report line
+    inline std::string summary(const Counts &c, double flops = 0)
+    {
+        std::ostringstream os;
+        os << "IPC " << format(c.ipc()) << ", L1D " << format(c.mpki(L1DMisses)) << " MPKI, LLC "
+           << format(c.mpki(LLCMisses)) << " MPKI, dTLB " << format(c.mpki(DTLBMisses)) << " MPKI, branch "
+           << format(c.mpki(BranchMisses)) << " MPKI";
+        if (flops > 0)
+            os << ", LLC bytes/FLOP " << format(c.llcBytesPerFlop(flops));
+        os << ", CPU " << format(c[TaskClock] * 1e-6) << " ms, " << format(c[PageFaults], 6) << " page faults, "
+           << format(c[ContextSwitches], 6) << " context switches";
+        return os.str();
+    }
+
+    inline bool disabled()
+    {
+        static const bool off = [] {
+            const char *env = std::getenv("PERF_COUNTERS");
+            return env && std::strcmp(env, "0") == 0;
+        }();
+        return off;
+    }
+
+    inline int openCounter(Event e, pid_t tid)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = spec(e).type;
+        attr.config = spec(e).config;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        // Software events happen in the kernel (a context switch never shows in user space), so
+        // they are counted kernel-side where that is allowed and user-only otherwise
+        attr.exclude_kernel = spec(e).type == PERF_TYPE_SOFTWARE ? 0 : 1;
+        int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, tid, -1, -1, PERF_FLAG_FD_CLOEXEC));
+        if (fd < 0 && !attr.exclude_kernel)
+        {
+            attr.exclude_kernel = 1;
+            fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, tid, -1, -1, PERF_FLAG_FD_CLOEXEC));
+        }
+        return fd;
+    }
+
+    // Which events this process can open, probed once on the calling thread; the refused ones
+    // are listed on stderr the first time
+    inline const std::vector<bool> &supported()
+    {
+        static const std::vector<bool> ok = [] {
+            std::vector<bool> ok(EVENT_COUNT, false);
+            if (disabled())
+                return ok;
+            std::ostringstream refused;
+            for (int e = 0; e < EVENT_COUNT; e++)
+            {
+                int fd = openCounter(Event(e), 0);
+                ok[e] = fd >= 0;
+                if (fd >= 0)
+                    close(fd);
+                else
+                    refused << " " << spec(Event(e)).name << " (" << std::strerror(errno) << ")";
+            }
+            if (!refused.str().empty())
+                std::cerr << "perf: counters unavailable, reported as n/a:" << refused.str() << "\n";
+            return ok;
+        }();
+        return ok;
+    }
+
+    inline bool available(Event e) { return supported()[e]; }
+
+    inline std::vector<pid_t> processThreads()
+    {
+        std::vector<pid_t> tids;
+        if (DIR *dir = opendir("/proc/self/task"))
+        {
+            while (dirent *d = readdir(dir))
+                if (d->d_name[0] != '.')
+                    tids.push_back(static_cast<pid_t>(std::atoi(d->d_name)));
+            closedir(dir);
+        }
+        return tids;
+    }
+
+    // Counters of one region. Starts in the constructor; stop() (or the destructor) reads them.
+    // With a label, the destructor also prints one report line.
+    class Scope
+    {
+    public:
+        enum Threads
+        {
+            ThisThread, // the calling thread and the threads it spawns in the region
+            Process     // every thread alive at construction, plus what they spawn
+        };
+
+        explicit Scope(Threads which = Process, std::string label = "", double flops = 0)
+            : label_(std::move(label)), flops_(flops)
+        {
+            if (disabled())
+                return;
+            std::vector<pid_t> tids = which == Process ? processThreads() : std::vector<pid_t>{0};
+            const std::vector<bool> &ok = supported();
+            for (pid_t tid : tids)
+            {
+                Thread t{tid == 0 ? static_cast<pid_t>(syscall(SYS_gettid)) : tid, {}, {}};
+                for (int e = 0; e < EVENT_COUNT; e++)
+                    t.fd[e] = ok[e] ? openCounter(Event(e), tid) : -1; // a thread may exit meanwhile
+                threads_.push_back(t);
+            }
+            for (Thread &t : threads_)
+                for (int fd : t.fd)
+                    if (fd >= 0)
+                        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+        ~Scope()
+        {
+            stop();
+            if (!label_.empty())
+                report(std::cout);
+            for (Thread &t : threads_)
+                for (int fd : t.fd)
+                    if (fd >= 0)
+                        close(fd);
+        }
+
+        void stop()
+        {
+            if (stopped_)
+                return;
+            stopped_ = true;
+            for (Thread &t : threads_)
+                for (int fd : t.fd)
+                    if (fd >= 0)
+                        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            for (Thread &t : threads_)
+            {
+                for (int e = 0; e < EVENT_COUNT; e++)
+                {
+                    uint64_t r[3]; // value, time enabled, time running
+                    if (t.fd[e] < 0 || read(t.fd[e], r, sizeof(r)) != sizeof(r) || r[2] == 0)
+                        continue;
+                    t.counts.value[e] = r[2] < r[1] ? double(r[0]) * double(r[1]) / double(r[2]) : double(r[0]);
+                    t.counts.valid[e] = true;
+                }
+                total_ += t.counts;
+            }
+        }
+
+        // Sum over the threads, and per thread (tid, counts)
+        const Counts &total() const { return total_; }
+
+        std::vector<std::pair<pid_t, Counts>> perThread() const
+        {
+            std::vector<std::pair<pid_t, Counts>> out;
+            for (const Thread &t : threads_)
+                out.emplace_back(t.tid, t.counts);
+            return out;
+        }
+
+        void report(std::ostream &os) const
+        {
+            os << label_ << ": " << summary(total_, flops_) << "\n";
+        }
+
+    private:
+        struct Thread
+        {
+            pid_t tid;
+            int fd[EVENT_COUNT];
+            Counts counts;
+        };
+
+        std::string label_;
+        double flops_;
+        bool stopped_ = false;
+        std::vector<Thread> threads_;
+        Counts total_;
+    };
+}
@@ -0,0 +1,280 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <immintrin.h>
+#include "isa.hpp"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Counter-based random fills that are reproducible at any thread count.
+//
+// Philox4x32-10 (Salmon et al., SC'11) turns a 64-bit counter and a 64-bit key (the seed) into
+// four 32-bit words with 10 rounds of multiply/xor; there is no state to carry from one value to
+// the next, so any element can be generated directly from its index. The word stream is laid out
+// in blocks of 32 words over 8 consecutive counters, word-major:
+//   word q = (block b, word w, lane l) with q = 32 b + 8 w + l, from counter 8 b + l,
+// so one AVX2 pass of 8 Philox lanes yields 32 consecutive words. Floats and ints take one word
+// per element; doubles take words 2p and 2p + 1 of counter e / 2 (p = e % 2) for 53 bits.
+// Each thread fills whole 32-word blocks of its share, and the value at index i never depends on
+// who computed it, so the output for a seed is bit-identical for any number of threads. It does
+// not depend on the instruction set either: without AVX2 (common/isa.hpp) a block is 8 scalar
+// Philox calls, and the float conversion is the same fma in both paths.
+namespace rng
+{
+    constexpr uint32_t PHILOX_M0 = 0xD2511F53u, PHILOX_M1 = 0xCD9E8D57u;
+    constexpr uint32_t PHILOX_W0 = 0x9E3779B9u, PHILOX_W1 = 0xBB67AE85u;
+
+    // The four words of counter (c0, c1, c2, c3) under key (k0, k1)
+    inline void philox(uint32_t c[4], uint32_t k0, uint32_t k1)
+    {
+        for (int round = 0; round < 10; round++)
+        {
+            uint64_t p0 = static_cast<uint64_t>(PHILOX_M0) * c[0];
+            uint64_t p1 = static_cast<uint64_t>(PHILOX_M1) * c[2];
+            uint32_t n0 = static_cast<uint32_t>(p1 >> 32) ^ c[1] ^ k0;
+            uint32_t n2 = static_cast<uint32_t>(p0 >> 32) ^ c[3] ^ k1;
+            c[1] = static_cast<uint32_t>(p1);
+            c[3] = static_cast<uint32_t>(p0);
+            c[0] = n0;
+            c[2] = n2;
+            k0 += PHILOX_W0;
+            k1 += PHILOX_W1;
+        }
+    }
+
+    // (hi, lo) halves of the 8 products m * a
+    ISA_AVX2 inline void mulhilo(__m256i a, __m256i m, __m256i &hi, __m256i &lo)
+    {
+        __m256i even = _mm256_mul_epu32(a, m);
+        __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), m);
+        lo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+        hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+    }
+
+    // Words 0..3 of counters 8 b .. 8 b + 7, one counter per lane
+    ISA_AVX2 inline void philox8(uint64_t block, uint32_t k0, uint32_t k1, __m256i w[4])
+    {
+        uint64_t first = block * 8;
+        __m256i c0 = _mm256_add_epi32(_mm256_set1_epi32(static_cast<uint32_t>(first)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        __m256i c1 = _mm256_set1_epi32(static_cast<uint32_t>(first >> 32));
+        __m256i c2 = _mm256_setzero_si256(), c3 = _mm256_setzero_si256();
+        const __m256i m0 = _mm256_set1_epi32(PHILOX_M0), m1 = _mm256_set1_epi32(PHILOX_M1);
+        for (int round = 0; round < 10; round++)
+        {
+            __m256i hi0, lo0, hi1, lo1;
+            mulhilo(c0, m0, hi0, lo0);
+            mulhilo(c2, m1, hi1, lo1);
+            c0 = _mm256_xor_si256(_mm256_xor_si256(hi1, c1), _mm256_set1_epi32(k0));
+            c2 = _mm256_xor_si256(_mm256_xor_si256(hi0, c3), _mm256_set1_epi32(k1));
+            c1 = lo1;
+            c3 = lo0;
+            k0 += PHILOX_W0;
+            k1 += PHILOX_W1;
+        }
+        w[0] = c0;
+        w[1] = c1;
+        w[2] = c2;
+        w[3] = c3;
+    }
+
+    // The 32 words of block b in stream order, one counter at a time
+    inline void philoxBlock(uint64_t block, uint32_t k0, uint32_t k1, uint32_t words[32])
+    {
+        for (int l = 0; l < 8; l++)
+        {
+            uint64_t counter = block * 8 + l;
+            uint32_t c[4] = {static_cast<uint32_t>(counter), static_cast<uint32_t>(counter >> 32), 0, 0};
+            philox(c, k0, k1);
+            for (int w = 0; w < 4; w++)
+                words[8 * w + l] = c[w];
+        }
+    }
+
+    // Word q of the stream for `seed`, one counter at a time (heads and tails of a fill)
+    inline uint32_t word(uint64_t seed, uint64_t q)
+    {
+        uint64_t counter = (q / 32) * 8 + q % 8;
+        uint32_t c[4] = {static_cast<uint32_t>(counter), static_cast<uint32_t>(counter >> 32), 0, 0};
+        philox(c, static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32));
+        return c[(q / 8) % 4];
+    }
+
+    // Elements per thread chunk; a multiple of 32 so chunks split only at block boundaries
+    constexpr size_t CHUNK = size_t(1) << 16;
+
+    // Float in [lo, lo + scale) from the top 24 bits; the same fma in both paths keeps them identical
+    inline float toFloat(uint32_t x, float lo, float scale)
+    {
+        return std::fma(static_cast<float>(x >> 8) * 0x1p-24f, scale, lo);
+    }
+
+    ISA_AVX2 inline __m256 toFloat(__m256i x, __m256 lo, __m256 scale)
+    {
+        __m256 u = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(x, 8)), _mm256_set1_ps(0x1p-24f));
+        return _mm256_fmadd_ps(u, scale, lo);
+    }
+
+    // Integer in [lo, lo + range) as lo + floor(x * range / 2^32); the bias is below range / 2^32
+    inline int toInt(uint32_t x, int lo, uint64_t range)
+    {
+        return lo + static_cast<int>((static_cast<uint64_t>(x) * range) >> 32);
+    }
+
+    // Elements [begin, end) of the float stream into out[0, end - begin), a block at a time
+    inline void fillRangeScalar(float *out, size_t begin, size_t end, float lo, float hi, uint64_t seed)
+    {
+        const uint32_t k0 = static_cast<uint32_t>(seed), k1 = static_cast<uint32_t>(seed >> 32);
+        const float scale = hi - lo;
+        size_t i = begin;
+        for (; i < end && i % 32 != 0; i++)
+            out[i - begin] = toFloat(word(seed, i), lo, scale);
+        for (; i + 32 <= end; i += 32)
+        {
+            uint32_t words[32];
+            philoxBlock(i / 32, k0, k1, words);
+            for (int r = 0; r < 32; r++)
+                out[i - begin + r] = toFloat(words[r], lo, scale);
+        }
+        for (; i < end; i++)
+            out[i - begin] = toFloat(word(seed, i), lo, scale);
+    }
+
+    // The same elements, AVX2 over the whole blocks
+    ISA_AVX2 inline void fillRangeAVX2(float *out, size_t begin, size_t end, float lo, float hi, uint64_t seed)
+    {
+        const uint32_t k0 = static_cast<uint32_t>(seed), k1 = static_cast<uint32_t>(seed >> 32);
+        const float scale = hi - lo;
+        size_t i = begin;
+        for (; i < end && i % 32 != 0; i++)
+            out[i - begin] = toFloat(word(seed, i), lo, scale);
+        const __m256 vlo = _mm256_set1_ps(lo), vscale = _mm256_set1_ps(scale);
+        // Two independent blocks per step: one block's 10 rounds are a single dependency chain
+        for (; i + 64 <= end; i += 64)
+        {
+            __m256i w[4], x[4];
+            philox8(i / 32, k0, k1, w);
+            philox8(i / 32 + 1, k0, k1, x);
+            for (int r = 0; r < 4; r++)
+                _mm256_storeu_ps(out + (i - begin) + 8 * r, toFloat(w[r], vlo, vscale));
+            for (int r = 0; r < 4; r++)
+                _mm256_storeu_ps(out + (i - begin) + 32 + 8 * r, toFloat(x[r], vlo, vscale));
+        }
+        for (; i + 32 <= end; i += 32)
+        {
+            __m256i w[4];
+            philox8(i / 32, k0, k1, w);
+            for (int r = 0; r < 4; r++)
+                _mm256_storeu_ps(out + (i - begin) + 8 * r, toFloat(w[r], vlo, vscale));
+        }
+        for (; i < end; i++)
+            out[i - begin] = toFloat(word(seed, i), lo, scale);
+    }
+
+    // Elements [begin, end) of the int stream into out[0, end - begin) (same words as floats)
+    inline void fillRangeScalar(int *out, size_t begin, size_t end, int lo, int hi, uint64_t seed)
+    {
+        const uint32_t k0 = static_cast<uint32_t>(seed), k1 = static_cast<uint32_t>(seed >> 32);
+        const uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(hi) - lo) + 1;
+        size_t i = begin;
+        for (; i < end && i % 32 != 0; i++)
+            out[i - begin] = toInt(word(seed, i), lo, range);
+        for (; i + 32 <= end; i += 32)
+        {
+            uint32_t words[32];
+            philoxBlock(i / 32, k0, k1, words);
+            for (int r = 0; r < 32; r++)
+                out[i - begin + r] = toInt(words[r], lo, range);
+        }
+        for (; i < end; i++)
+            out[i - begin] = toInt(word(seed, i), lo, range);
+    }
+
+    ISA_AVX2 inline void fillRangeAVX2(int *out, size_t begin, size_t end, int lo, int hi, uint64_t seed)
+    {
+        const uint32_t k0 = static_cast<uint32_t>(seed), k1 = static_cast<uint32_t>(seed >> 32);
+        const uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(hi) - lo) + 1;
+        size_t i = begin;
+        for (; i < end && i % 32 != 0; i++)
+            out[i - begin] = toInt(word(seed, i), lo, range);
+        for (; i + 32 <= end; i += 32)
+        {
+            __m256i w[4];
+            alignas(32) uint32_t words[32];
+            philox8(i / 32, k0, k1, w);
+            for (int r = 0; r < 4; r++)
+                _mm256_store_si256(reinterpret_cast<__m256i *>(words + 8 * r), w[r]);
+            for (int r = 0; r < 32; r++)
+                out[i - begin + r] = toInt(words[r], lo, range);
+        }
+        for (; i < end; i++)
+            out[i - begin] = toInt(word(seed, i), lo, range);
+    }
+
+    template <typename T>
+    using FillFn = void (*)(T *, size_t, size_t, T, T, uint64_t);
+
+    // Float and int fills per instruction set (doubles have a single scalar path)
+    template <typename T>
+    const isa::Variants<FillFn<T>> &fillVariants()
+    {
+        static const isa::Variants<FillFn<T>> v = {fillRangeScalar, fillRangeAVX2, nullptr};
+        return v;
+    }
+
+    inline void fillRange(float *out, size_t begin, size_t end, float lo, float hi, uint64_t seed)
+    {
+        static const FillFn<float> fn = fillVariants<float>().pick();
+        fn(out, begin, end, lo, hi, seed);
+    }
+
+    inline void fillRange(int *out, size_t begin, size_t end, int lo, int hi, uint64_t seed)
+    {
+        static const FillFn<int> fn = fillVariants<int>().pick();
+        fn(out, begin, end, lo, hi, seed);
+    }
+
+    // Elements [begin, end) of the double stream into out[0, end - begin): 53 bits from two words of counter e / 2
+    inline void fillRange(double *out, size_t begin, size_t end, double lo, double hi, uint64_t seed)
+    {
+        const uint32_t k0 = static_cast<uint32_t>(seed), k1 = static_cast<uint32_t>(seed >> 32);
+        const double scale = hi - lo;
+        for (size_t i = begin; i < end;)
+        {
+            uint64_t counter = i / 2;
+            uint32_t c[4] = {static_cast<uint32_t>(counter), static_cast<uint32_t>(counter >> 32), 0, 0};
+            philox(c, k0, k1);
+            for (; i < end && i / 2 == counter; i++)
+            {
+                int p = static_cast<int>(i % 2);
+                uint64_t bits = (static_cast<uint64_t>(c[2 * p]) << 21) | (c[2 * p + 1] >> 11);
+                out[i - begin] = std::fma(static_cast<double>(bits) * 0x1p-53, scale, lo);
+            }
+        }
+    }
+
+    // data[0..n) = uniform values in [lo, hi) ([lo, hi] for int) from `seed`, split over
+    // num_threads (0 = all available). The result does not depend on num_threads.
+    template <typename T>
+    void fill_uniform(T *data, size_t n, T lo, T hi, uint64_t seed, int num_threads = 0)
+    {
+#ifdef _OPENMP
+        if (num_threads <= 0)
+            num_threads = omp_get_max_threads();
+#endif
+        const long long chunks = static_cast<long long>((n + CHUNK - 1) / CHUNK);
+#pragma omp parallel for schedule(static) num_threads(std::max(num_threads, 1))
+        for (long long c = 0; c < chunks; c++)
+            fillRange(data + size_t(c) * CHUNK, size_t(c) * CHUNK, std::min(n, size_t(c + 1) * CHUNK), lo, hi, seed);
+    }
+
+    // Any contiguous container (std::vector, std::array, ...)
+    template <typename Container, typename T>
+    void fill_uniform(Container &span, T lo, T hi, uint64_t seed, int num_threads = 0)
+    {
+        fill_uniform(span.data(), span.size(), lo, hi, seed, num_threads);
+    }
+}
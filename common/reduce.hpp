@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <immintrin.h>
+#include "isa.hpp"
+
+// Sums that only stream through their input: the read side of the bandwidth tables and the
+// checksums of the vector pipelines.
+//
+// Eight running sums keep the adds independent, so the loop runs at load speed instead of at the
+// latency of one dependent add chain, and are combined pairwise at the end. The AVX2 variant keeps
+// them in two ymm registers; the scalar one keeps the same eight sums and combines them in the
+// same order, so every variant (common/isa.hpp) returns the same bits.
+namespace reduce
+{
+    // Sum of p[0..n)
+    inline double sumScalar(const double *p, size_t n)
+    {
+        double acc[8] = {};
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+            for (int l = 0; l < 8; l++)
+                acc[l] += p[i + l];
+        double sum = ((acc[0] + acc[4]) + (acc[1] + acc[5])) + ((acc[2] + acc[6]) + (acc[3] + acc[7]));
+        for (; i < n; i++)
+            sum += p[i];
+        return sum;
+    }
+
+    ISA_AVX2 inline double sumAVX2(const double *p, size_t n)
+    {
+        __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            s0 = _mm256_add_pd(s0, _mm256_loadu_pd(p + i));
+            s1 = _mm256_add_pd(s1, _mm256_loadu_pd(p + i + 4));
+        }
+        alignas(32) double lanes[4];
+        _mm256_store_pd(lanes, _mm256_add_pd(s0, s1));
+        double sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+        for (; i < n; i++)
+            sum += p[i];
+        return sum;
+    }
+
+    // Sum of x[0..n), accumulated in double
+    inline double sumScalar(const float *x, size_t n)
+    {
+        double acc[8] = {};
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+            for (int l = 0; l < 8; l++)
+                acc[l] += x[i + l];
+        double sum = ((acc[0] + acc[4]) + (acc[1] + acc[5])) + ((acc[2] + acc[6]) + (acc[3] + acc[7]));
+        for (; i < n; i++)
+            sum += x[i];
+        return sum;
+    }
+
+    ISA_AVX2 inline double sumAVX2(const float *x, size_t n)
+    {
+        __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            acc0 = _mm256_add_pd(acc0, _mm256_cvtps_pd(_mm_loadu_ps(x + i)));
+            acc1 = _mm256_add_pd(acc1, _mm256_cvtps_pd(_mm_loadu_ps(x + i + 4)));
+        }
+        alignas(32) double lanes[4];
+        _mm256_store_pd(lanes, _mm256_add_pd(acc0, acc1));
+        double sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+        for (; i < n; i++)
+            sum += x[i];
+        return sum;
+    }
+
+    template <typename T>
+    using SumFn = double (*)(const T *, size_t);
+
+    template <typename T>
+    const isa::Variants<SumFn<T>> &sumVariants()
+    {
+        static const isa::Variants<SumFn<T>> v = {sumScalar, sumAVX2, nullptr};
+        return v;
+    }
+
+    inline double sum(const double *p, size_t n)
+    {
+        static const SumFn<double> fn = sumVariants<double>().pick();
+        return fn(p, n);
+    }
+
+    inline double sum(const float *x, size_t n)
+    {
+        static const SumFn<float> fn = sumVariants<float>().pick();
+        return fn(x, n);
+    }
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include "gemm.hpp"
+
+// Strassen-Winograd multiplication for square row-major float matrices.
+//
+// Each level splits A, B and C into quadrants and forms C from 7 half-size products instead of 8,
+// using Winograd's schedule (15 additions):
+//   S1 = A21 + A22   S2 = S1 - A11    S3 = A11 - A21   S4 = A12 - S2
+//   T1 = B12 - B11   T2 = B22 - T1    T3 = B22 - B12   T4 = T2 - B21
+//   P1 = A11 B11     P2 = A12 B21     P3 = S4 B22      P4 = A22 T4
+//   P5 = S1 T1       P6 = S2 T2       P7 = S3 T3
+//   U2 = P1 + P6     U3 = U2 + P7     U4 = U2 + P5
+//   C11 = P1 + P2    C12 = U4 + P3    C21 = U3 - P4    C22 = U3 + P5
+// Recursion stops at `crossover` (or an odd size), where the blocked gemm kernel takes over.
+// All temporaries come from one workspace allocated up front; the top `parallel_levels`
+// levels run their 7 products as OpenMP tasks, each with its own slice of the workspace.
+namespace strassen
+{
+    // Floats of workspace needed below a node of size n
+    inline size_t workspaceSize(int n, int crossover, int parallel_levels)
+    {
+        if (n <= crossover || n % 2 != 0)
+            return 0;
+        size_t h = n / 2;
+        size_t children = parallel_levels > 0 ? 7 : 1; // parallel products cannot share scratch
+        return 15 * h * h + children * workspaceSize(n / 2, crossover, parallel_levels - 1);
+    }
+
+    inline void recurse(int n, const float *A, int lda, const float *B, int ldb, float *C, int ldc,
+                        float *work, int crossover, int parallel_levels)
+    {
+        if (n <= crossover || n % 2 != 0)
+        {
+            gemm::gemm<float>(n, n, n, A, lda, B, ldb, C, ldc, 1.0f, 0.0f);
+            return;
+        }
+
+        const int h = n / 2;
+        const size_t hh = static_cast<size_t>(h) * h;
+        float *S1 = work, *S2 = S1 + hh, *S3 = S2 + hh, *S4 = S3 + hh;
+        float *T1 = S4 + hh, *T2 = T1 + hh, *T3 = T2 + hh, *T4 = T3 + hh;
+        float *P[7];
+        for (int k = 0; k < 7; k++)
+            P[k] = T4 + (k + 1) * hh;
+        float *child = work + 15 * hh;
+        const size_t child_size = workspaceSize(h, crossover, parallel_levels - 1);
+
+        const float *A11 = A, *A12 = A + h, *A21 = A + static_cast<size_t>(h) * lda, *A22 = A21 + h;
+        const float *B11 = B, *B12 = B + h, *B21 = B + static_cast<size_t>(h) * ldb, *B22 = B21 + h;
+
+        // All 8 operand sums in one pass over the quadrants
+        for (int i = 0; i < h; i++)
+        {
+            size_t a = static_cast<size_t>(i) * lda, b = static_cast<size_t>(i) * ldb, w = static_cast<size_t>(i) * h;
+            for (int j = 0; j < h; j++)
+            {
+                float s1 = A21[a + j] + A22[a + j];
+                float s2 = s1 - A11[a + j];
+                S1[w + j] = s1;
+                S2[w + j] = s2;
+                S3[w + j] = A11[a + j] - A21[a + j];
+                S4[w + j] = A12[a + j] - s2;
+                float t1 = B12[b + j] - B11[b + j];
+                float t2 = B22[b + j] - t1;
+                T1[w + j] = t1;
+                T2[w + j] = t2;
+                T3[w + j] = B22[b + j] - B12[b + j];
+                T4[w + j] = t2 - B21[b + j];
+            }
+        }
+
+        const float *lhs[7] = {A11, A12, S4, A22, S1, S2, S3};
+        const int lhs_ld[7] = {lda, lda, h, lda, h, h, h};
+        const float *rhs[7] = {B11, B21, B22, T4, T1, T2, T3};
+        const int rhs_ld[7] = {ldb, ldb, ldb, h, h, h, h};
+
+        if (parallel_levels > 0)
+        {
+            for (int k = 0; k < 7; k++)
+            {
+#pragma omp task firstprivate(k)
+                recurse(h, lhs[k], lhs_ld[k], rhs[k], rhs_ld[k], P[k], h, child + k * child_size,
+                        crossover, parallel_levels - 1);
+            }
+#pragma omp taskwait
+        }
+        else
+        {
+            for (int k = 0; k < 7; k++)
+                recurse(h, lhs[k], lhs_ld[k], rhs[k], rhs_ld[k], P[k], h, child, crossover, 0);
+        }
+
+        // All 4 output quadrants in one pass over the products
+        float *C11 = C, *C12 = C + h, *C21 = C + static_cast<size_t>(h) * ldc, *C22 = C21 + h;
+        for (int i = 0; i < h; i++)
+        {
+            size_t c = static_cast<size_t>(i) * ldc, w = static_cast<size_t>(i) * h;
+            for (int j = 0; j < h; j++)
+            {
+                float u2 = P[0][w + j] + P[5][w + j];
+                float u3 = u2 + P[6][w + j];
+                C11[c + j] = P[0][w + j] + P[1][w + j];
+                C12[c + j] = u2 + P[4][w + j] + P[2][w + j];
+                C21[c + j] = u3 - P[3][w + j];
+                C22[c + j] = u3 + P[4][w + j];
+            }
+        }
+    }
+
+    // C = A * B for n x n matrices. Levels above `crossover` use Strassen-Winograd; the top
+    // `parallel_levels` of them (7, 49, ... concurrent products) run as OpenMP tasks.
+    inline void multiply(const float *A, const float *B, float *C, int n, int crossover, int parallel_levels)
+    {
+        gemm::PackBuffer<float> work(workspaceSize(n, crossover, parallel_levels) + 1);
+#pragma omp parallel
+#pragma omp single
+        recurse(n, A, n, B, n, C, n, work.data, crossover, parallel_levels);
+    }
+}
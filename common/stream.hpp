@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <immintrin.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Chunked generate -> compute -> consume pipeline with constant memory.
+//
+// Materializing a whole stream (fill a and b, then c = a + b, then read c) costs three arrays of
+// memory and three full passes through DRAM. Here the stream is cut into chunks small enough to
+// stay in L2, and a fixed set of chunk buffers (slots) circulates between three stages, each on
+// its own thread: the generator fills a free slot, the compute stage transforms it, the consumer
+// reduces it and hands the slot back. The stages talk through bounded single-producer,
+// single-consumer rings of slot indices, so a fast stage blocks once all slots are ahead of it and
+// peak memory is slots x chunk bytes however long the stream is.
+namespace stream
+{
+    // Spin briefly, then yield (a stage may share its core with the one it waits for)
+    template <typename Pred>
+    void waitUntil(Pred ready)
+    {
+        for (int spins = 0; !ready();)
+        {
+            if (++spins < 1024)
+                _mm_pause();
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    // Bounded SPSC queue of slot indices; push blocks while full, pop while empty
+    class Ring
+    {
+    public:
+        explicit Ring(size_t capacity)
+        {
+            size_t cap = 1;
+            while (cap < capacity)
+                cap <<= 1;
+            buffer_.resize(cap);
+            mask_ = cap - 1;
+        }
+
+        void push(size_t slot)
+        {
+            size_t t = tail_.load(std::memory_order_relaxed);
+            waitUntil([&] { return t - head_.load(std::memory_order_acquire) <= mask_; });
+            buffer_[t & mask_] = slot;
+            tail_.store(t + 1, std::memory_order_release);
+        }
+
+        size_t pop()
+        {
+            size_t h = head_.load(std::memory_order_relaxed);
+            waitUntil([&] { return tail_.load(std::memory_order_acquire) != h; });
+            size_t slot = buffer_[h & mask_];
+            head_.store(h + 1, std::memory_order_release);
+            return slot;
+        }
+
+    private:
+        std::vector<size_t> buffer_;
+        size_t mask_;
+        alignas(64) std::atomic<size_t> head_{0};
+        alignas(64) std::atomic<size_t> tail_{0};
+    };
+
+    inline size_t l2Bytes()
+    {
+        long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+        return l2 > 0 ? static_cast<size_t>(l2) : size_t(1) << 20;
+    }
+
+    // Elements per chunk so that one chunk (bytes_per_element over all its buffers) takes half of
+    // L2, rounded down to a multiple of 64 elements
+    inline size_t chunkFor(size_t bytes_per_element)
+    {
+        size_t n = l2Bytes() / 2 / bytes_per_element;
+        return std::max<size_t>(64, n / 64 * 64);
+    }
+
+    struct Stats
+    {
+        double wall = 0;     // seconds, first generate to last consume
+        double generate = 0; // busy seconds per stage
+        double compute = 0;
+        double consume = 0;
+    };
+
+    // Run `chunks` chunks through the slots: generate(k, slot), compute(k, slot), consume(k, slot)
+    // for k = 0 .. chunks - 1, each stage in chunk order on its own thread (consume on the caller).
+    template <typename Slot, typename Generate, typename Compute, typename Consume>
+    Stats run(std::vector<Slot> &slots, size_t chunks, Generate generate, Compute compute, Consume consume)
+    {
+        using clock = std::chrono::steady_clock;
+        auto seconds = [](clock::time_point a, clock::time_point b)
+        { return std::chrono::duration<double>(b - a).count(); };
+
+        const size_t n = slots.size();
+        Ring free(n), full(n), done(n);
+        for (size_t s = 0; s < n; s++)
+            free.push(s);
+
+        Stats st;
+        auto start = clock::now();
+        std::thread producer([&]
+                             {
+                                 for (size_t k = 0; k < chunks; k++)
+                                 {
+                                     size_t s = free.pop();
+                                     auto t0 = clock::now();
+                                     generate(k, slots[s]);
+                                     st.generate += seconds(t0, clock::now());
+                                     full.push(s);
+                                 }
+                             });
+        std::thread worker([&]
+                           {
+                               for (size_t k = 0; k < chunks; k++)
+                               {
+                                   size_t s = full.pop();
+                                   auto t0 = clock::now();
+                                   compute(k, slots[s]);
+                                   st.compute += seconds(t0, clock::now());
+                                   done.push(s);
+                               }
+                           });
+        for (size_t k = 0; k < chunks; k++)
+        {
+            size_t s = done.pop();
+            auto t0 = clock::now();
+            consume(k, slots[s]);
+            st.consume += seconds(t0, clock::now());
+            free.push(s);
+        }
+        producer.join();
+        worker.join();
+        st.wall = seconds(start, clock::now());
+        return st;
+    }
+}
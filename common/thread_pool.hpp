@@ -0,0 +1,212 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <immintrin.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <type_traits>
+#include <unistd.h>
+#include <vector>
+
+// Persistent worker pool with block / cyclic / block-cyclic parallel_for.
+//
+// Creating and joining threads for every parallel region costs tens of microseconds per thread,
+// which is a visible share of a few-millisecond kernel. Here workers are created once, optionally
+// pinned to one CPU each, and park on a futex between jobs. A dispatch bumps a generation counter
+// and wakes them; completion is a shared countdown that the caller spins on briefly. Workers also
+// spin for a short while before parking, so back-to-back dispatches never reach the kernel.
+namespace pool
+{
+    enum class Distribution
+    {
+        Block,      // worker t gets one contiguous range of ~n/T indices
+        Cyclic,     // worker t gets t, t + T, t + 2T, ...
+        BlockCyclic // blocks of `block` indices dealt round-robin
+    };
+
+    struct Policy
+    {
+        Distribution kind;
+        size_t block;
+    };
+
+    inline Policy block() { return {Distribution::Block, 0}; }
+    inline Policy cyclic() { return {Distribution::Cyclic, 1}; }
+    inline Policy blockCyclic(size_t block) { return {Distribution::BlockCyclic, std::max<size_t>(block, 1)}; }
+
+    struct Range
+    {
+        size_t begin, end;
+    };
+
+    // Call fn(begin, end) for each contiguous chunk that worker `id` of `workers` owns under `policy`
+    template <typename F>
+    void forEachChunk(Range range, Policy policy, int id, int workers, F &&fn)
+    {
+        size_t n = range.end - range.begin;
+        if (policy.kind == Distribution::Block)
+        {
+            size_t per = n / workers, extra = n % workers;
+            size_t b = id * per + std::min<size_t>(id, extra);
+            size_t e = b + per + (static_cast<size_t>(id) < extra ? 1 : 0);
+            if (b < e)
+                fn(range.begin + b, range.begin + e);
+            return;
+        }
+        size_t bs = policy.kind == Distribution::Cyclic ? 1 : policy.block;
+        for (size_t b = id * bs; b < n; b += bs * workers)
+            fn(range.begin + b, range.begin + std::min(b + bs, n));
+    }
+
+    inline long futexWait(std::atomic<uint32_t> *addr, uint32_t expected)
+    {
+        return syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+    }
+
+    inline long futexWake(std::atomic<uint32_t> *addr)
+    {
+        return syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+    }
+
+    // CPUs this process may run on (its affinity mask, as set by taskset or a cpuset), in
+    // increasing order; every CPU up to hardware_concurrency if the mask cannot be read
+    inline std::vector<int> allowedCpus()
+    {
+        std::vector<int> cpus;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0)
+            for (int c = 0; c < CPU_SETSIZE; c++)
+                if (CPU_ISSET(c, &set))
+                    cpus.push_back(c);
+        if (cpus.empty())
+            for (int c = 0; c < static_cast<int>(std::max(1u, std::thread::hardware_concurrency())); c++)
+                cpus.push_back(c);
+        return cpus;
+    }
+
+    // Pin the calling thread (or `thread`) to a single CPU
+    inline bool pinToCpu(pthread_t thread, int cpu)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+    }
+
+    class ThreadPool
+    {
+    public:
+        // num_threads counts the caller, which runs worker 0 of every job
+        explicit ThreadPool(int num_threads, bool pin = true)
+            : num_threads_(std::max(num_threads, 1))
+        {
+            // Worker id goes to the id-th CPU of the affinity mask, which need not be 0..n-1
+            const std::vector<int> cpus = allowedCpus();
+            const int count = static_cast<int>(cpus.size());
+            // Spinning only pays off when every worker has a core of its own
+            spin_limit_ = num_threads_ <= count ? 1 << 14 : 0;
+            for (int id = 1; id < num_threads_; id++)
+            {
+                workers_.emplace_back([this, id] { workerLoop(id); });
+                if (pin)
+                    pinToCpu(workers_.back().native_handle(), cpus[id % count]);
+            }
+        }
+
+        ~ThreadPool()
+        {
+            stop_.store(true, std::memory_order_relaxed);
+            generation_.fetch_add(1);
+            futexWake(&generation_);
+            for (auto &t : workers_)
+                t.join();
+        }
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        int size() const { return num_threads_; }
+
+        // Run fn(worker_id) on every worker (the caller is worker 0) and wait for all of them
+        template <typename F>
+        void run(F &&fn)
+        {
+            using Fn = std::remove_reference_t<F>;
+            job_ = [](void *ctx, int id) { (*static_cast<Fn *>(ctx))(id); };
+            ctx_ = const_cast<void *>(static_cast<const void *>(&fn));
+            pending_.store(num_threads_ - 1, std::memory_order_relaxed);
+            // seq_cst pairs with the worker's sleeping_ increment: either it sees the new
+            // generation before parking, or we see it asleep and wake it
+            generation_.fetch_add(1);
+            if (sleeping_.load() > 0)
+                futexWake(&generation_);
+
+            fn(0);
+
+            int spins = 0;
+            while (pending_.load(std::memory_order_acquire) != 0)
+            {
+                if (++spins < spin_limit_)
+                    _mm_pause();
+                else
+                    std::this_thread::yield();
+            }
+        }
+
+        // fn(begin, end) over the chunks of `range` each worker owns under `policy`
+        template <typename F>
+        void parallel_for(Range range, Policy policy, F &&fn)
+        {
+            int workers = num_threads_;
+            run([&](int id) { forEachChunk(range, policy, id, workers, fn); });
+        }
+
+    private:
+        void workerLoop(int id)
+        {
+            uint32_t seen = 0; // generation at construction, even if a job was posted before we started
+            for (;;)
+            {
+                // Spin briefly, then park until the generation changes
+                uint32_t gen;
+                int spins = 0;
+                while ((gen = generation_.load(std::memory_order_acquire)) == seen)
+                {
+                    if (++spins < spin_limit_)
+                    {
+                        _mm_pause();
+                        continue;
+                    }
+                    sleeping_.fetch_add(1);
+                    if (generation_.load() == seen)
+                        futexWait(&generation_, seen);
+                    sleeping_.fetch_sub(1);
+                    spins = 0;
+                }
+                seen = gen;
+                if (stop_.load(std::memory_order_relaxed))
+                    return;
+                job_(ctx_, id);
+                pending_.fetch_sub(1, std::memory_order_release);
+            }
+        }
+
+        int num_threads_;
+        int spin_limit_;
+        std::vector<std::thread> workers_;
+        void (*job_)(void *, int) = nullptr;
+        void *ctx_ = nullptr;
+        alignas(64) std::atomic<uint32_t> generation_{0};
+        alignas(64) std::atomic<int> pending_{0};
+        alignas(64) std::atomic<int> sleeping_{0};
+        std::atomic<bool> stop_{false};
+    };
+}
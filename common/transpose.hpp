@@ -0,0 +1,228 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <immintrin.h>
+#include <utility>
+#include <vector>
+#include "isa.hpp"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Matrix transpose for row-major float matrices.
+//
+// The scalar loop (B_T[j * n + i] = B[i * n + j]) does a strided store per element, touching a
+// new cache line and often a new page on every write. Here the matrix is walked in TILE x TILE
+// tiles that fit in L1/L2, and each tile is transposed as 8x8 blocks held in ymm registers, so
+// every load and store moves a full row of 8 floats. The register transposes are AVX2
+// (common/isa.hpp); tile and the in-place stripes dispatch to them or to scalar copies of the
+// same loops.
+namespace transpose
+{
+    constexpr int TILE = 64; // 64 x 64 floats = 16 KB read + 16 KB written per tile
+
+    // Transpose 8 rows of 8 floats in registers (unpack -> shuffle -> 128-bit lane permute)
+    ISA_AVX2 inline void transpose8x8(__m256 &r0, __m256 &r1, __m256 &r2, __m256 &r3,
+                                      __m256 &r4, __m256 &r5, __m256 &r6, __m256 &r7)
+    {
+        __m256 t0 = _mm256_unpacklo_ps(r0, r1), t1 = _mm256_unpackhi_ps(r0, r1);
+        __m256 t2 = _mm256_unpacklo_ps(r2, r3), t3 = _mm256_unpackhi_ps(r2, r3);
+        __m256 t4 = _mm256_unpacklo_ps(r4, r5), t5 = _mm256_unpackhi_ps(r4, r5);
+        __m256 t6 = _mm256_unpacklo_ps(r6, r7), t7 = _mm256_unpackhi_ps(r6, r7);
+
+        __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+        r0 = _mm256_permute2f128_ps(s0, s4, 0x20);
+        r1 = _mm256_permute2f128_ps(s1, s5, 0x20);
+        r2 = _mm256_permute2f128_ps(s2, s6, 0x20);
+        r3 = _mm256_permute2f128_ps(s3, s7, 0x20);
+        r4 = _mm256_permute2f128_ps(s0, s4, 0x31);
+        r5 = _mm256_permute2f128_ps(s1, s5, 0x31);
+        r6 = _mm256_permute2f128_ps(s2, s6, 0x31);
+        r7 = _mm256_permute2f128_ps(s3, s7, 0x31);
+    }
+
+    // dst (8 x 8, stride ldd) = transpose of src (8 x 8, stride lds)
+    ISA_AVX2 inline void block8x8(const float *src, size_t lds, float *dst, size_t ldd)
+    {
+        __m256 r0 = _mm256_loadu_ps(src + 0 * lds), r1 = _mm256_loadu_ps(src + 1 * lds);
+        __m256 r2 = _mm256_loadu_ps(src + 2 * lds), r3 = _mm256_loadu_ps(src + 3 * lds);
+        __m256 r4 = _mm256_loadu_ps(src + 4 * lds), r5 = _mm256_loadu_ps(src + 5 * lds);
+        __m256 r6 = _mm256_loadu_ps(src + 6 * lds), r7 = _mm256_loadu_ps(src + 7 * lds);
+        transpose8x8(r0, r1, r2, r3, r4, r5, r6, r7);
+        _mm256_storeu_ps(dst + 0 * ldd, r0);
+        _mm256_storeu_ps(dst + 1 * ldd, r1);
+        _mm256_storeu_ps(dst + 2 * ldd, r2);
+        _mm256_storeu_ps(dst + 3 * ldd, r3);
+        _mm256_storeu_ps(dst + 4 * ldd, r4);
+        _mm256_storeu_ps(dst + 5 * ldd, r5);
+        _mm256_storeu_ps(dst + 6 * ldd, r6);
+        _mm256_storeu_ps(dst + 7 * ldd, r7);
+    }
+
+    // Transpose one tile [i0, i1) x [j0, j1) of src into dst, element by element
+    inline void tileScalar(const float *src, size_t lds, float *dst, size_t ldd, int i0, int i1, int j0, int j1)
+    {
+        for (int i = i0; i < i1; i++)
+            for (int j = j0; j < j1; j++)
+                dst[j * ldd + i] = src[i * lds + j];
+    }
+
+    // The same tile as 8x8 register blocks; partial blocks fall back to scalar
+    ISA_AVX2 inline void tileAVX2(const float *src, size_t lds, float *dst, size_t ldd, int i0, int i1, int j0, int j1)
+    {
+        int i = i0;
+        for (; i + 8 <= i1; i += 8)
+        {
+            int j = j0;
+            for (; j + 8 <= j1; j += 8)
+                block8x8(&src[i * lds + j], lds, &dst[j * ldd + i], ldd);
+            for (; j < j1; j++)
+                for (int r = i; r < i + 8; r++)
+                    dst[j * ldd + r] = src[r * lds + j];
+        }
+        for (; i < i1; i++)
+            for (int j = j0; j < j1; j++)
+                dst[j * ldd + i] = src[i * lds + j];
+    }
+
+    using TileFn = void (*)(const float *, size_t, float *, size_t, int, int, int, int);
+
+    inline const isa::Variants<TileFn> &tileVariants()
+    {
+        static const isa::Variants<TileFn> v = {tileScalar, tileAVX2, nullptr};
+        return v;
+    }
+
+    inline void tile(const float *src, size_t lds, float *dst, size_t ldd, int i0, int i1, int j0, int j1)
+    {
+        static const TileFn fn = tileVariants().pick();
+        fn(src, lds, dst, ldd, i0, i1, j0, j1);
+    }
+
+    // Out-of-place: dst (cols x rows, stride ldd) = transpose of src (rows x cols, stride lds)
+    inline void transposeBlocked(const float *src, size_t lds, float *dst, size_t ldd, int rows, int cols)
+    {
+        for (int i = 0; i < rows; i += TILE)
+            for (int j = 0; j < cols; j += TILE)
+                tile(src, lds, dst, ldd, i, std::min(i + TILE, rows), j, std::min(j + TILE, cols));
+    }
+
+    // Out-of-place, tiles distributed over an OpenMP team
+    inline void transposeParallel(const float *src, size_t lds, float *dst, size_t ldd, int rows, int cols,
+                                  int num_threads)
+    {
+        int tiles_i = (rows + TILE - 1) / TILE, tiles_j = (cols + TILE - 1) / TILE;
+#pragma omp parallel for schedule(static) num_threads(num_threads)
+        for (int t = 0; t < tiles_i * tiles_j; t++)
+        {
+            int i = (t / tiles_j) * TILE, j = (t % tiles_j) * TILE;
+            tile(src, lds, dst, ldd, i, std::min(i + TILE, rows), j, std::min(j + TILE, cols));
+        }
+    }
+
+    // Stripe bi of an in-place n x n transpose (stride lda): swap every (i, j) with (j, i) for
+    // the 8 rows i in [bi, bi + 8) and j > i
+    inline void squareStripeScalar(float *A, size_t lda, int n, int bi)
+    {
+        for (int i = bi; i < bi + 8; i++)
+            for (int j = i + 1; j < n; j++)
+                std::swap(A[i * lda + j], A[j * lda + i]);
+    }
+
+    // The same stripe in registers: each 8x8 block right of the diagonal is swapped with its
+    // mirror below it, both transposed on the way, and the diagonal block is transposed onto
+    // itself. No scratch memory beyond 16 registers.
+    ISA_AVX2 inline void squareStripeAVX2(float *A, size_t lda, int n, int bi)
+    {
+        int n8 = n / 8 * 8;
+        for (int bj = bi; bj < n8; bj += 8)
+        {
+            float *p = &A[bi * lda + bj], *q = &A[bj * lda + bi];
+            __m256 a0 = _mm256_loadu_ps(p + 0 * lda), a1 = _mm256_loadu_ps(p + 1 * lda);
+            __m256 a2 = _mm256_loadu_ps(p + 2 * lda), a3 = _mm256_loadu_ps(p + 3 * lda);
+            __m256 a4 = _mm256_loadu_ps(p + 4 * lda), a5 = _mm256_loadu_ps(p + 5 * lda);
+            __m256 a6 = _mm256_loadu_ps(p + 6 * lda), a7 = _mm256_loadu_ps(p + 7 * lda);
+            transpose8x8(a0, a1, a2, a3, a4, a5, a6, a7);
+            if (bi != bj)
+                block8x8(q, lda, p, lda);
+            _mm256_storeu_ps(q + 0 * lda, a0);
+            _mm256_storeu_ps(q + 1 * lda, a1);
+            _mm256_storeu_ps(q + 2 * lda, a2);
+            _mm256_storeu_ps(q + 3 * lda, a3);
+            _mm256_storeu_ps(q + 4 * lda, a4);
+            _mm256_storeu_ps(q + 5 * lda, a5);
+            _mm256_storeu_ps(q + 6 * lda, a6);
+            _mm256_storeu_ps(q + 7 * lda, a7);
+        }
+        // columns past the last full block
+        for (int i = bi; i < bi + 8; i++)
+            for (int j = n8; j < n; j++)
+                std::swap(A[i * lda + j], A[j * lda + i]);
+    }
+
+    using StripeFn = void (*)(float *, size_t, int, int);
+
+    inline const isa::Variants<StripeFn> &squareStripeVariants()
+    {
+        static const isa::Variants<StripeFn> v = {squareStripeScalar, squareStripeAVX2, nullptr};
+        return v;
+    }
+
+    // In-place transpose of an n x n matrix (stride lda), one stripe of 8 rows per iteration; the
+    // bottom-right corner past the last full stripe is swapped at the end
+    inline void transposeInPlaceSquare(float *A, size_t lda, int n, int num_threads)
+    {
+        static const StripeFn stripe = squareStripeVariants().pick();
+        int n8 = n / 8 * 8;
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+        for (int bi = 0; bi < n8; bi += 8)
+            stripe(A, lda, n, bi);
+        for (int i = n8; i < n; i++)
+            for (int j = i + 1; j < n; j++)
+                std::swap(A[i * lda + j], A[j * lda + i]);
+    }
+
+    // In-place transpose of a dense rows x cols matrix into cols x rows by cycle-following.
+    // Element at linear position p moves to p * rows mod (rows * cols - 1). A bitmap of visited
+    // positions costs 1 bit per element (1/32 of the matrix) instead of a second copy.
+    inline void transposeInPlace(float *A, int rows, int cols)
+    {
+        if (rows == cols)
+        {
+            transposeInPlaceSquare(A, cols, rows, 1);
+            return;
+        }
+        const uint64_t total = static_cast<uint64_t>(rows) * cols;
+        if (total < 3)
+            return;
+        const uint64_t last = total - 1;
+        std::vector<uint64_t> visited((total + 63) / 64, 0);
+        auto seen = [&](uint64_t p) { return (visited[p >> 6] >> (p & 63)) & 1; };
+        auto mark = [&](uint64_t p) { visited[p >> 6] |= uint64_t(1) << (p & 63); };
+
+        for (uint64_t start = 1; start < last; start++)
+        {
+            if (seen(start))
+                continue;
+            float carry = A[start];
+            uint64_t p = start;
+            do
+            {
+                uint64_t next = p * rows % last;
+                std::swap(carry, A[next]);
+                mark(p);
+                p = next;
+            } while (p != start);
+        }
+    }
+}
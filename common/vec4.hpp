@@ -0,0 +1,274 @@
+#pragma once
+
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <immintrin.h>
+#include <vector>
+#include "isa.hpp"
+#include "memory.hpp"
+#include "thread_pool.hpp"
+
+// 4D vectors stored as arrays of structures of arrays (AoSoA).
+//
+// An array of struct {x, y, z, w} puts one vector in each 16-byte slot, so a SIMD register holds
+// two whole vectors and the norm needs horizontal adds across lanes. Vec4Array instead groups the
+// vectors in blocks of 8 and stores each component of a block contiguously (x[8], y[8], z[8], w[8]),
+// so one __m256 load is one component of 8 vectors and the norm is three FMAs, vertically. A block is
+// 128 bytes, two cache lines, and keeps the 4 components of a vector in the same block, so converting
+// to and from the AoS layout is an in-register 4x8 transpose per block. The last block is padded with
+// zero vectors, which the zero-norm mask leaves unchanged. The conversions and the normalization
+// run a range of blocks through an AVX2 or a scalar variant (common/isa.hpp).
+namespace vec4
+{
+    struct Vec4
+    {
+        float x, y, z, w;
+    };
+
+    struct alignas(32) Block
+    {
+        float x[8], y[8], z[8], w[8];
+    };
+
+    class Vec4Array
+    {
+    public:
+        explicit Vec4Array(size_t n = 0) : n_(n), blocks_((n + 7) / 8, Block{}) {}
+
+        size_t size() const { return n_; }
+        size_t blocks() const { return blocks_.size(); }
+        Block *data() { return blocks_.data(); }
+        const Block *data() const { return blocks_.data(); }
+
+        Vec4 get(size_t i) const
+        {
+            const Block &b = blocks_[i / 8];
+            size_t l = i % 8;
+            return {b.x[l], b.y[l], b.z[l], b.w[l]};
+        }
+
+        void set(size_t i, Vec4 v)
+        {
+            Block &b = blocks_[i / 8];
+            size_t l = i % 8;
+            b.x[l] = v.x;
+            b.y[l] = v.y;
+            b.z[l] = v.z;
+            b.w[l] = v.w;
+        }
+
+    private:
+        size_t n_;
+        mem::vector<Block> blocks_; // huge-page backed when large (common/memory.hpp)
+    };
+
+    // Layout conversion -------------------------------------------------------------------------
+
+    // 8 consecutive Vec4 -> one block: transpose 4 registers of 2 vectors each into x, y, z, w
+    ISA_AVX2 inline void gather(const Vec4 *in, Block &out)
+    {
+        const float *p = &in[0].x;
+        __m256 r0 = _mm256_loadu_ps(p), r1 = _mm256_loadu_ps(p + 8);       // v0 v1 | v2 v3
+        __m256 r2 = _mm256_loadu_ps(p + 16), r3 = _mm256_loadu_ps(p + 24); // v4 v5 | v6 v7
+        __m256 t0 = _mm256_permute2f128_ps(r0, r2, 0x20); // v0 | v4
+        __m256 t1 = _mm256_permute2f128_ps(r1, r3, 0x20); // v2 | v6
+        __m256 t2 = _mm256_permute2f128_ps(r0, r2, 0x31); // v1 | v5
+        __m256 t3 = _mm256_permute2f128_ps(r1, r3, 0x31); // v3 | v7
+        __m256 a = _mm256_unpacklo_ps(t0, t2);            // x0 x1 y0 y1 | x4 x5 y4 y5
+        __m256 b = _mm256_unpackhi_ps(t0, t2);            // z0 z1 w0 w1 | z4 z5 w4 w5
+        __m256 c = _mm256_unpacklo_ps(t1, t3);            // x2 x3 y2 y3 | x6 x7 y6 y7
+        __m256 d = _mm256_unpackhi_ps(t1, t3);            // z2 z3 w2 w3 | z6 z7 w6 w7
+        _mm256_store_ps(out.x, _mm256_shuffle_ps(a, c, _MM_SHUFFLE(1, 0, 1, 0)));
+        _mm256_store_ps(out.y, _mm256_shuffle_ps(a, c, _MM_SHUFFLE(3, 2, 3, 2)));
+        _mm256_store_ps(out.z, _mm256_shuffle_ps(b, d, _MM_SHUFFLE(1, 0, 1, 0)));
+        _mm256_store_ps(out.w, _mm256_shuffle_ps(b, d, _MM_SHUFFLE(3, 2, 3, 2)));
+    }
+
+    // One block -> 8 consecutive Vec4 (the inverse transpose)
+    ISA_AVX2 inline void scatter(const Block &in, Vec4 *out)
+    {
+        __m256 x = _mm256_load_ps(in.x), y = _mm256_load_ps(in.y);
+        __m256 z = _mm256_load_ps(in.z), w = _mm256_load_ps(in.w);
+        __m256 a = _mm256_unpacklo_ps(x, y); // x0 y0 x1 y1 | x4 y4 x5 y5
+        __m256 b = _mm256_unpackhi_ps(x, y); // x2 y2 x3 y3 | x6 y6 x7 y7
+        __m256 c = _mm256_unpacklo_ps(z, w); // z0 w0 z1 w1 | z4 w4 z5 w5
+        __m256 d = _mm256_unpackhi_ps(z, w); // z2 w2 z3 w3 | z6 w6 z7 w7
+        __m256 s0 = _mm256_shuffle_ps(a, c, _MM_SHUFFLE(1, 0, 1, 0)); // v0 | v4
+        __m256 s1 = _mm256_shuffle_ps(a, c, _MM_SHUFFLE(3, 2, 3, 2)); // v1 | v5
+        __m256 s2 = _mm256_shuffle_ps(b, d, _MM_SHUFFLE(1, 0, 1, 0)); // v2 | v6
+        __m256 s3 = _mm256_shuffle_ps(b, d, _MM_SHUFFLE(3, 2, 3, 2)); // v3 | v7
+        float *p = &out[0].x;
+        _mm256_storeu_ps(p, _mm256_permute2f128_ps(s0, s1, 0x20));
+        _mm256_storeu_ps(p + 8, _mm256_permute2f128_ps(s2, s3, 0x20));
+        _mm256_storeu_ps(p + 16, _mm256_permute2f128_ps(s0, s1, 0x31));
+        _mm256_storeu_ps(p + 24, _mm256_permute2f128_ps(s2, s3, 0x31));
+    }
+
+    // Blocks [b, e) of out from the vectors in[8 b .. 8 e)
+    inline void gatherBlocksScalar(const Vec4 *in, Block *out, size_t b, size_t e)
+    {
+        for (size_t k = b; k < e; k++)
+            for (int l = 0; l < 8; l++)
+            {
+                const Vec4 &v = in[8 * k + l];
+                out[k].x[l] = v.x;
+                out[k].y[l] = v.y;
+                out[k].z[l] = v.z;
+                out[k].w[l] = v.w;
+            }
+    }
+
+    ISA_AVX2 inline void gatherBlocksAVX2(const Vec4 *in, Block *out, size_t b, size_t e)
+    {
+        for (size_t k = b; k < e; k++)
+            gather(in + 8 * k, out[k]);
+    }
+
+    // Vectors out[8 b .. 8 e) from blocks [b, e) of in
+    inline void scatterBlocksScalar(const Block *in, Vec4 *out, size_t b, size_t e)
+    {
+        for (size_t k = b; k < e; k++)
+            for (int l = 0; l < 8; l++)
+                out[8 * k + l] = {in[k].x[l], in[k].y[l], in[k].z[l], in[k].w[l]};
+    }
+
+    ISA_AVX2 inline void scatterBlocksAVX2(const Block *in, Vec4 *out, size_t b, size_t e)
+    {
+        for (size_t k = b; k < e; k++)
+            scatter(in[k], out + 8 * k);
+    }
+
+    using GatherFn = void (*)(const Vec4 *, Block *, size_t, size_t);
+    using ScatterFn = void (*)(const Block *, Vec4 *, size_t, size_t);
+
+    inline const isa::Variants<GatherFn> &gatherVariants()
+    {
+        static const isa::Variants<GatherFn> v = {gatherBlocksScalar, gatherBlocksAVX2, nullptr};
+        return v;
+    }
+
+    inline const isa::Variants<ScatterFn> &scatterVariants()
+    {
+        static const isa::Variants<ScatterFn> v = {scatterBlocksScalar, scatterBlocksAVX2, nullptr};
+        return v;
+    }
+
+    // AoS -> AoSoA, blocks split over the pool
+    inline void fromAoS(pool::ThreadPool &tp, const Vec4 *in, Vec4Array &out)
+    {
+        static const GatherFn fn = gatherVariants().pick();
+        const size_t n = out.size(), full = n / 8;
+        tp.parallel_for({0, full}, pool::block(), [&](size_t b, size_t e)
+                        { fn(in, out.data(), b, e); });
+        for (size_t i = full * 8; i < n; i++)
+            out.set(i, in[i]);
+    }
+
+    // AoSoA -> AoS (out holds size() vectors)
+    inline void toAoS(pool::ThreadPool &tp, const Vec4Array &in, Vec4 *out)
+    {
+        static const ScatterFn fn = scatterVariants().pick();
+        const size_t n = in.size(), full = n / 8;
+        tp.parallel_for({0, full}, pool::block(), [&](size_t b, size_t e)
+                        { fn(in.data(), out, b, e); });
+        for (size_t i = full * 8; i < n; i++)
+            out[i] = in.get(i);
+    }
+
+    // Normalization -----------------------------------------------------------------------------
+
+    // Reference: v / sqrt(|v|^2) with a sqrt and four divides, zero vectors unchanged. |v|^2 is
+    // accumulated with fmas in the order of the vector kernels, so inlined into an FMA-enabled
+    // variant (common/isa.hpp) it still rounds the same way.
+    inline void normalizeScalar(Vec4 &v)
+    {
+        float norm = std::sqrt(std::fma(v.w, v.w, std::fma(v.z, v.z, std::fma(v.y, v.y, v.x * v.x))));
+        if (norm > 0.0f)
+        {
+            v.x /= norm;
+            v.y /= norm;
+            v.z /= norm;
+            v.w /= norm;
+        }
+    }
+
+    // Bound on the relative error of normalizeBlockAVX2 against normalizeScalar, per component.
+    // _mm256_rsqrt_ps is good to 1.5 * 2^-12; one Newton-Raphson step squares that to ~2^-23, and
+    // the remaining terms are float roundings of the step and the final multiply.
+    constexpr float NORMALIZE_TOLERANCE = 4.0f * FLT_EPSILON;
+
+    // The 8 vectors of a block through normalizeScalar
+    inline void normalizeBlockScalar(Block &b)
+    {
+        for (int l = 0; l < 8; l++)
+        {
+            Vec4 v = {b.x[l], b.y[l], b.z[l], b.w[l]};
+            normalizeScalar(v);
+            b.x[l] = v.x;
+            b.y[l] = v.y;
+            b.z[l] = v.z;
+            b.w[l] = v.w;
+        }
+    }
+
+    // Normalize the 8 vectors of a block: r = rsqrt(n2), refined once as r (1.5 - 0.5 n2 r^2)
+    ISA_AVX2 inline void normalizeBlockAVX2(Block &b)
+    {
+        __m256 x = _mm256_load_ps(b.x), y = _mm256_load_ps(b.y);
+        __m256 z = _mm256_load_ps(b.z), w = _mm256_load_ps(b.w);
+        __m256 n2 = _mm256_mul_ps(x, x);
+        n2 = _mm256_fmadd_ps(y, y, n2);
+        n2 = _mm256_fmadd_ps(z, z, n2);
+        n2 = _mm256_fmadd_ps(w, w, n2);
+
+        // rsqrt is only meaningful for normal, finite n2; zero lanes are masked to stay unchanged
+        __m256 normal = _mm256_and_ps(_mm256_cmp_ps(n2, _mm256_set1_ps(FLT_MIN), _CMP_GE_OQ),
+                                      _mm256_cmp_ps(n2, _mm256_set1_ps(FLT_MAX), _CMP_LE_OQ));
+        __m256 zero = _mm256_cmp_ps(n2, _mm256_setzero_ps(), _CMP_EQ_OQ);
+        if (_mm256_movemask_ps(_mm256_or_ps(normal, zero)) != 0xFF)
+        {
+            // Some lane underflows or overflows |v|^2 (rare): the scalar path handles the block
+            normalizeBlockScalar(b);
+            return;
+        }
+
+        __m256 r = _mm256_rsqrt_ps(n2);
+        __m256 hn2r = _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), n2), r);
+        r = _mm256_mul_ps(r, _mm256_fnmadd_ps(hn2r, r, _mm256_set1_ps(1.5f)));
+        r = _mm256_blendv_ps(r, _mm256_set1_ps(1.0f), zero);
+        _mm256_store_ps(b.x, _mm256_mul_ps(x, r));
+        _mm256_store_ps(b.y, _mm256_mul_ps(y, r));
+        _mm256_store_ps(b.z, _mm256_mul_ps(z, r));
+        _mm256_store_ps(b.w, _mm256_mul_ps(w, r));
+    }
+
+    // Normalize blocks [b, e)
+    inline void normalizeBlocksScalar(Block *blocks, size_t b, size_t e)
+    {
+        for (size_t k = b; k < e; k++)
+            normalizeBlockScalar(blocks[k]);
+    }
+
+    ISA_AVX2 inline void normalizeBlocksAVX2(Block *blocks, size_t b, size_t e)
+    {
+        for (size_t k = b; k < e; k++)
+            normalizeBlockAVX2(blocks[k]);
+    }
+
+    using NormalizeFn = void (*)(Block *, size_t, size_t);
+
+    inline const isa::Variants<NormalizeFn> &normalizeVariants()
+    {
+        static const isa::Variants<NormalizeFn> v = {normalizeBlocksScalar, normalizeBlocksAVX2, nullptr};
+        return v;
+    }
+
+    // Normalize every vector of a, blocks split over the pool
+    inline void normalize(pool::ThreadPool &tp, Vec4Array &a)
+    {
+        static const NormalizeFn fn = normalizeVariants().pick();
+        tp.parallel_for({0, a.blocks()}, pool::block(), [&](size_t b, size_t e)
+                        { fn(a.data(), b, e); });
+    }
+}
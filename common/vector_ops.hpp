@@ -0,0 +1,246 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <immintrin.h>
+#include "isa.hpp"
+#include "random.hpp"
+#include "thread_pool.hpp"
+#include "vec4.hpp"
+
+// Backend-agnostic vector kernels with CUDA launch semantics.
+//
+// A kernel is launched over a grid of `blocks` x `threads` ids, id = block * threads + thread, and
+// guards `id < size` itself, exactly as addVectors / scaleKernel / normalizeVectors do in
+// vector_ops_cuda.cu: a grid smaller than the data leaves the tail untouched, a larger one is
+// clipped. Callers only see the entry points (vops::addVectors(backend, grid, ...)), so a CUDA
+// backend would provide the same launch() over device pointers. CpuBackend runs a launch on a
+// pool::ThreadPool: each worker takes a contiguous run of grid blocks and executes the ids of the
+// run as one SIMD loop (common/isa.hpp picks the variant), which is what the CUDA threads of those
+// blocks would do one id each.
+namespace vops
+{
+    struct Grid
+    {
+        size_t blocks, threads;
+    };
+
+    // The usual (size + threadsPerBlock - 1) / threadsPerBlock grid
+    inline Grid gridFor(size_t size, size_t threads_per_block = 256)
+    {
+        return {(size + threads_per_block - 1) / threads_per_block, threads_per_block};
+    }
+
+    class CpuBackend
+    {
+    public:
+        explicit CpuBackend(int num_threads) : tp_(num_threads) {}
+
+        int threads() const { return tp_.size(); }
+
+        // kernel(begin, end) for the ids [begin, end) of each worker's run of grid blocks
+        template <typename Kernel>
+        void launch(Grid grid, const Kernel &kernel)
+        {
+            tp_.parallel_for({0, grid.blocks}, pool::block(), [&](size_t b, size_t e)
+                             { kernel(b * grid.threads, e * grid.threads); });
+        }
+
+        // Launches complete before returning; kept so callers read like the CUDA host code
+        void synchronize() {}
+
+        // curandGenerateUniform: uniform floats in [0, 1)
+        void generateUniform(float *data, size_t size, uint64_t seed)
+        {
+            tp_.parallel_for({0, (size + rng::CHUNK - 1) / rng::CHUNK}, pool::block(), [&](size_t b, size_t e)
+                             { rng::fillRange(data + b * rng::CHUNK, b * rng::CHUNK, std::min(size, e * rng::CHUNK), 0.0f, 1.0f, seed); });
+        }
+
+    private:
+        pool::ThreadPool tp_;
+    };
+
+    // Elementwise loops per instruction set (common/isa.hpp) ------------------------------------
+
+    // c[i] = a[i] + b[i] for i in [begin, end)
+    inline void addScalar(const float *a, const float *b, float *c, size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+            c[i] = a[i] + b[i];
+    }
+
+    ISA_AVX2 inline void addAVX2(const float *a, const float *b, float *c, size_t begin, size_t end)
+    {
+        size_t i = begin;
+        for (; i + 8 <= end; i += 8)
+            _mm256_storeu_ps(c + i, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+        for (; i < end; i++)
+            c[i] = a[i] + b[i];
+    }
+
+    ISA_AVX512 inline void addAVX512(const float *a, const float *b, float *c, size_t begin, size_t end)
+    {
+        size_t i = begin;
+        for (; i + 16 <= end; i += 16)
+            _mm512_storeu_ps(c + i, _mm512_add_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i)));
+        if (i < end)
+        {
+            __mmask16 m = static_cast<__mmask16>((1u << (end - i)) - 1);
+            _mm512_mask_storeu_ps(c + i, m, _mm512_add_ps(_mm512_maskz_loadu_ps(m, a + i), _mm512_maskz_loadu_ps(m, b + i)));
+        }
+    }
+
+    // data[i] = fma(data[i], scale, shift) for i in [begin, end); every variant rounds once
+    inline void scaleScalar(float *data, size_t begin, size_t end, float scale, float shift)
+    {
+        for (size_t i = begin; i < end; i++)
+            data[i] = std::fma(data[i], scale, shift);
+    }
+
+    ISA_AVX2 inline void scaleAVX2(float *data, size_t begin, size_t end, float scale, float shift)
+    {
+        const __m256 vs = _mm256_set1_ps(scale), vt = _mm256_set1_ps(shift);
+        size_t i = begin;
+        for (; i + 8 <= end; i += 8)
+            _mm256_storeu_ps(data + i, _mm256_fmadd_ps(_mm256_loadu_ps(data + i), vs, vt));
+        for (; i < end; i++)
+            data[i] = std::fma(data[i], scale, shift);
+    }
+
+    ISA_AVX512 inline void scaleAVX512(float *data, size_t begin, size_t end, float scale, float shift)
+    {
+        const __m512 vs = _mm512_set1_ps(scale), vt = _mm512_set1_ps(shift);
+        size_t i = begin;
+        for (; i + 16 <= end; i += 16)
+            _mm512_storeu_ps(data + i, _mm512_fmadd_ps(_mm512_loadu_ps(data + i), vs, vt));
+        if (i < end)
+        {
+            __mmask16 m = static_cast<__mmask16>((1u << (end - i)) - 1);
+            _mm512_mask_storeu_ps(data + i, m, _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, data + i), vs, vt));
+        }
+    }
+
+    // vec[i] /= |vec[i]| for i in [begin, end): sqrt and divide are correctly rounded in every
+    // variant, so all of them match vec4::normalizeScalar bit for bit
+    inline void normalizeScalar(vec4::Vec4 *vec, size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+            vec4::normalizeScalar(vec[i]);
+    }
+
+    ISA_AVX2 inline void normalizeAVX2(vec4::Vec4 *vec, size_t begin, size_t end)
+    {
+        size_t i = begin;
+        for (; i < end && i % 8 != 0; i++)
+            vec4::normalizeScalar(vec[i]);
+        for (; i + 8 <= end; i += 8)
+        {
+            vec4::Block b;
+            vec4::gather(vec + i, b);
+            __m256 x = _mm256_load_ps(b.x), y = _mm256_load_ps(b.y);
+            __m256 z = _mm256_load_ps(b.z), w = _mm256_load_ps(b.w);
+            __m256 n2 = _mm256_mul_ps(x, x);
+            n2 = _mm256_fmadd_ps(y, y, n2);
+            n2 = _mm256_fmadd_ps(z, z, n2);
+            n2 = _mm256_fmadd_ps(w, w, n2);
+            __m256 norm = _mm256_sqrt_ps(n2);
+            __m256 zero = _mm256_cmp_ps(norm, _mm256_setzero_ps(), _CMP_NGT_UQ); // !(norm > 0)
+            norm = _mm256_blendv_ps(norm, _mm256_set1_ps(1.0f), zero);
+            _mm256_store_ps(b.x, _mm256_div_ps(x, norm));
+            _mm256_store_ps(b.y, _mm256_div_ps(y, norm));
+            _mm256_store_ps(b.z, _mm256_div_ps(z, norm));
+            _mm256_store_ps(b.w, _mm256_div_ps(w, norm));
+            vec4::scatter(b, vec + i);
+        }
+        for (; i < end; i++)
+            vec4::normalizeScalar(vec[i]);
+    }
+
+    using AddFn = void (*)(const float *, const float *, float *, size_t, size_t);
+    using ScaleFn = void (*)(float *, size_t, size_t, float, float);
+    using NormalizeFn = void (*)(vec4::Vec4 *, size_t, size_t);
+
+    inline const isa::Variants<AddFn> &addVariants()
+    {
+        static const isa::Variants<AddFn> v = {addScalar, addAVX2, addAVX512};
+        return v;
+    }
+
+    inline const isa::Variants<ScaleFn> &scaleVariants()
+    {
+        static const isa::Variants<ScaleFn> v = {scaleScalar, scaleAVX2, scaleAVX512};
+        return v;
+    }
+
+    inline const isa::Variants<NormalizeFn> &normalizeVariants()
+    {
+        static const isa::Variants<NormalizeFn> v = {normalizeScalar, normalizeAVX2, nullptr};
+        return v;
+    }
+
+    // Kernels -----------------------------------------------------------------------------------
+
+    // c[id] = a[id] + b[id], on the widest variant the CPU has
+    struct AddKernel
+    {
+        const float *a, *b;
+        float *c;
+        size_t size;
+
+        void operator()(size_t begin, size_t end) const
+        {
+            static const AddFn add = addVariants().pick();
+            add(a, b, c, begin, std::min(end, size));
+        }
+    };
+
+    // data[id] = data[id] * scale + shift
+    struct ScaleKernel
+    {
+        float *data;
+        size_t size;
+        float scale, shift;
+
+        void operator()(size_t begin, size_t end) const
+        {
+            static const ScaleFn fn = scaleVariants().pick();
+            fn(data, begin, std::min(end, size), scale, shift);
+        }
+    };
+
+    // vec[id] /= |vec[id]| unless the norm is zero. Eight float4s are transposed in registers
+    // (vec4::gather), normalized with a correctly rounded sqrt and divide as the CUDA kernel does,
+    // and transposed back.
+    struct NormalizeKernel
+    {
+        vec4::Vec4 *vec;
+        size_t size;
+
+        void operator()(size_t begin, size_t end) const
+        {
+            static const NormalizeFn fn = normalizeVariants().pick();
+            fn(vec, begin, std::min(end, size));
+        }
+    };
+
+    // Entry points, one per CUDA kernel ---------------------------------------------------------
+
+    template <typename Backend>
+    void addVectors(Backend &be, Grid grid, const float *a, const float *b, float *c, size_t size)
+    {
+        be.launch(grid, AddKernel{a, b, c, size});
+    }
+
+    template <typename Backend>
+    void scaleKernel(Backend &be, Grid grid, float *data, size_t size, float scale, float shift)
+    {
+        be.launch(grid, ScaleKernel{data, size, scale, shift});
+    }
+
+    template <typename Backend>
+    void normalizeVectors(Backend &be, Grid grid, vec4::Vec4 *vec, size_t size)
+    {
+        be.launch(grid, NormalizeKernel{vec, size});
+    }
+}
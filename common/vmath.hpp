@@ -0,0 +1,213 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <immintrin.h>
+#include "isa.hpp"
+
+// Vectorized x^-s for 4 doubles at a time (AVX2 + FMA).
+//
+// A real exponent goes through x^-s = exp(-s * ln x): ln x is reduced to a mantissa in
+// [sqrt(1/2), sqrt(2)) and a polynomial in f / (2 + f) (fdlibm's log), exp is reduced by
+// multiples of ln 2 (Cody-Waite) to a Taylor polynomial on |r| <= ln2 / 2. The accuracy level
+// selects polynomial degrees and whether -s * ln x is carried as a double-double, which is what
+// keeps the large |s ln x| products from losing their low bits. An integer exponent skips all of
+// that: x^-S is one division of x^S, formed by repeated squaring at compile time.
+//
+// Domain: x positive and finite, x^-s in the normal double range.
+//
+// The kernels work on __m256d and are compiled for AVX2 + FMA with ISA_AVX2, so they must only be
+// reached from a function that carries ISA_AVX2 too and runs behind an isa::Variants choice
+// (common/isa.hpp). negPowArray is that choice for whole arrays, with libm's pow as the scalar
+// variant.
+namespace vmath
+{
+    enum class Accuracy
+    {
+        Fast,   // short polynomials, ~1e-7 relative
+        Medium, // full polynomials in plain double, error grows with |s ln x|
+        High    // full polynomials, -s ln x kept as hi + lo; a few ulp
+    };
+
+    // ln 2 split so that k * LN2_HI is exact for |k| < 2^20
+    constexpr double LN2_HI = 6.93147180369123816490e-01;
+    constexpr double LN2_LO = 1.90821492927058770002e-10;
+    constexpr double LOG2E = 1.44269504088896338700e+00;
+
+    // Small non-negative integer-valued doubles <-> int64 lanes, via the 2^52 + 2^51 bias
+    ISA_AVX2 inline __m256d int64ToDouble(__m256i v)
+    {
+        const __m256d magic = _mm256_set1_pd(6755399441055744.0);
+        return _mm256_sub_pd(_mm256_castsi256_pd(_mm256_add_epi64(v, _mm256_castpd_si256(magic))), magic);
+    }
+
+    ISA_AVX2 inline __m256i doubleToInt64(__m256d v)
+    {
+        const __m256d magic = _mm256_set1_pd(6755399441055744.0);
+        return _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(v, magic)), _mm256_castpd_si256(magic));
+    }
+
+    // ln x = hi + lo (lo is zero unless A == High)
+    template <Accuracy A>
+    ISA_AVX2 void log(__m256d x, __m256d &hi, __m256d &lo)
+    {
+        // x = 2^e * m with m in [1, 2), then m >= sqrt(2) moves to [sqrt(1/2), 1)
+        __m256i bits = _mm256_castpd_si256(x);
+        __m256i e = _mm256_sub_epi64(_mm256_srli_epi64(bits, 52), _mm256_set1_epi64x(1023));
+        __m256d m = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL)),
+                                                        _mm256_set1_epi64x(0x3FF0000000000000LL)));
+        __m256d big = _mm256_cmp_pd(m, _mm256_set1_pd(1.41421356237309504880), _CMP_GE_OQ);
+        m = _mm256_blendv_pd(m, _mm256_mul_pd(m, _mm256_set1_pd(0.5)), big);
+        __m256d k = _mm256_add_pd(int64ToDouble(e), _mm256_and_pd(big, _mm256_set1_pd(1.0)));
+
+        // ln m = f - (f^2/2 - t (f^2/2 + R(t^2))), t = f / (2 + f), f = m - 1 exact
+        __m256d f = _mm256_sub_pd(m, _mm256_set1_pd(1.0));
+        __m256d t = _mm256_div_pd(f, _mm256_add_pd(_mm256_set1_pd(2.0), f));
+        __m256d z = _mm256_mul_pd(t, t);
+        __m256d R;
+        if (A == Accuracy::Fast)
+        {
+            R = _mm256_fmadd_pd(z, _mm256_set1_pd(2.857142874366239149e-01), _mm256_set1_pd(3.999999999940941908e-01));
+            R = _mm256_fmadd_pd(z, R, _mm256_set1_pd(6.666666666666735130e-01));
+        }
+        else
+        {
+            R = _mm256_fmadd_pd(z, _mm256_set1_pd(1.479819860511658591e-01), _mm256_set1_pd(1.531383769920937332e-01));
+            R = _mm256_fmadd_pd(z, R, _mm256_set1_pd(1.818357216161805012e-01));
+            R = _mm256_fmadd_pd(z, R, _mm256_set1_pd(2.222219843214978396e-01));
+            R = _mm256_fmadd_pd(z, R, _mm256_set1_pd(2.857142874366239149e-01));
+            R = _mm256_fmadd_pd(z, R, _mm256_set1_pd(3.999999999940941908e-01));
+            R = _mm256_fmadd_pd(z, R, _mm256_set1_pd(6.666666666666735130e-01));
+        }
+        R = _mm256_mul_pd(z, R);
+        __m256d hfsq = _mm256_mul_pd(_mm256_set1_pd(0.5), _mm256_mul_pd(f, f));
+        __m256d tail = _mm256_fnmadd_pd(t, _mm256_add_pd(hfsq, R), hfsq); // ln m = f - tail
+
+        if (A == Accuracy::High)
+        {
+            // hi + lo = k LN2_HI + f exactly (two-sum), then the small terms go into lo
+            __m256d a = _mm256_mul_pd(k, _mm256_set1_pd(LN2_HI));
+            hi = _mm256_add_pd(a, f);
+            __m256d bv = _mm256_sub_pd(hi, a);
+            __m256d err = _mm256_add_pd(_mm256_sub_pd(a, _mm256_sub_pd(hi, bv)), _mm256_sub_pd(f, bv));
+            lo = _mm256_fmsub_pd(k, _mm256_set1_pd(LN2_LO), _mm256_sub_pd(tail, err));
+            // Renormalize so lo is below half an ulp of hi (|hi| >= |lo| here, fast two-sum)
+            __m256d sum = _mm256_add_pd(hi, lo);
+            lo = _mm256_sub_pd(lo, _mm256_sub_pd(sum, hi));
+            hi = sum;
+        }
+        else
+        {
+            hi = _mm256_fmadd_pd(k, _mm256_set1_pd(LN2_HI), _mm256_sub_pd(f, _mm256_fnmadd_pd(k, _mm256_set1_pd(LN2_LO), tail)));
+            lo = _mm256_setzero_pd();
+        }
+    }
+
+    // exp(hi + lo), lo a small correction to hi
+    template <Accuracy A>
+    ISA_AVX2 __m256d exp(__m256d hi, __m256d lo)
+    {
+        __m256d k = _mm256_round_pd(_mm256_mul_pd(hi, _mm256_set1_pd(LOG2E)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m256d r = _mm256_fnmadd_pd(k, _mm256_set1_pd(LN2_HI), hi);
+        r = _mm256_add_pd(_mm256_fnmadd_pd(k, _mm256_set1_pd(LN2_LO), r), lo);
+
+        // Taylor series of e^r on |r| <= 0.347: degree 7 leaves 5e-9, degree 13 is below 1e-17
+        constexpr int degree = A == Accuracy::Fast ? 7 : 13;
+        __m256d p = _mm256_set1_pd(1.0);
+        for (int n = degree; n >= 1; n--)
+            p = _mm256_fmadd_pd(p, _mm256_mul_pd(r, _mm256_set1_pd(1.0 / n)), _mm256_set1_pd(1.0));
+
+        // Scale by 2^k through the exponent field
+        __m256i scale = _mm256_slli_epi64(_mm256_add_epi64(doubleToInt64(k), _mm256_set1_epi64x(1023)), 52);
+        return _mm256_mul_pd(p, _mm256_castsi256_pd(scale));
+    }
+
+    // x^-s for a real exponent s
+    template <Accuracy A>
+    struct RealPow
+    {
+        static const char *name()
+        {
+            return A == Accuracy::Fast ? "real, fast" : A == Accuracy::Medium ? "real, medium" : "real, high";
+        }
+
+        ISA_AVX2 static __m256d negPow(__m256d x, double s)
+        {
+            __m256d hi, lo;
+            log<A>(x, hi, lo);
+            __m256d ms = _mm256_set1_pd(-s);
+            __m256d yh = _mm256_mul_pd(ms, hi);
+            __m256d yl = _mm256_setzero_pd();
+            if (A == Accuracy::High)
+                yl = _mm256_fmadd_pd(ms, lo, _mm256_fmsub_pd(ms, hi, yh)); // rounding error of -s * hi, plus -s * lo
+            return exp<A>(yh, yl);
+        }
+    };
+
+    // x^S by repeated squaring, unrolled at compile time
+    template <int S>
+    ISA_AVX2 __m256d intPow(__m256d x)
+    {
+        if constexpr (S == 1)
+            return x;
+        else if constexpr (S % 2 == 0)
+        {
+            __m256d h = intPow<S / 2>(x);
+            return _mm256_mul_pd(h, h);
+        }
+        else
+            return _mm256_mul_pd(intPow<S - 1>(x), x);
+    }
+
+    // x^-S for a compile-time positive integer S; the runtime s is ignored
+    template <int S>
+    struct IntPow
+    {
+        static_assert(S > 0, "IntPow needs a positive exponent");
+        static const char *name() { return "integer"; }
+        ISA_AVX2 static __m256d negPow(__m256d x, double) { return _mm256_div_pd(_mm256_set1_pd(1.0), intPow<S>(x)); }
+    };
+
+    // out[i] = x[i]^-s for i in [0, n), through libm or through the kernel Pow (IntPow<S> needs s == S)
+    template <typename Pow>
+    void negPowScalar(const double *x, double *out, size_t n, double s)
+    {
+        for (size_t i = 0; i < n; i++)
+            out[i] = std::pow(x[i], -s);
+    }
+
+    template <typename Pow>
+    ISA_AVX2 void negPowAVX2(const double *x, double *out, size_t n, double s)
+    {
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm256_storeu_pd(out + i, Pow::negPow(_mm256_loadu_pd(x + i), s));
+        if (i < n)
+        {
+            // 1-3 leftovers: pad with 1.0, inside the domain of every kernel
+            double in[4] = {1.0, 1.0, 1.0, 1.0}, res[4];
+            for (size_t l = 0; i + l < n; l++)
+                in[l] = x[i + l];
+            _mm256_storeu_pd(res, Pow::negPow(_mm256_loadu_pd(in), s));
+            for (size_t l = 0; i + l < n; l++)
+                out[i + l] = res[l];
+        }
+    }
+
+    using NegPowFn = void (*)(const double *, double *, size_t, double);
+
+    template <typename Pow>
+    const isa::Variants<NegPowFn> &negPowVariants()
+    {
+        static const isa::Variants<NegPowFn> v = {negPowScalar<Pow>, negPowAVX2<Pow>, nullptr};
+        return v;
+    }
+
+    template <typename Pow>
+    void negPowArray(const double *x, double *out, size_t n, double s)
+    {
+        static const NegPowFn fn = negPowVariants<Pow>().pick();
+        fn(x, out, n, s);
+    }
+}
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Work-stealing scheduler over index ranges.
+//
+// The iteration space is cut into chunks by a policy (fixed, guided, or balanced by a cost model),
+// the chunks are dealt to per-worker Chase-Lev deques, and each worker pops from the bottom of its
+// own deque. An idle worker steals from the top of another worker's deque, so workers hand out
+// chunks without a shared work counter. One shared counter remains, `remaining`, for termination:
+// every worker decrements it once per finished chunk and reads it on each pass of its loop, so
+// idle workers poll it in their steal loop until it reaches zero.
+// Results are written through per-worker batches, and each worker's busy/idle time is recorded.
+namespace ws
+{
+    struct Range
+    {
+        uint64_t begin, end;
+    };
+
+    // Fixed-capacity Chase-Lev deque of task indices (Le, Pop, Cohen, Zappa Nardelli, PPoPP'13).
+    // The owner pushes and takes at the bottom; thieves steal at the top.
+    class Deque
+    {
+    public:
+        static constexpr int64_t EMPTY = -1;
+
+        explicit Deque(size_t capacity)
+        {
+            size_t cap = 1;
+            while (cap < capacity)
+                cap <<= 1;
+            buffer_ = std::vector<std::atomic<int64_t>>(cap);
+            mask_ = cap - 1;
+        }
+
+        void push(int64_t task)
+        {
+            int64_t b = bottom_.load(std::memory_order_relaxed);
+            buffer_[b & mask_].store(task, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+
+        int64_t take()
+        {
+            int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+            bottom_.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t t = top_.load(std::memory_order_relaxed);
+            if (t > b)
+            {
+                bottom_.store(b + 1, std::memory_order_relaxed);
+                return EMPTY;
+            }
+            int64_t task = buffer_[b & mask_].load(std::memory_order_relaxed);
+            if (t == b)
+            {
+                // Last element: race against thieves for it
+                if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                    task = EMPTY;
+                bottom_.store(b + 1, std::memory_order_relaxed);
+            }
+            return task;
+        }
+
+        int64_t steal()
+        {
+            int64_t t = top_.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t b = bottom_.load(std::memory_order_acquire);
+            if (t >= b)
+                return EMPTY;
+            int64_t task = buffer_[t & mask_].load(std::memory_order_relaxed);
+            if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                return EMPTY;
+            return task;
+        }
+
+    private:
+        alignas(64) std::atomic<int64_t> top_{0};
+        alignas(64) std::atomic<int64_t> bottom_{0};
+        std::vector<std::atomic<int64_t>> buffer_;
+        size_t mask_;
+    };
+
+    // Chunk policies ---------------------------------------------------------------------------
+
+    // Fixed-size chunks: [0, c), [c, 2c), ...
+    inline std::vector<Range> fixedChunks(uint64_t n, uint64_t chunk)
+    {
+        std::vector<Range> chunks;
+        for (uint64_t k = 0; k < n; k += chunk)
+            chunks.push_back({k, std::min(k + chunk, n)});
+        return chunks;
+    }
+
+    // Guided: each chunk takes remaining / threads indices, never fewer than min_chunk
+    inline std::vector<Range> guidedChunks(uint64_t n, uint64_t threads, uint64_t min_chunk)
+    {
+        std::vector<Range> chunks;
+        for (uint64_t k = 0; k < n;)
+        {
+            uint64_t size = std::max(min_chunk, (n - k + threads - 1) / threads);
+            chunks.push_back({k, std::min(k + size, n)});
+            k += size;
+        }
+        return chunks;
+    }
+
+    // Cost model: cut [0, n) into threads * chunks_per_thread pieces of equal estimated cost,
+    // where cost(i) is the relative cost of index i (e.g. i * i for a quadratic kernel)
+    template <typename Cost>
+    std::vector<Range> costChunks(uint64_t n, uint64_t threads, uint64_t chunks_per_thread, Cost cost)
+    {
+        double total = 0;
+        for (uint64_t i = 0; i < n; i++)
+            total += cost(i);
+        double target = total / static_cast<double>(threads * chunks_per_thread);
+
+        std::vector<Range> chunks;
+        uint64_t begin = 0;
+        double acc = 0;
+        for (uint64_t i = 0; i < n; i++)
+        {
+            acc += cost(i);
+            if (acc >= target || i + 1 == n)
+            {
+                chunks.push_back({begin, i + 1});
+                begin = i + 1;
+                acc = 0;
+            }
+        }
+        return chunks;
+    }
+
+    // Scheduler --------------------------------------------------------------------------------
+
+    struct alignas(64) WorkerStats
+    {
+        double busy = 0;  // seconds spent inside tasks
+        double idle = 0;  // seconds spent looking for work
+        uint64_t tasks = 0;
+        uint64_t steals = 0;
+    };
+
+    // out[i] = fn(i) for every i in the chunks, on num_threads workers with stealing.
+    // Each worker keeps its results in a private batch and copies them to `out` once it runs out
+    // of work, so neighbouring indices computed by different threads never share a line while hot.
+    template <typename T, typename F>
+    std::vector<WorkerStats> run(const std::vector<Range> &chunks, int num_threads, T *out, F fn)
+    {
+        using clock = std::chrono::steady_clock;
+        std::vector<WorkerStats> stats(num_threads);
+        std::vector<std::unique_ptr<Deque>> deques;
+        for (int t = 0; t < num_threads; t++)
+            deques.emplace_back(new Deque(chunks.size() / num_threads + 2));
+
+        // Deal chunks round-robin so every worker starts with a mix of cheap and expensive ones
+        for (size_t c = 0; c < chunks.size(); c++)
+            deques[c % num_threads]->push(static_cast<int64_t>(c));
+
+        std::atomic<int64_t> remaining(static_cast<int64_t>(chunks.size()));
+        auto start = clock::now();
+
+        auto worker = [&](int id)
+        {
+            WorkerStats &st = stats[id];
+            std::vector<std::pair<uint64_t, T>> batch;
+            uint32_t seed = 2654435761u * (id + 1);
+            auto idle_since = clock::now();
+
+            while (remaining.load(std::memory_order_acquire) > 0)
+            {
+                int64_t task = deques[id]->take();
+                if (task == Deque::EMPTY)
+                {
+                    // Pick a random victim (xorshift) and try to steal from its top
+                    seed ^= seed << 13;
+                    seed ^= seed >> 17;
+                    seed ^= seed << 5;
+                    int victim = static_cast<int>(seed % num_threads);
+                    if (victim != id)
+                        task = deques[victim]->steal();
+                    if (task == Deque::EMPTY)
+                    {
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    st.steals++;
+                }
+
+                auto t0 = clock::now();
+                st.idle += std::chrono::duration<double>(t0 - idle_since).count();
+                for (uint64_t i = chunks[task].begin; i < chunks[task].end; i++)
+                    batch.emplace_back(i, fn(i));
+                idle_since = clock::now();
+                st.busy += std::chrono::duration<double>(idle_since - t0).count();
+                st.tasks++;
+                remaining.fetch_sub(1, std::memory_order_acq_rel);
+            }
+            for (const auto &r : batch)
+                out[r.first] = r.second;
+            st.idle += std::chrono::duration<double>(clock::now() - idle_since).count();
+        };
+
+        std::vector<std::thread> threads;
+        for (int t = 1; t < num_threads; t++)
+            threads.emplace_back(worker, t);
+        worker(0);
+        for (auto &t : threads)
+            t.join();
+
+        // Idle also covers the time between a worker finishing and the last one finishing
+        double wall = std::chrono::duration<double>(clock::now() - start).count();
+        for (auto &st : stats)
+            st.idle = std::max(st.idle, wall - st.busy);
+        return stats;
+    }
+}
@@ -0,0 +1,465 @@
+// Runs every SIMD variant in common/ against its scalar variant, on sizes that leave tails for
+// the 8- and 16-wide loops and on unaligned starts. Variants that round the same way must match
+// bit for bit; the rest (different summation order, approximations) must stay within the bound
+// printed next to them. The labs call the same functions through isa::Variants::pick(), so this is
+// the one place that exercises the levels the current machine would not pick.
+//
+//   g++ -O3 -fopenmp -pthread -o isa_check isa_check.cpp && ./isa_check
+//
+// SIMD_ISA=avx2 stops at AVX2 on an AVX-512 machine. The exit status is nonzero on any mismatch.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "common/elementwise.hpp"
+#include "common/gemm.hpp"
+#include "common/gemm_fp16.hpp"
+#include "common/isa.hpp"
+#include "common/knapsack.hpp"
+#include "common/matmul.hpp"
+#include "common/random.hpp"
+#include "common/reduce.hpp"
+#include "common/transpose.hpp"
+#include "common/vec4.hpp"
+#include "common/vector_ops.hpp"
+#include "common/vmath.hpp"
+
+struct Outcome
+{
+    bool ok;
+    std::string detail;
+};
+
+int failures = 0;
+
+// Bit-for-bit comparison, so NaN payloads and signed zeros count
+template <typename T>
+Outcome exact(const std::vector<T> &ref, const std::vector<T> &out, const char *against = "scalar")
+{
+    bool same = ref.size() == out.size() && std::memcmp(ref.data(), out.data(), ref.size() * sizeof(T)) == 0;
+    return {same, same ? "exact" : std::string("differs from ") + against};
+}
+
+// max |ref - out| / max(|ref|, floor) against a bound
+template <typename T>
+Outcome within(const std::vector<T> &ref, const std::vector<T> &out, double bound, double floor = 1.0)
+{
+    double max_err = 0;
+    for (size_t i = 0; i < ref.size(); i++)
+    {
+        double r = ref[i], o = out[i];
+        double err = std::fabs(r - o) / std::max(std::fabs(r), floor);
+        if (!(err <= max_err)) // NaN counts as a failure
+            max_err = std::isnan(err) ? INFINITY : err;
+    }
+    std::ostringstream os;
+    os << "max relative error " << max_err << " (bound " << bound << ")";
+    return {max_err <= bound, os.str()};
+}
+
+void report(const Outcome &o)
+{
+    failures += !o.ok;
+    std::cout << (o.ok ? "OK        " : "MISMATCH  ") << o.detail << "\n";
+}
+
+// run(variant) for the AVX2 and AVX-512 entries of `variants`, one line each; a table without an
+// AVX-512 entry falls back to its AVX2 one, which has already been checked
+template <typename Fn, typename Run>
+void check(const std::string &what, const isa::Variants<Fn> &variants, Run run)
+{
+    for (isa::Level level : {isa::Level::AVX2, isa::Level::AVX512})
+    {
+        std::cout << "  " << std::left << std::setw(36) << what << std::setw(10) << isa::name(level) << std::right;
+        if (!isa::supports(level))
+        {
+            std::cout << "not supported by this CPU\n";
+            continue;
+        }
+        if (level > isa::selected())
+        {
+            std::cout << "skipped (SIMD_ISA)\n";
+            continue;
+        }
+        if (level == isa::Level::AVX512 && !variants.avx512)
+        {
+            std::cout << "no variant (uses avx2+fma)\n";
+            continue;
+        }
+        report(run(variants.at(level)));
+    }
+}
+
+// The scalar entry too, for checks against values known in advance rather than against scalar
+template <typename Fn, typename Run>
+void checkKnown(const std::string &what, const isa::Variants<Fn> &variants, Run run)
+{
+    std::cout << "  " << std::left << std::setw(36) << what << std::setw(10) << isa::name(isa::Level::Scalar) << std::right;
+    report(run(variants.scalar));
+    check(what, variants, run);
+}
+
+template <typename T>
+std::vector<T> uniform(size_t n, T lo, T hi, uint64_t seed)
+{
+    std::vector<T> v(n);
+    rng::fill_uniform(v, lo, hi, seed);
+    return v;
+}
+
+// gemm ------------------------------------------------------------------------------------------
+
+// Odd M, L, N with padded leading dimensions and alpha/beta; L crosses a KC block
+template <typename T>
+void checkGemm(const char *type, double bound)
+{
+    const int M = 37, L = 300, N = 21, lda = L + 3, ldb = N + 5, ldc = N + 7;
+    auto A = uniform<T>(static_cast<size_t>(M) * lda, -1, 1, 1);
+    auto B = uniform<T>(static_cast<size_t>(L) * ldb, -1, 1, 2);
+    auto C0 = uniform<T>(static_cast<size_t>(M) * ldc, -1, 1, 3);
+    auto ref = C0, par_ref = C0;
+    gemm::gemmScalar<T>(M, L, N, A.data(), lda, B.data(), ldb, ref.data(), ldc, T(0.5), T(2));
+    gemm::gemmParallelScalar<T>(M, L, N, A.data(), lda, B.data(), ldb, par_ref.data(), ldc, T(0.5), T(2), 3);
+
+    check(std::string("gemm<") + type + ">", gemm::gemmVariants<T>(), [&](auto fn)
+          {
+              auto C = C0;
+              fn(M, L, N, A.data(), lda, B.data(), ldb, C.data(), ldc, T(0.5), T(2));
+              return within(ref, C, bound); });
+    check(std::string("gemmParallel<") + type + ">", gemm::gemmParallelVariants<T>(), [&](auto fn)
+          {
+              auto C = C0;
+              fn(M, L, N, A.data(), lda, B.data(), ldb, C.data(), ldc, T(0.5), T(2), 3);
+              return within(par_ref, C, bound); });
+}
+
+// half -------------------------------------------------------------------------------------------
+
+// Every half, and for floats: the specials, a sweep over the bit patterns, and every rounding
+// midpoint between adjacent halves with its neighbours one float ulp away
+template <typename H>
+void checkHalfConversions()
+{
+    std::vector<uint16_t> halves(65536);
+    for (size_t i = 0; i < halves.size(); i++)
+        halves[i] = static_cast<uint16_t>(i);
+
+    std::vector<float> floats = {0.0f, -0.0f, INFINITY, -INFINITY, NAN, -NAN, FLT_MIN, FLT_MAX, -FLT_MAX, 65504.0f,
+                                 65519.99f, 65520.0f, 0x1p-24f, 0x1p-25f, 0x1.8p-25f, 0x1p-26f};
+    for (uint64_t bits = 0; bits <= 0xFFFFFFFFu; bits += 4093)
+    {
+        float f;
+        uint32_t b = static_cast<uint32_t>(bits);
+        std::memcpy(&f, &b, sizeof(f));
+        floats.push_back(f);
+    }
+    for (uint32_t h = 0; h < 0x7C00; h++)
+    {
+        float lo = H::toFloat(static_cast<uint16_t>(h)), hi = H::toFloat(static_cast<uint16_t>(h + 1));
+        if (!std::isfinite(hi))
+            break;
+        float mid = lo + (hi - lo) / 2;
+        for (float f : {mid, std::nextafter(mid, -INFINITY), std::nextafter(mid, INFINITY)})
+        {
+            floats.push_back(f);
+            floats.push_back(-f);
+        }
+    }
+    floats.resize(floats.size() / 8 * 8 + 5); // a tail for the 8-wide loops
+
+    std::vector<float> widened_ref(halves.size());
+    std::vector<uint16_t> narrowed_ref(floats.size());
+    half::toFloatScalar<H>(halves.data(), widened_ref.data(), halves.size());
+    half::fromFloatScalar<H>(floats.data(), narrowed_ref.data(), floats.size());
+
+    check(std::string("half::toFloat<") + H::name() + ">", half::toFloatVariants<H>(), [&](auto fn)
+          {
+              std::vector<float> out(halves.size());
+              fn(halves.data(), out.data(), halves.size());
+              return exact(widened_ref, out); });
+    check(std::string("half::fromFloat<") + H::name() + ">", half::fromFloatVariants<H>(), [&](auto fn)
+          {
+              std::vector<uint16_t> out(floats.size());
+              fn(floats.data(), out.data(), floats.size());
+              return exact(narrowed_ref, out); });
+}
+
+// NaNs (quiet, signalling, negative, all-ones), infinities and the largest finite float, against
+// the expected bits: NaNs stay NaN with the quiet bit set, they never round into an infinity or
+// wrap to zero. 11 inputs cover an 8-wide step and a tail.
+template <typename H>
+void checkHalfSpecials(std::vector<uint32_t> float_bits, std::vector<uint16_t> expected_halves,
+                       std::vector<uint16_t> half_bits, std::vector<uint32_t> expected_floats)
+{
+    std::vector<float> floats(float_bits.size()), widened_expected(expected_floats.size());
+    std::memcpy(floats.data(), float_bits.data(), float_bits.size() * sizeof(float));
+    std::memcpy(widened_expected.data(), expected_floats.data(), expected_floats.size() * sizeof(float));
+
+    checkKnown(std::string("half::fromFloat<") + H::name() + "> specials", half::fromFloatVariants<H>(), [&](auto fn)
+               {
+                   std::vector<uint16_t> out(floats.size());
+                   fn(floats.data(), out.data(), floats.size());
+                   return exact(expected_halves, out, "expected"); });
+    checkKnown(std::string("half::toFloat<") + H::name() + "> specials", half::toFloatVariants<H>(), [&](auto fn)
+               {
+                   std::vector<float> out(half_bits.size());
+                   fn(half_bits.data(), out.data(), half_bits.size());
+                   return exact(widened_expected, out, "expected"); });
+}
+
+template <typename H>
+void checkHalfGemm()
+{
+    const int M = 29, L = 300, N = 35, lda = L + 1, ldb = N + 3, ldc = N + 2;
+    auto Af = uniform<float>(static_cast<size_t>(M) * lda, -1, 1, 4);
+    auto Bf = uniform<float>(static_cast<size_t>(L) * ldb, -1, 1, 5);
+    auto C0 = uniform<float>(static_cast<size_t>(M) * ldc, -1, 1, 6);
+    std::vector<uint16_t> A(Af.size()), B(Bf.size());
+    half::fromFloatScalar<H>(Af.data(), A.data(), A.size());
+    half::fromFloatScalar<H>(Bf.data(), B.data(), B.size());
+    auto ref = C0;
+    half::gemmScalar<H>(M, L, N, A.data(), lda, B.data(), ldb, ref.data(), ldc, 0.5f, 2.0f, 3);
+
+    check(std::string("half::gemm<") + H::name() + ">", half::gemmVariants<H>(), [&](auto fn)
+          {
+              auto C = C0;
+              fn(M, L, N, A.data(), lda, B.data(), ldb, C.data(), ldc, 0.5f, 2.0f, 3);
+              return within(ref, C, 1e-4); });
+}
+
+// transpose -------------------------------------------------------------------------------------
+
+void checkTranspose()
+{
+    const int rows = 45, cols = 53;
+    const size_t lds = cols + 3, ldd = rows + 5;
+    auto src = uniform<float>(rows * lds, -1, 1, 7);
+    std::vector<float> ref(cols * ldd, -1.0f);
+    transpose::tileScalar(src.data(), lds, ref.data(), ldd, 3, rows, 1, cols);
+    check("transpose::tile", transpose::tileVariants(), [&](auto fn)
+          {
+              std::vector<float> out(cols * ldd, -1.0f);
+              fn(src.data(), lds, out.data(), ldd, 3, rows, 1, cols);
+              return exact(ref, out); });
+
+    const int n = 61;
+    const size_t lda = n + 4;
+    auto A = uniform<float>(n * lda, -1, 1, 8);
+    auto square_ref = A;
+    for (int bi = 0; bi + 8 <= n; bi += 8)
+        transpose::squareStripeScalar(square_ref.data(), lda, n, bi);
+    check("transpose::squareStripe", transpose::squareStripeVariants(), [&](auto fn)
+          {
+              auto out = A;
+              for (int bi = 0; bi + 8 <= n; bi += 8)
+                  fn(out.data(), lda, n, bi);
+              return exact(square_ref, out); });
+}
+
+// vec4 / vops ------------------------------------------------------------------------------------
+
+void checkVec4()
+{
+    const size_t blocks = 37, n = blocks * 8;
+    auto raw = uniform<float>(4 * n, -1, 1, 9);
+    // a zero vector and a tiny one exercise the masked and the scalar fallback paths
+    std::fill(raw.begin() + 4 * 3, raw.begin() + 4 * 4, 0.0f);
+    std::fill(raw.begin() + 4 * 20, raw.begin() + 4 * 21, 1e-30f);
+    std::vector<vec4::Vec4> aos(n);
+    std::memcpy(aos.data(), raw.data(), raw.size() * sizeof(float));
+
+    std::vector<vec4::Block> soa_ref(blocks);
+    vec4::gatherBlocksScalar(aos.data(), soa_ref.data(), 0, blocks);
+    auto asFloats = [](const auto &v)
+    {
+        std::vector<float> f(v.size() * sizeof(v[0]) / sizeof(float));
+        std::memcpy(f.data(), v.data(), f.size() * sizeof(float));
+        return f;
+    };
+
+    check("vec4::gatherBlocks", vec4::gatherVariants(), [&](auto fn)
+          {
+              std::vector<vec4::Block> out(blocks);
+              fn(aos.data(), out.data(), 0, blocks);
+              return exact(asFloats(soa_ref), asFloats(out)); });
+    check("vec4::scatterBlocks", vec4::scatterVariants(), [&](auto fn)
+          {
+              std::vector<vec4::Vec4> out(n);
+              fn(soa_ref.data(), out.data(), 0, blocks);
+              return exact(asFloats(aos), asFloats(out)); });
+
+    auto normalized_ref = soa_ref;
+    vec4::normalizeBlocksScalar(normalized_ref.data(), 0, blocks);
+    check("vec4::normalizeBlocks", vec4::normalizeVariants(), [&](auto fn)
+          {
+              auto out = soa_ref;
+              fn(out.data(), 0, blocks);
+              return within(asFloats(normalized_ref), asFloats(out), vec4::NORMALIZE_TOLERANCE, 1e-30); });
+
+    // vops: unaligned start and a tail
+    const size_t size = 1000003, begin = 5;
+    auto a = uniform<float>(size, -1, 1, 11), b = uniform<float>(size, -1, 1, 12);
+    std::vector<float> sum_ref(size), scaled_ref = a;
+    vops::addScalar(a.data(), b.data(), sum_ref.data(), begin, size);
+    vops::scaleScalar(scaled_ref.data(), begin, size, 2.0f, -1.0f);
+    check("vops::add", vops::addVariants(), [&](auto fn)
+          {
+              std::vector<float> out(size);
+              fn(a.data(), b.data(), out.data(), begin, size);
+              return exact(sum_ref, out); });
+    check("vops::scale", vops::scaleVariants(), [&](auto fn)
+          {
+              auto out = a;
+              fn(out.data(), begin, size, 2.0f, -1.0f);
+              return exact(scaled_ref, out); });
+
+    auto vecs_ref = aos;
+    vops::normalizeScalar(vecs_ref.data(), 3, n - 2);
+    check("vops::normalize", vops::normalizeVariants(), [&](auto fn)
+          {
+              auto out = aos;
+              fn(out.data(), 3, n - 2);
+              return exact(asFloats(vecs_ref), asFloats(out)); });
+}
+
+// rng, expr, knapsack, reduce, vmath, matmul ------------------------------------------------------
+
+void checkRandom()
+{
+    const size_t begin = 7, end = 3 * rng::CHUNK + 45;
+    std::vector<float> f_ref(end - begin);
+    std::vector<int> i_ref(end - begin);
+    rng::fillRangeScalar(f_ref.data(), begin, end, -2.0f, 3.0f, 42);
+    rng::fillRangeScalar(i_ref.data(), begin, end, -100, 1000, 42);
+    check("rng::fillRange<float>", rng::fillVariants<float>(), [&](auto fn)
+          {
+              std::vector<float> out(end - begin);
+              fn(out.data(), begin, end, -2.0f, 3.0f, 42);
+              return exact(f_ref, out); });
+    check("rng::fillRange<int>", rng::fillVariants<int>(), [&](auto fn)
+          {
+              std::vector<int> out(end - begin);
+              fn(out.data(), begin, end, -100, 1000, 42);
+              return exact(i_ref, out); });
+}
+
+void checkExpr()
+{
+    const size_t n = 10007;
+    auto x = uniform<double>(n, -1, 1, 13), y = uniform<double>(n, -1, 1, 14);
+    auto e = expr::clamp(expr::array(x.data()) * 2.0 + expr::array(y.data()) * expr::array(x.data()) - 0.25, -0.5, 0.5);
+    using E = decltype(e);
+    std::vector<double> ref(n);
+    expr::evaluateScalar(ref.data(), e, 0, n, false);
+    // the scalar tails of a variant may be contracted into fmas, so the bound is a few ulp
+    for (bool streaming : {false, true})
+        check(streaming ? "expr::evaluate (streaming)" : "expr::evaluate", expr::evaluateVariants<E>(), [&](auto fn)
+              {
+                  std::vector<double> out(n);
+                  fn(out.data(), e, 1, n, streaming);
+                  out[0] = ref[0];
+                  return within(ref, out, 1e-15); });
+}
+
+void checkKnapsack()
+{
+    const int C = 1003;
+    auto weights = uniform<int>(40, 1, 60, 15), values = uniform<int>(40, 1, 100, 16);
+    std::vector<int> ref(C + 1, 0);
+    for (size_t k = 0; k < weights.size(); k++)
+        knapsack::addItemRangeScalar(ref.data(), weights[k], C + 1, weights[k], values[k]);
+    check("knapsack::addItemRange", knapsack::addItemVariants(), [&](auto fn)
+          {
+              std::vector<int> m(C + 1, 0);
+              for (size_t k = 0; k < weights.size(); k++)
+                  fn(m.data(), weights[k], C + 1, weights[k], values[k]);
+              return exact(ref, m); });
+}
+
+// Unaligned start and a tail; the scalar variants combine their partial sums in the vector order
+void checkReduce()
+{
+    const size_t n = 100003;
+    auto d = uniform<double>(n, -1, 1, 17);
+    auto f = uniform<float>(n, -1, 1, 18);
+    std::vector<double> d_ref = {reduce::sumScalar(d.data() + 1, n - 1)};
+    std::vector<double> f_ref = {reduce::sumScalar(f.data() + 1, n - 1)};
+    check("reduce::sum<double>", reduce::sumVariants<double>(), [&](auto fn)
+          { return exact(d_ref, {fn(d.data() + 1, n - 1)}); });
+    check("reduce::sum<float>", reduce::sumVariants<float>(), [&](auto fn)
+          { return exact(f_ref, {fn(f.data() + 1, n - 1)}); });
+}
+
+// x^-s against libm's pow on [1, 10^4], n leaving a 1-3 element tail
+template <typename Pow>
+void checkNegPow(double s, double bound)
+{
+    const size_t n = 4003;
+    auto x = uniform<double>(n, 1, 1e4, 19);
+    std::vector<double> ref(n);
+    vmath::negPowScalar<Pow>(x.data(), ref.data(), n, s);
+    std::ostringstream what;
+    what << "vmath::negPow (" << Pow::name() << ", " << s << ")";
+    check(what.str(), vmath::negPowVariants<Pow>(), [&](auto fn)
+          {
+              std::vector<double> out(n);
+              fn(x.data(), out.data(), n, s);
+              return within(ref, out, bound, 0.0); });
+}
+
+void checkMatmul()
+{
+    const int n = 517; // tails for both the 8- and 16-wide loops
+    auto A = uniform<float>(n * n, 0, 1, 5), B_T = uniform<float>(n * n, 0, 1, 6);
+    std::vector<float> ref(n * n);
+    matmul::transposedScalar(A.data(), B_T.data(), ref.data(), n, n);
+    check("matmul::transposed", matmul::transposedVariants(), [&](auto fn)
+          {
+              std::vector<float> C(n * n, -1.0f);
+              fn(A.data(), B_T.data(), C.data(), n, n);
+              return within(ref, C, 1e-5); });
+}
+
+int main()
+{
+    std::cout << "SIMD variants vs scalar, " << isa::describe() << "\n";
+    checkGemm<float>("float", 1e-5);
+    checkGemm<double>("double", 1e-13);
+    checkHalfConversions<half::F16>();
+    checkHalfConversions<half::BF16>();
+    checkHalfSpecials<half::F16>({0x7F800001, 0xFFFFFFFF, 0x7FC00000, 0xFFC00000, 0x7FA00000, 0x7F800000, 0xFF800000,
+                                  0x7F7FFFFF, 0x7F800001, 0xFFFFFFFF, 0x477FF000},
+                                 {0x7E00, 0xFFFF, 0x7E00, 0xFE00, 0x7F00, 0x7C00, 0xFC00, 0x7C00, 0x7E00, 0xFFFF, 0x7C00},
+                                 {0x7C01, 0xFFFF, 0x7E00, 0xFE00, 0x7D00, 0x7C00, 0xFC00, 0x7BFF, 0x7C01, 0xFFFF, 0x7E00},
+                                 {0x7FC02000, 0xFFFFE000, 0x7FC00000, 0xFFC00000, 0x7FE00000, 0x7F800000, 0xFF800000,
+                                  0x477FE000, 0x7FC02000, 0xFFFFE000, 0x7FC00000});
+    checkHalfSpecials<half::BF16>({0x7F800001, 0xFFFFFFFF, 0x7FC00000, 0xFFC00000, 0x7FA00000, 0x7F800000, 0xFF800000,
+                                   0x7F7FFFFF, 0x7F800001, 0xFFFFFFFF, 0x7F7F7FFF},
+                                  {0x7FC0, 0xFFFF, 0x7FC0, 0xFFC0, 0x7FE0, 0x7F80, 0xFF80, 0x7F80, 0x7FC0, 0xFFFF, 0x7F7F},
+                                  {0x7F81, 0xFFFF, 0x7FC0, 0xFFC0, 0x7FA0, 0x7F80, 0xFF80, 0x7F7F, 0x7F81, 0xFFFF, 0x7FC0},
+                                  {0x7F810000, 0xFFFF0000, 0x7FC00000, 0xFFC00000, 0x7FA00000, 0x7F800000, 0xFF800000,
+                                   0x7F7F0000, 0x7F810000, 0xFFFF0000, 0x7FC00000});
+    checkHalfGemm<half::F16>();
+    checkHalfGemm<half::BF16>();
+    checkTranspose();
+    checkVec4();
+    checkRandom();
+    checkExpr();
+    checkKnapsack();
+    checkReduce();
+    checkNegPow<vmath::IntPow<2>>(2, 6e-16);
+    checkNegPow<vmath::IntPow<3>>(3, 6e-16);
+    checkNegPow<vmath::RealPow<vmath::Accuracy::High>>(2.5, 1e-15);
+    checkNegPow<vmath::RealPow<vmath::Accuracy::Medium>>(2.5, 1e-13);
+    checkNegPow<vmath::RealPow<vmath::Accuracy::Fast>>(2.5, 1e-6);
+    checkMatmul();
+    std::cout << (failures ? std::to_string(failures) + " MISMATCH(ES)" : std::string("all variants match")) << "\n";
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,34 @@
+#!/bin/sh
+# Build every C++ lab with the compile line from its README and run its registered kernels
+# through common/bench.hpp, writing <lab>.json and <lab>.csv to the output directory. isa_check
+# runs first: every SIMD variant in common/ against its scalar one, stopping on a mismatch.
+#
+#   ./run_benchmarks.sh [OUT_DIR] [bench options...]
+#   ./run_benchmarks.sh results --reps 20 --threads 1,4
+#
+# Extra options (--filter, --warmup, --reps, --sizes, --threads) are passed to every lab.
+set -e
+
+ROOT=$(cd "$(dirname "$0")" && pwd)
+OUT=${1:-"$ROOT/bench_results"}
+[ $# -gt 0 ] && shift
+mkdir -p "$OUT"
+
+run() {
+    lab=$1 src=$2 flags=$3
+    shift 3
+    echo "== $lab"
+    g++ $flags -o "$OUT/$lab" "$ROOT/$lab/$src"
+    "$OUT/$lab" --bench --json "$OUT/$lab.json" --csv "$OUT/$lab.csv" "$@"
+}
+
+echo "== isa_check"
+g++ -O3 -fopenmp -pthread -o "$OUT/isa_check" "$ROOT/isa_check.cpp"
+"$OUT/isa_check"
+
+run Lab3 120210007_lab3.cpp "-O3 -fopenmp" "$@"
+run Lab4 Lab_4.cpp "-O3 -fopenmp" "$@"
+run Lab5 Lab_5.cpp "-O3 -pthread" "$@"
+run Lab6 Lab_6.cpp "-O3 -pthread" "$@"
+run Lab7 Lab_7.cpp "-O3 -fopenmp" "$@"
+run Lab8 vector_ops.cpp "-O3 -fopenmp -pthread" "$@"